@@ -19,6 +19,10 @@
  */
 
 #include <functional>
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 #include <boost/program_options.hpp>
 #include <camoto/stream_file.hpp>
 #include <camoto/util.hpp>
@@ -53,6 +57,30 @@ int iRet = RET_OK;
 /// Use any decompression filters? (unset with -u option)
 bool bUseFilters = true;
 
+/// Filename of the archive, so fdArchive can be opened when it's first needed
+std::string strArchivePath;
+
+/// Archive file opened read-only, for copying file data directly (-1 if not)
+int fdArchive = -1;
+
+/// Has opening fdArchive been attempted yet?
+bool bOpenedArchiveFd = false;
+
+#ifdef __linux__
+/// Close fdArchive on the way out of main(), whichever way that is.
+struct ArchiveFdGuard
+{
+	~ArchiveFdGuard()
+	{
+		if (::fdArchive >= 0) ::close(::fdArchive);
+		::fdArchive = -1;
+	}
+};
+#endif
+
+/// Have any changes been made to the archive that haven't been flushed yet?
+bool bUnflushed = false;
+
 // Split a string in two at a delimiter, e.g. "one=two" becomes "one" and "two"
 // and true is returned.  If there is no delimiter both output strings will be
 // the same as the input string and false will be returned.
@@ -101,31 +129,23 @@ void sanitisePath(std::string& strInput)
 	return;
 }
 
-// Insert a file at the given location.  Shared by --insert and --add.
-bool insertFile(std::shared_ptr<ga::Archive> pArchive, const std::string& strLocalFile,
-	const std::string& strArchFile, const ga::Archive::FileHandle& idBeforeThis,
-	const std::string& type, ga::Archive::File::Attribute attr, stream::len lenReal)
+// Copy a file on disk into a newly inserted file in the archive.
+bool fillFile(std::shared_ptr<ga::Archive> pArchive,
+	const ga::Archive::FileHandle& id, stream::input& fsIn, stream::len lenReal)
 {
-	// Open the file
-	auto fsIn = std::make_unique<stream::file>(strLocalFile, false);
-	stream::len lenSource = fsIn->size();
-
-	fsIn->seekg(0, stream::start);
+	stream::len lenSource = fsIn.size();
+	fsIn.seekg(0, stream::start);
 
 	// Make sure either filters are active, or we've got a nonzero prefilter
 	// length (but it's ok to have a zero prefilter length if the file is empty)
 	assert(bUseFilters || (lenSource == 0) || (lenReal != 0));
 
-	// Create a new entry in the archive large enough to hold the file
-	ga::Archive::FileHandle id = pArchive->insert(idBeforeThis, strArchFile,
-		lenSource, type, attr);
-
 	// Open the new (empty) file in the archive
 	auto psNew = pArchive->open(id, bUseFilters);
 
 	// Copy all the data from the file on disk into the archive file.
 	try {
-		stream::copy(*psNew, *fsIn);
+		stream::copy(*psNew, fsIn);
 		psNew->flush();
 	} catch (const stream::error& e) {
 		std::cout << " [failed; " << e.what() << "]";
@@ -149,6 +169,83 @@ bool insertFile(std::shared_ptr<ga::Archive> pArchive, const std::string& strLoc
 	return true;
 }
 
+// Show a file about to be added with --add.
+void showAdding(const std::string& strArchFile, const std::string& strLocalFile,
+	const std::string& type, stream::len lenReal)
+{
+	std::cout << "     adding: " << strArchFile;
+	if (!type.empty()) std::cout << " as type " << type;
+	if (strArchFile.compare(strLocalFile)) std::cout << " (from " << strLocalFile << ")";
+	if (lenReal != 0) std::cout << ", with uncompressed size set to " << lenReal;
+	std::cout << std::endl;
+	return;
+}
+
+// Insert a file at the given location.  Shared by --insert and --add.
+bool insertFile(std::shared_ptr<ga::Archive> pArchive, const std::string& strLocalFile,
+	const std::string& strArchFile, const ga::Archive::FileHandle& idBeforeThis,
+	const std::string& type, ga::Archive::File::Attribute attr, stream::len lenReal)
+{
+	// Open the file
+	auto fsIn = std::make_unique<stream::file>(strLocalFile, false);
+
+	// Create a new entry in the archive large enough to hold the file
+	ga::Archive::FileHandle id = pArchive->insert(idBeforeThis, strArchFile,
+		fsIn->size(), type, attr);
+
+	return fillFile(pArchive, id, *fsIn, lenReal);
+}
+
+// Add a group of files to the end of the archive.  The archive is only
+// restructured once for the whole group, instead of once per file.  If any of
+// the files can't be added they are all added one at a time instead, so the
+// error can be reported for the file that caused it.  Each file is shown with
+// showAdding() just before its data is copied in, so any error appears under
+// the right name.
+bool addFiles(std::shared_ptr<ga::Archive> pArchive,
+	const std::vector<std::pair<std::string, std::string> >& files,
+	const std::string& type, ga::Archive::File::Attribute attr, stream::len lenReal)
+{
+	std::vector<std::unique_ptr<stream::file> > sources;
+	ga::Archive::FileVector ids;
+	try {
+		std::vector<ga::Archive::NewFile> newFiles;
+		for (const auto& i : files) {
+			sources.push_back(std::make_unique<stream::file>(i.second, false));
+			newFiles.push_back({nullptr, i.first, sources.back()->size(), type,
+				attr});
+		}
+		ids = pArchive->insertMany(newFiles);
+	} catch (const stream::error&) {
+		sources.clear();
+		bool bOK = true;
+		for (const auto& i : files) {
+			showAdding(i.first, i.second, type, lenReal);
+			try {
+				if (!insertFile(pArchive, i.second, i.first, nullptr, type, attr,
+					lenReal)) {
+					std::cout << std::endl;
+					bOK = false;
+				}
+			} catch (const stream::error& e) {
+				std::cout << " [failed; " << e.what() << "]" << std::endl;
+				bOK = false;
+			}
+		}
+		return bOK;
+	}
+
+	bool bOK = true;
+	for (unsigned int n = 0; n < ids.size(); n++) {
+		showAdding(files[n].first, files[n].second, type, lenReal);
+		if (!fillFile(pArchive, ids[n], *sources[n], lenReal)) {
+			std::cout << std::endl;
+			bOK = false;
+		}
+	}
+	return bOK;
+}
+
 /// List the files in the archive and any subfolders.
 /**
  * This function is recursive and will call itself to list files in any
@@ -214,11 +311,79 @@ void listFiles(const std::string& idPrefix, const std::string& path,
 	return;
 }
 
+/// Extract a single file from the archive into a file on disk.
+/**
+ * Unfiltered files in the top-level archive are copied by the kernel straight
+ * from the archive file into the new file where possible.  Anything else is
+ * copied through the archive's streams.
+ *
+ * @param bTopLevel
+ *   true if archive is the one opened from the command line, false if it is
+ *   a subfolder within it (whose offsets aren't relative to the archive file.)
+ */
+void extractFile(ga::Archive& archive, const ga::Archive::FileHandle& id,
+	const std::string& strLocalFile, bool bTopLevel)
+{
+#ifdef __linux__
+	if (bTopLevel && (!bUseFilters || id->filter.empty())) {
+		// Open a second read-only handle the first time a file is extracted, so
+		// the data can be copied without going through user space.  If this
+		// fails, files are just extracted the normal way.
+		if (!::bOpenedArchiveFd) {
+			::bOpenedArchiveFd = true;
+			::fdArchive = ::open(::strArchivePath.c_str(), O_RDONLY);
+		}
+	}
+	if (
+		bTopLevel
+		&& (::fdArchive >= 0)
+		&& (!bUseFilters || id->filter.empty())
+	) {
+		int fdOut = ::open(strLocalFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+			0666);
+		if (fdOut < 0) {
+			throw stream::open_error("Unable to create " + strLocalFile);
+		}
+		bool bCopied;
+		try {
+			// Make sure earlier changes are on disk so the offsets are right
+			if (::bUnflushed) {
+				archive.flush();
+				::bUnflushed = false;
+			}
+			bCopied = ga::extractTo(id, ::fdArchive, fdOut);
+		} catch (...) {
+			::close(fdOut);
+			throw;
+		}
+		::close(fdOut);
+		if (bCopied) return;
+		// Otherwise fall through and do it the slow way
+	}
+#endif
+
+	auto fsOut = std::make_unique<stream::output_file>(strLocalFile, true);
+
+	if (bUseFilters && !id->filter.empty()) {
+		// Decode through a fixed-size buffer rather than all at once, so huge
+		// compressed files don't have to fit in memory.
+		ga::extractStreaming(archive, id, *fsOut);
+		return;
+	}
+
+	auto pfsIn = archive.open(id, bUseFilters);
+
+	// Copy the data from the in-archive stream to the on-disk stream
+	stream::copy(*fsOut, *pfsIn);
+	return;
+}
+
 /// Extract all the files in the archive.
 /**
  * Calls itself recursively to extract any subfolders as well.
  */
-void extractAll(std::shared_ptr<ga::Archive> archive, bool bScript)
+void extractAll(std::shared_ptr<ga::Archive> archive, bool bScript,
+	bool bTopLevel)
 {
 	unsigned int index = (unsigned int)-1;
 	for (const auto& i : archive->files()) {
@@ -279,7 +444,7 @@ void extractAll(std::shared_ptr<ga::Archive> archive, bool bScript)
 				continue;
 			}
 			auto subArch = archive->openFolder(i);
-			extractAll(std::move(subArch), bScript);
+			extractAll(std::move(subArch), bScript, false);
 			fs::current_path(old);
 		} else {
 			// Tell the user what's going on
@@ -291,8 +456,6 @@ void extractAll(std::shared_ptr<ga::Archive> archive, bool bScript)
 
 			// Open on disk
 			try {
-				auto pfsIn = archive->open(i, bUseFilters);
-
 				// If the file exists, add .1 .2 .3 etc. onto the end until an
 				// unused name is found.  This allows extracting files with the
 				// same name, without them getting overwritten.
@@ -312,10 +475,7 @@ void extractAll(std::shared_ptr<ga::Archive> archive, bool bScript)
 				std::cout << std::flush;
 
 				if (bScript) std::cout << ";wrote=" << strLocalFile;
-				auto fsOut = std::make_unique<stream::output_file>(strLocalFile, true);
-
-				// Copy the data from the in-archive stream to the on-disk stream
-				stream::copy(*fsOut, *pfsIn);
+				extractFile(*archive, i, strLocalFile, bTopLevel);
 
 				if (bScript) std::cout << ";status=ok";
 			} catch (...) {
@@ -342,6 +502,10 @@ int main(int iArgC, char *cArgV[])
 	// Disable stdin/printf/etc. sync for a speed boost
 	std::ios_base::sync_with_stdio(false);
 
+#ifdef __linux__
+	ArchiveFdGuard fdGuard;
+#endif
+
 	// Declare the supported options.
 	po::options_description poActions("Actions");
 	poActions.add_options()
@@ -397,6 +561,9 @@ int main(int iArgC, char *cArgV[])
 			"force open even if the archive is not in the given format")
 		("create,c",
 			"create a new archive file instead of opening an existing one")
+		("index,I", po::value<std::string>(),
+			"keep a copy of the file list in this file, to speed up opening "
+			"formats that have no central FAT")
 	;
 
 	po::options_description poHidden("Hidden parameters");
@@ -414,6 +581,7 @@ int main(int iArgC, char *cArgV[])
 
 	std::string strFilename;
 	std::string strType;
+	std::string strIndex;
 
 	bool bScript = false; // show output suitable for script parsing?
 	bool bForceOpen = false; // open anyway even if archive not in given format?
@@ -487,6 +655,16 @@ int main(int iArgC, char *cArgV[])
 				(i->string_key.compare("create") == 0)
 			) {
 				bCreate = true;
+			} else if (
+				(i->string_key.compare("I") == 0) ||
+				(i->string_key.compare("index") == 0)
+			) {
+				if (i->value.size() == 0) {
+					std::cerr << PROGNAME ": --index (-I) requires a parameter."
+						<< std::endl;
+					return RET_BADARGS;
+				}
+				strIndex = i->value[0];
 			}
 		}
 
@@ -504,20 +682,38 @@ int main(int iArgC, char *cArgV[])
 		std::cout << (bCreate ? "Creating " : "Opening ") << strFilename
 			<< " as type " << (strType.empty() ? "<autodetect>" : strType)
 			<< std::endl;
+		// Set if the file could only be opened for reading
+		std::unique_ptr<stream::input_file> psArchiveRO;
 		try {
 			psArchive = std::make_unique<stream::file>(strFilename, bCreate);
 		} catch (const stream::open_error& e) {
-			std::cerr << "Error " << (bCreate ? "creating" : "opening")
-				<< " archive file " << strFilename << ": " << e.what() << std::endl;
-			return RET_SHOWSTOPPER;
+			// If the file can't be written to, it can still be listed and extracted
+			if (!bCreate) {
+				try {
+					psArchiveRO = std::make_unique<stream::input_file>(strFilename);
+					std::cout << "Note: " << strFilename << " is read-only, any "
+						"changes will fail." << std::endl;
+				} catch (const stream::open_error&) {
+				}
+			}
+			if (!psArchiveRO) {
+				std::cerr << "Error " << (bCreate ? "creating" : "opening")
+					<< " archive file " << strFilename << ": " << e.what() << std::endl;
+				return RET_SHOWSTOPPER;
+			}
 		}
+		stream::input& archiveIn = psArchiveRO
+			? static_cast<stream::input&>(*psArchiveRO)
+			: static_cast<stream::input&>(*psArchive);
 
 		// Get the format handler for this file format
 		ga::ArchiveManager::handler_t pArchType;
 		if (strType.empty()) {
-			// Need to autodetect the file format.
-			for (const auto& i : ga::ArchiveManager::formats()) {
-				ga::ArchiveType::Certainty cert = i->isInstance(*psArchive);
+			// Need to autodetect the file format.  Formats that can't possibly
+			// match are skipped, so DefinitelyNo won't normally be seen here.
+			for (const auto& r : ga::probeFormats(archiveIn)) {
+				const auto& i = r.type;
+				ga::ArchiveType::Certainty cert = r.certainty;
 				switch (cert) {
 
 					case ga::ArchiveType::Certainty::DefinitelyNo:
@@ -547,7 +743,7 @@ int main(int iArgC, char *cArgV[])
 				}
 				if (cert != ga::ArchiveType::Certainty::DefinitelyNo) {
 					// We got a possible match, see if it requires any suppdata
-					auto suppList = i->getRequiredSupps(*psArchive, strFilename);
+					auto suppList = i->getRequiredSupps(archiveIn, strFilename);
 					if (suppList.size() > 0) {
 						// It has suppdata, see if it's present
 						std::cout << "  * This format requires supplemental files..."
@@ -593,7 +789,7 @@ finishTesting:
 
 		if (!bCreate) {
 			// Check to see if the file is actually in this format
-			if (pArchType->isInstance(*psArchive) == ga::ArchiveType::Certainty::DefinitelyNo) {
+			if (pArchType->isInstance(archiveIn) == ga::ArchiveType::Certainty::DefinitelyNo) {
 				if (bForceOpen) {
 					std::cerr << "Warning: " << strFilename << " is not a "
 						<< pArchType->friendlyName() << ", open forced." << std::endl;
@@ -607,13 +803,18 @@ finishTesting:
 		}
 
 		// See if the format requires any supplemental files
-		auto suppList = pArchType->getRequiredSupps(*psArchive, strFilename);
+		auto suppList = pArchType->getRequiredSupps(archiveIn, strFilename);
 		camoto::SuppData suppData;
 		for (const auto& s : suppList) {
 			try {
 				std::cout << "Opening supplemental file " << s.second << std::endl;
-				auto suppStream = std::make_unique<stream::file>(s.second, false);
-				suppData[s.first] = std::move(suppStream);
+				if (psArchiveRO) {
+					suppData[s.first] = std::make_unique<ga::inout_readonly>(
+						std::make_unique<stream::input_file>(s.second));
+				} else {
+					auto suppStream = std::make_unique<stream::file>(s.second, false);
+					suppData[s.first] = std::move(suppStream);
+				}
 			} catch (const stream::open_error& e) {
 				std::cerr << "Error opening supplemental file " << s.second
 					<< ": " << e.what() << std::endl;
@@ -626,6 +827,11 @@ finishTesting:
 		try {
 			if (bCreate) {
 				pArchive = pArchType->create(std::move(psArchive), suppData);
+			} else if (psArchiveRO) {
+				pArchive = pArchType->openReadOnly(std::move(psArchiveRO), suppData);
+			} else if (!strIndex.empty()) {
+				pArchive = ga::openWithIndex(*pArchType, std::move(psArchive),
+					suppData, strFilename, strIndex);
 			} else {
 				pArchive = pArchType->open(std::move(psArchive), suppData);
 			}
@@ -636,6 +842,9 @@ finishTesting:
 			return RET_SHOWSTOPPER;
 		}
 
+		// Only opened by extractFile() if something is extracted
+		::strArchivePath = strFilename;
+
 		// File type of inserted files defaults to empty, which means 'generic file'
 		std::string strLastFiletype;
 
@@ -646,12 +855,13 @@ finishTesting:
 		stream::len lenReal = 0;
 
 		// Run through the actions on the command line
-		for (auto& i : pa.options) {
+		for (auto itOpt = pa.options.begin(); itOpt != pa.options.end(); itOpt++) {
+			auto& i = *itOpt;
 			if (i.string_key.compare("list") == 0) {
 				listFiles(std::string(), std::string(), *pArchive, bScript);
 
 			} else if (i.string_key.compare("extract-all") == 0) {
-				extractAll(pArchive, bScript);
+				extractAll(pArchive, bScript, true);
 
 			} else if (i.string_key.compare("metadata") == 0) {
 				listAttributes(pArchive.get(), bScript);
@@ -664,6 +874,7 @@ finishTesting:
 					return RET_BADARGS;
 				}
 				unsigned int index = strtoul(strIndex.c_str(), nullptr, 0);
+				::bUnflushed = true;
 				setAttribute(pArchive.get(), bScript, index, strValue);
 
 			} else if (i.string_key.compare("extract") == 0) {
@@ -684,19 +895,15 @@ finishTesting:
 						std::cout << " [failed; file not found]";
 						iRet = RET_NONCRITICAL_FAILURE; // one or more files failed
 					} else {
-						// Found it, open on disk
-						auto pfsIn = destArch->open(id, bUseFilters);
+						// Found it, copy it out to disk
 						try {
-							auto fsOut = std::make_shared<stream::output_file>(strLocalFile, true);
-							try {
-								stream::copy(*fsOut, *pfsIn);
-							} catch (const stream::error& e) {
-								std::cout << " [failed; read/write error: " << e.what() << "]";
-								iRet = RET_UNCOMMON_FAILURE; // some files failed, but not in a usual way
-							}
-						} catch (const stream::error&) {
+							extractFile(*destArch, id, strLocalFile, destArch == pArchive);
+						} catch (const stream::open_error&) {
 							std::cout << " [failed; unable to create output file]";
 							iRet = RET_UNCOMMON_FAILURE; // some files failed, but not in a usual way
+						} catch (const stream::error& e) {
+							std::cout << " [failed; read/write error: " << e.what() << "]";
+							iRet = RET_UNCOMMON_FAILURE; // some files failed, but not in a usual way
 						}
 					}
 				} catch (const stream::error& e) {
@@ -717,6 +924,7 @@ finishTesting:
 						std::cout << " [failed; file not found]";
 						iRet = RET_NONCRITICAL_FAILURE; // one or more files failed
 					} else {
+						::bUnflushed = true;
 						destArch->remove(id);
 					}
 				} catch (const stream::error& e) {
@@ -757,6 +965,7 @@ finishTesting:
 				}
 
 				try {
+					::bUnflushed = true;
 					insertFile(destArch, strLocalFile, strArchFile, idBeforeThis,
 						strLastFiletype, iLastAttr, lenReal);
 				} catch (const stream::error& e) {
@@ -831,16 +1040,32 @@ finishTesting:
 				bool bAltDest = split(strParam, '=', &strArchFile, &strLocalFile);
 
 				if (i.string_key.compare("add") == 0) {
-					std::cout << "     adding: " << strArchFile;
-					if (!strLastFiletype.empty()) std::cout << " as type " << strLastFiletype;
-					if (bAltDest) std::cout << " (from " << strLocalFile << ")";
-					if (lenReal != 0) std::cout << ", with uncompressed size set to " << lenReal;
-					std::cout << std::endl;
+					// Pick up any more files being added straight after this one, so
+					// they can all be added in one go.
+					std::vector<std::pair<std::string, std::string> > addList;
+					addList.emplace_back(strArchFile, strLocalFile);
+					while (
+						(std::next(itOpt) != pa.options.end())
+						&& (std::next(itOpt)->string_key.compare("add") == 0)
+						&& (std::next(itOpt)->value.size() > 0)
+					) {
+						itOpt++;
+						std::string strNextArch, strNextLocal;
+						split(itOpt->value[0], '=', &strNextArch, &strNextLocal);
+						addList.emplace_back(strNextArch, strNextLocal);
+					}
 
 					try {
-						insertFile(pArchive, strLocalFile, strArchFile,
-							nullptr, strLastFiletype, iLastAttr,
-							lenReal);
+						::bUnflushed = true;
+						if (addList.size() == 1) {
+							showAdding(strArchFile, strLocalFile, strLastFiletype, lenReal);
+							insertFile(pArchive, strLocalFile, strArchFile,
+								nullptr, strLastFiletype, iLastAttr,
+								lenReal);
+						} else {
+							if (!addFiles(pArchive, addList, strLastFiletype, iLastAttr,
+								lenReal)) iRet = RET_UNCOMMON_FAILURE;
+						}
 					} catch (const stream::error& e) {
 						std::cout << " [failed; " << e.what() << "]";
 						iRet = RET_UNCOMMON_FAILURE; // some files failed, but not in a usual way
@@ -862,6 +1087,7 @@ finishTesting:
 								std::cout << " [failed; file not found inside archive]";
 								iRet = RET_NONCRITICAL_FAILURE; // one or more files failed
 							} else {
+								::bUnflushed = true;
 								destArch->rename(id, strLocalFile);
 							}
 						} catch (const stream::error& e) {
@@ -887,6 +1113,7 @@ finishTesting:
 							iRet = RET_NONCRITICAL_FAILURE; // one or more files failed
 						} else {
 							// Found it, open replacement file
+							::bUnflushed = true;
 							auto sSrc = std::make_shared<stream::input_file>(strLocalFile);
 							stream::len lenSource = sSrc->size();
 
@@ -0,0 +1,422 @@
+/**
+ * @file  gameindex.cpp
+ * @brief Command-line tool to identify and index every archive in a folder.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <boost/program_options.hpp>
+#include <camoto/stream_file.hpp>
+#include <camoto/util.hpp>
+#include <camoto/gamearchive.hpp>
+
+namespace po = boost::program_options;
+namespace ga = camoto::gamearchive;
+namespace stream = camoto::stream;
+
+#define PROGNAME "gameindex"
+
+/*** Return values ***/
+/// All is good
+#define RET_OK                 0
+/// Bad arguments (missing/invalid parameters)
+#define RET_BADARGS            1
+/// Major error (couldn't open output file, etc.)
+#define RET_SHOWSTOPPER        2
+/// One or more files could not be indexed
+#define RET_NONCRITICAL_FAILURE 4
+
+/// Return value that will be used
+std::atomic<int> iRet(RET_OK);
+
+/// Include archives that were only detected with an Unsure certainty?
+bool bIncludeUnsure = false;
+
+/// Held while writing to the output or to stderr.
+std::mutex lockOut;
+
+/// Most filenames waiting to be processed for each worker thread.
+#define QUEUE_PER_THREAD  16
+
+/// Filenames waiting for a worker thread to index them.
+/**
+ * The folders are walked at the same time as the files are being indexed, so
+ * the number of filenames held in memory stays the same no matter how many
+ * files there are.  When the queue is full, the folder walk waits for the
+ * workers to catch up.
+ */
+class FileQueue
+{
+	public:
+		FileQueue(unsigned int maxWaiting)
+			:	maxWaiting(maxWaiting),
+				closed(false)
+		{
+		}
+
+		/// Add a file, waiting until there is room in the queue.
+		void push(const std::string& filename)
+		{
+			std::unique_lock<std::mutex> lock(this->lock);
+			this->notFull.wait(lock, [this]() {
+				return this->waiting.size() < this->maxWaiting;
+			});
+			this->waiting.push_back(filename);
+			this->notEmpty.notify_one();
+			return;
+		}
+
+		/// Get the next file, waiting until there is one.
+		/**
+		 * @return false if the queue has been closed and there are no more
+		 *   files.
+		 */
+		bool pop(std::string *filename)
+		{
+			std::unique_lock<std::mutex> lock(this->lock);
+			this->notEmpty.wait(lock, [this]() {
+				return this->closed || !this->waiting.empty();
+			});
+			if (this->waiting.empty()) return false;
+			*filename = std::move(this->waiting.front());
+			this->waiting.pop_front();
+			this->notFull.notify_one();
+			return true;
+		}
+
+		/// No more files will be added.
+		void close()
+		{
+			std::lock_guard<std::mutex> lock(this->lock);
+			this->closed = true;
+			this->notEmpty.notify_all();
+			return;
+		}
+
+	protected:
+		unsigned int maxWaiting;
+		bool closed;
+		std::deque<std::string> waiting;
+		std::mutex lock;
+		std::condition_variable notFull;
+		std::condition_variable notEmpty;
+};
+
+/// Add every file below the given path to the queue.
+/**
+ * This function is recursive and will call itself to list files in any
+ * subfolders found.
+ */
+void findFiles(const std::string& path, FileQueue& files)
+{
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0) {
+		std::lock_guard<std::mutex> lock(::lockOut);
+		std::cerr << PROGNAME ": Unable to access " << path << std::endl;
+		::iRet = RET_NONCRITICAL_FAILURE;
+		return;
+	}
+	if (!S_ISDIR(st.st_mode)) {
+		if (S_ISREG(st.st_mode)) files.push(path);
+		return;
+	}
+
+	DIR *dir = opendir(path.c_str());
+	if (!dir) {
+		std::lock_guard<std::mutex> lock(::lockOut);
+		std::cerr << PROGNAME ": Unable to read folder " << path << std::endl;
+		::iRet = RET_NONCRITICAL_FAILURE;
+		return;
+	}
+	std::vector<std::string> children;
+	struct dirent *ent;
+	while ((ent = readdir(dir)) != NULL) {
+		std::string name = ent->d_name;
+		if ((name.compare(".") == 0) || (name.compare("..") == 0)) continue;
+		children.push_back(path + '/' + name);
+	}
+	closedir(dir);
+
+	// Sort so the files are visited in the same order each time
+	std::sort(children.begin(), children.end());
+	for (const auto& i : children) findFiles(i, files);
+	return;
+}
+
+/// Write out an index line for each file in the archive and any subfolders.
+/**
+ * This function is recursive and will call itself to index files in any
+ * subfolders found.
+ */
+void indexFiles(const std::string& path, ga::Archive& archive,
+	std::ostream& out)
+{
+	for (const auto& i : archive.files()) {
+		std::string name = path + i->strName;
+		if (i->fAttr & ga::Archive::File::Attribute::Folder) {
+			out << "D\t" << name << "\n";
+			auto subArch = archive.openFolder(i);
+			indexFiles(name + '/', *subArch, out);
+			continue;
+		}
+
+		out << "F\t" << name << '\t';
+
+		// Not all archives have offsets, e.g. if every file is compressed into
+		// one big block.
+		auto fat = dynamic_cast<const ga::Archive_FAT::FATEntry *>(&*i);
+		auto fixed = dynamic_cast<const ga::FixedArchive::FixedEntry *>(&*i);
+		if (fat) {
+			out << fat->iOffset + fat->lenHeader;
+		} else if (fixed) {
+			out << fixed->fixed->offset;
+		} else {
+			out << '-';
+		}
+
+		out << '\t' << i->storedSize << '\t' << i->realSize << '\t'
+			<< (i->filter.empty() ? "-" : i->filter) << "\n";
+	}
+	return;
+}
+
+/// Identify a single file and index it if it is an archive.
+/**
+ * @return The index text for the file, which is empty if the file is not
+ *   in a known archive format.
+ */
+std::string indexArchive(const std::string& filename)
+{
+	// Nothing is ever written, so open everything read-only.  This lets the
+	// index be built from write-protected media, and lets several threads read
+	// the same file at once.
+	auto content = std::make_unique<stream::input_file>(filename);
+
+	// Pick the most likely format, preferring ones with all their supplemental
+	// files present, the same way gamearch does.
+	ga::ArchiveManager::handler_t pArchType;
+	camoto::SuppFilenames suppList;
+	for (const auto& r : ga::probeFormats(*content)) {
+		if (
+			(r.certainty == ga::ArchiveType::Certainty::Unsure)
+			&& !bIncludeUnsure
+		) continue;
+
+		auto supps = r.type->getRequiredSupps(*content, filename);
+		bool bSuppOK = true;
+		for (const auto& s : supps) {
+			try {
+				stream::input_file test_presence(s.second);
+			} catch (const stream::open_error&) {
+				bSuppOK = false;
+				break;
+			}
+		}
+		if (!bSuppOK) continue;
+
+		// Take an uncertain match only if nothing else has been found
+		if (
+			!pArchType
+			|| (r.certainty != ga::ArchiveType::Certainty::Unsure)
+			|| !supps.empty()
+		) {
+			pArchType = r.type;
+			suppList = supps;
+		}
+		if (r.certainty == ga::ArchiveType::Certainty::DefinitelyYes) break;
+	}
+	if (!pArchType) return std::string();
+
+	camoto::SuppData suppData;
+	for (const auto& s : suppList) {
+		suppData[s.first] = std::make_unique<ga::inout_readonly>(
+			std::make_unique<stream::input_file>(s.second));
+	}
+
+	std::ostringstream out;
+	out << "A\t" << filename << '\t' << pArchType->code() << "\n";
+	for (const auto& s : suppList) {
+		out << "S\t" << camoto::suppToString(s.first) << '\t' << s.second << "\n";
+	}
+
+	auto pArchive = pArchType->openReadOnly(std::move(content), suppData);
+	indexFiles(std::string(), *pArchive, out);
+	return out.str();
+}
+
+int main(int iArgC, char *cArgV[])
+{
+#ifdef __GLIBCXX__
+	// Set a better exception handler
+	std::set_terminate(__gnu_cxx::__verbose_terminate_handler);
+#endif
+
+	// Disable stdin/printf/etc. sync for a speed boost
+	std::ios_base::sync_with_stdio(false);
+
+	// Declare the supported options.
+	po::options_description poOptions("Options");
+	poOptions.add_options()
+		("output,o", po::value<std::string>(),
+			"write the index to this file instead of stdout")
+		("jobs,j", po::value<unsigned int>(),
+			"number of files to process at once (default is one per CPU)")
+		("unsure,n",
+			"also index files whose format could not be confirmed")
+	;
+
+	po::options_description poHidden("Hidden parameters");
+	poHidden.add_options()
+		("path", "file or folder to index")
+		("help", "produce help message")
+	;
+
+	po::options_description poVisible("");
+	poVisible.add(poOptions);
+
+	po::options_description poComplete("Parameters");
+	poComplete.add(poOptions).add(poHidden);
+
+	std::vector<std::string> paths;
+	std::string strOutput;
+	unsigned int numThreads = 0;
+
+	try {
+		po::parsed_options pa = po::parse_command_line(iArgC, cArgV, poComplete);
+
+		// Parse the global command line options
+		for (std::vector<po::option>::iterator i = pa.options.begin(); i != pa.options.end(); i++) {
+			if (i->string_key.empty()) {
+				// No parameter name, so this is a path to index
+				assert(i->value.size() > 0);  // can't have no values with no name!
+				paths.push_back(i->value[0]);
+			} else if (i->string_key.compare("help") == 0) {
+				std::cout <<
+					"Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>\n"
+					"This program comes with ABSOLUTELY NO WARRANTY.  This is free software,\n"
+					"and you are welcome to change and redistribute it under certain conditions;\n"
+					"see <http://www.gnu.org/licenses/> for details.\n"
+					"\n"
+					"Utility to identify every archive in a set of folders and list their\n"
+					"contents in a single index.\n"
+					"Build date " __DATE__ " " __TIME__ << "\n"
+					"\n"
+					"Usage: gameindex [options] <path> [path...]\n" << poVisible << "\n"
+					<< std::endl;
+				return RET_OK;
+			} else if (
+				(i->string_key.compare("o") == 0) ||
+				(i->string_key.compare("output") == 0)
+			) {
+				if (i->value.size() == 0) {
+					std::cerr << PROGNAME ": --output (-o) requires a parameter."
+						<< std::endl;
+					return RET_BADARGS;
+				}
+				strOutput = i->value[0];
+			} else if (
+				(i->string_key.compare("j") == 0) ||
+				(i->string_key.compare("jobs") == 0)
+			) {
+				if (i->value.size() == 0) {
+					std::cerr << PROGNAME ": --jobs (-j) requires a parameter."
+						<< std::endl;
+					return RET_BADARGS;
+				}
+				numThreads = strtoul(i->value[0].c_str(), NULL, 0);
+			} else if (
+				(i->string_key.compare("n") == 0) ||
+				(i->string_key.compare("unsure") == 0)
+			) {
+				bIncludeUnsure = true;
+			}
+		}
+	} catch (const po::unknown_option& e) {
+		std::cerr << PROGNAME ": " << e.what()
+			<< ".  Use --help for help." << std::endl;
+		return RET_BADARGS;
+	} catch (const po::invalid_command_line_syntax& e) {
+		std::cerr << PROGNAME ": " << e.what()
+			<< ".  Use --help for help." << std::endl;
+		return RET_BADARGS;
+	}
+
+	if (paths.empty()) {
+		std::cerr << PROGNAME ": No files or folders given.  Use --help for help."
+			<< std::endl;
+		return RET_BADARGS;
+	}
+
+	std::ofstream fileOut;
+	if (!strOutput.empty()) {
+		fileOut.open(strOutput, std::ios::out | std::ios::trunc | std::ios::binary);
+		if (!fileOut) {
+			std::cerr << PROGNAME ": Unable to create " << strOutput << std::endl;
+			return RET_SHOWSTOPPER;
+		}
+	}
+	std::ostream& out = strOutput.empty() ? std::cout : fileOut;
+
+	if (numThreads == 0) {
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// Each thread works on one archive at a time, and writes the index for it
+	// as soon as it's done, while this thread walks the folders and feeds the
+	// filenames to them through a queue of fixed size.  This way memory use
+	// doesn't grow with the number of files being indexed.
+	FileQueue files(numThreads * QUEUE_PER_THREAD);
+	auto worker = [&]() {
+		std::string filename;
+		while (files.pop(&filename)) {
+			std::string index;
+			try {
+				index = indexArchive(filename);
+			} catch (const std::exception& e) {
+				std::lock_guard<std::mutex> lock(::lockOut);
+				std::cerr << PROGNAME ": " << filename << ": " << e.what()
+					<< std::endl;
+				::iRet = RET_NONCRITICAL_FAILURE;
+				continue;
+			}
+			if (index.empty()) continue;
+			std::lock_guard<std::mutex> lock(::lockOut);
+			out << index;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int t = 0; t < numThreads; t++) {
+		threads.emplace_back(worker);
+	}
+	for (const auto& i : paths) findFiles(i, files);
+	files.close();
+	for (auto& t : threads) t.join();
+
+	out << std::flush;
+	return ::iRet;
+}
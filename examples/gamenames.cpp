@@ -0,0 +1,360 @@
+/**
+ * @file  gamenames.cpp
+ * @brief Command-line tool to guess filenames in archives that only store
+ *        a hash of each name.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <boost/program_options.hpp>
+#include <camoto/stream_file.hpp>
+#include <camoto/util.hpp>
+#include <camoto/gamearchive.hpp>
+
+namespace po = boost::program_options;
+namespace ga = camoto::gamearchive;
+namespace stream = camoto::stream;
+
+#define PROGNAME "gamenames"
+
+/*** Return values ***/
+/// All is good
+#define RET_OK                 0
+/// Bad arguments (missing/invalid parameters)
+#define RET_BADARGS            1
+/// Major error (couldn't open archive file, etc.)
+#define RET_SHOWSTOPPER        2
+/// Some names could not be found
+#define RET_NONCRITICAL_FAILURE 4
+
+/// Read a list of words from a file, one per line.
+bool readWords(const std::string& filename, bool upper,
+	std::vector<std::string> *words)
+{
+	std::ifstream in(filename);
+	if (!in) return false;
+	std::string line;
+	while (std::getline(in, line)) {
+		// Cope with DOS line endings
+		if (!line.empty() && (line.back() == '\r')) line.pop_back();
+		if (line.empty()) continue;
+		if (upper) camoto::uppercase(line);
+		words->push_back(line);
+	}
+	return true;
+}
+
+/// Split a comma-separated list.
+std::vector<std::string> splitList(const std::string& list, bool upper)
+{
+	std::vector<std::string> items;
+	std::string::size_type start = 0;
+	for (;;) {
+		auto end = list.find(',', start);
+		std::string item = list.substr(start, end - start);
+		if (upper) camoto::uppercase(item);
+		items.push_back(item);
+		if (end == std::string::npos) break;
+		start = end + 1;
+	}
+	return items;
+}
+
+/// Get the extensions of the names that are already known, most common first.
+std::vector<std::string> knownExtensions(const ga::Archive& archive,
+	const ga::NameHash& nameHash)
+{
+	std::map<std::string, unsigned int> counts;
+	for (const auto& i : archive.files()) {
+		uint32_t hash;
+		if (nameHash.placeholder(i->strName, &hash)) continue;
+		auto dot = i->strName.rfind('.');
+		if (dot == std::string::npos) counts[std::string()]++;
+		else counts[i->strName.substr(dot + 1)]++;
+	}
+	std::vector<std::pair<unsigned int, std::string>> sorted;
+	for (const auto& i : counts) sorted.emplace_back(i.second, i.first);
+	std::stable_sort(sorted.begin(), sorted.end(),
+		[](const std::pair<unsigned int, std::string>& a,
+			const std::pair<unsigned int, std::string>& b) {
+			return a.first > b.first;
+		}
+	);
+	std::vector<std::string> exts;
+	for (const auto& i : sorted) exts.push_back(i.second);
+	return exts;
+}
+
+int main(int iArgC, char *cArgV[])
+{
+#ifdef __GLIBCXX__
+	// Set a better exception handler
+	std::set_terminate(__gnu_cxx::__verbose_terminate_handler);
+#endif
+
+	// Disable stdin/printf/etc. sync for a speed boost
+	std::ios_base::sync_with_stdio(false);
+
+	// Declare the supported options.
+	po::options_description poOptions("Options");
+	poOptions.add_options()
+		("type,t", po::value<std::string>(),
+			"specify the archive type (default is autodetect)")
+		("words,w", po::value<std::string>(),
+			"read candidate words from this file, one per line, most likely first")
+		("ext,e", po::value<std::string>(),
+			"comma-separated list of extensions to try (default is those already "
+			"in the archive)")
+		("pairs,p",
+			"also try every pair of words joined together")
+		("digits,d", po::value<unsigned int>(),
+			"also try appending numbers of up to this many digits")
+		("long,l",
+			"also try names that don't fit in DOS 8.3 format")
+		("keep-case,k",
+			"don't convert words and extensions to uppercase")
+		("results,r", po::value<unsigned int>(),
+			"number of names to list for each hash (default 10)")
+		("jobs,j", po::value<unsigned int>(),
+			"number of threads to search with (default is one per CPU)")
+	;
+
+	po::options_description poHidden("Hidden parameters");
+	poHidden.add_options()
+		("archive", "archive file to examine")
+		("help", "produce help message")
+	;
+
+	po::options_description poVisible("");
+	poVisible.add(poOptions);
+
+	po::options_description poComplete("Parameters");
+	poComplete.add(poOptions).add(poHidden);
+
+	std::string strFilename, strType, strExt;
+	std::vector<std::string> wordFiles;
+	bool bUpper = true;
+	ga::NameRecoveryOptions options;
+
+	try {
+		po::parsed_options pa = po::parse_command_line(iArgC, cArgV, poComplete);
+
+		// Parse the global command line options
+		for (std::vector<po::option>::iterator i = pa.options.begin(); i != pa.options.end(); i++) {
+			if (i->string_key.empty()) {
+				// No parameter name, so this is the archive filename
+				assert(i->value.size() > 0);  // can't have no values with no name!
+				if (!strFilename.empty()) {
+					std::cerr << PROGNAME ": Only one archive can be given."
+						<< std::endl;
+					return RET_BADARGS;
+				}
+				strFilename = i->value[0];
+			} else if (i->string_key.compare("help") == 0) {
+				std::cout <<
+					"Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>\n"
+					"This program comes with ABSOLUTELY NO WARRANTY.  This is free software,\n"
+					"and you are welcome to change and redistribute it under certain conditions;\n"
+					"see <http://www.gnu.org/licenses/> for details.\n"
+					"\n"
+					"Utility to guess the names of files in archives that only store a hash\n"
+					"of each filename.\n"
+					"Build date " __DATE__ " " __TIME__ << "\n"
+					"\n"
+					"Usage: gamenames -w <wordlist> [options] <archive>\n" << poVisible << "\n"
+					<< std::endl;
+				return RET_OK;
+			} else if (i->value.size() == 0) {
+				if (
+					(i->string_key.compare("p") == 0) ||
+					(i->string_key.compare("pairs") == 0)
+				) {
+					options.pairs = true;
+				} else if (
+					(i->string_key.compare("l") == 0) ||
+					(i->string_key.compare("long") == 0)
+				) {
+					options.dosNames = false;
+				} else if (
+					(i->string_key.compare("k") == 0) ||
+					(i->string_key.compare("keep-case") == 0)
+				) {
+					bUpper = false;
+				} else {
+					std::cerr << PROGNAME ": --" << i->string_key
+						<< " requires a parameter." << std::endl;
+					return RET_BADARGS;
+				}
+			} else if (
+				(i->string_key.compare("t") == 0) ||
+				(i->string_key.compare("type") == 0)
+			) {
+				strType = i->value[0];
+			} else if (
+				(i->string_key.compare("w") == 0) ||
+				(i->string_key.compare("words") == 0)
+			) {
+				wordFiles.push_back(i->value[0]);
+			} else if (
+				(i->string_key.compare("e") == 0) ||
+				(i->string_key.compare("ext") == 0)
+			) {
+				strExt = i->value[0];
+			} else if (
+				(i->string_key.compare("d") == 0) ||
+				(i->string_key.compare("digits") == 0)
+			) {
+				options.maxDigits = strtoul(i->value[0].c_str(), NULL, 0);
+			} else if (
+				(i->string_key.compare("r") == 0) ||
+				(i->string_key.compare("results") == 0)
+			) {
+				options.maxResults = strtoul(i->value[0].c_str(), NULL, 0);
+			} else if (
+				(i->string_key.compare("j") == 0) ||
+				(i->string_key.compare("jobs") == 0)
+			) {
+				options.numThreads = strtoul(i->value[0].c_str(), NULL, 0);
+			}
+		}
+	} catch (const po::unknown_option& e) {
+		std::cerr << PROGNAME ": " << e.what()
+			<< ".  Use --help for help." << std::endl;
+		return RET_BADARGS;
+	} catch (const po::invalid_command_line_syntax& e) {
+		std::cerr << PROGNAME ": " << e.what()
+			<< ".  Use --help for help." << std::endl;
+		return RET_BADARGS;
+	}
+
+	if (strFilename.empty()) {
+		std::cerr << PROGNAME ": No archive given.  Use --help for help."
+			<< std::endl;
+		return RET_BADARGS;
+	}
+	if (wordFiles.empty()) {
+		std::cerr << PROGNAME ": No word list given (-w).  Use --help for help."
+			<< std::endl;
+		return RET_BADARGS;
+	}
+	for (const auto& i : wordFiles) {
+		if (!readWords(i, bUpper, &options.words)) {
+			std::cerr << PROGNAME ": Unable to read " << i << std::endl;
+			return RET_BADARGS;
+		}
+	}
+
+	try {
+		auto content = std::make_unique<stream::input_file>(strFilename);
+
+		ga::ArchiveManager::handler_t pArchType;
+		if (strType.empty()) {
+			auto results = ga::probeFormats(*content);
+			if (
+				!results.empty()
+				&& (results.back().certainty == ga::ArchiveType::Certainty::DefinitelyYes)
+			) {
+				pArchType = results.back().type;
+			} else {
+				std::cerr << PROGNAME ": Unable to automatically determine the file "
+					"type.  Use the --type option to manually specify the file format."
+					<< std::endl;
+				return RET_BADARGS;
+			}
+		} else {
+			pArchType = ga::ArchiveManager::byCode(strType);
+			if (!pArchType) {
+				std::cerr << PROGNAME ": Unknown file type given to -t/--type: "
+					<< strType << std::endl;
+				return RET_BADARGS;
+			}
+		}
+
+		auto nameHash = ga::nameHashFor(pArchType->code());
+		if (!nameHash) {
+			std::cerr << PROGNAME ": " << pArchType->friendlyName()
+				<< " files store full filenames, there is nothing to recover."
+				<< std::endl;
+			return RET_BADARGS;
+		}
+
+		camoto::SuppData suppData;
+		for (const auto& s : pArchType->getRequiredSupps(*content, strFilename)) {
+			suppData[s.first] = std::make_unique<ga::inout_readonly>(
+				std::make_unique<stream::input_file>(s.second));
+		}
+		auto pArchive = pArchType->openReadOnly(std::move(content), suppData);
+
+		auto targets = ga::unknownHashes(*pArchive, *nameHash);
+		if (targets.empty()) {
+			std::cerr << PROGNAME ": All the filenames are already known."
+				<< std::endl;
+			return RET_OK;
+		}
+
+		if (strExt.empty()) {
+			options.extensions = knownExtensions(*pArchive, *nameHash);
+			if (options.extensions.empty()) {
+				std::cerr << PROGNAME ": No filenames are known, so the extensions "
+					"must be given with --ext (-e)." << std::endl;
+				return RET_BADARGS;
+			}
+		} else {
+			options.extensions = splitList(strExt, bUpper);
+		}
+
+		unsigned long long numTried;
+		auto start = std::chrono::steady_clock::now();
+		auto found = ga::recoverNames(*nameHash, targets, options, &numTried);
+		std::chrono::duration<double> elapsed =
+			std::chrono::steady_clock::now() - start;
+
+		for (auto t : targets) {
+			auto it = found.find(t);
+			if (it == found.end()) {
+				std::cout << std::hex << t << std::dec << "\t-\n";
+				continue;
+			}
+			for (const auto& n : it->second) {
+				std::cout << std::hex << t << std::dec << '\t' << n.name << '\t'
+					<< n.score << "\n";
+			}
+		}
+		std::cout << std::flush;
+
+		std::cerr << PROGNAME ": Tried " << numTried << " names in "
+			<< std::fixed << std::setprecision(2) << elapsed.count() << "s, found "
+			"candidates for " << found.size() << " of " << targets.size()
+			<< " hashes." << std::endl;
+
+		if (found.size() < targets.size()) return RET_NONCRITICAL_FAILURE;
+
+	} catch (const stream::open_error& e) {
+		std::cerr << PROGNAME ": Unable to open " << strFilename << ": "
+			<< e.what() << std::endl;
+		return RET_SHOWSTOPPER;
+	} catch (const stream::error& e) {
+		std::cerr << PROGNAME ": " << e.what() << std::endl;
+		return RET_SHOWSTOPPER;
+	}
+
+	return RET_OK;
+}
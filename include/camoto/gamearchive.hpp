@@ -91,11 +91,20 @@ Additional information is available from the Camoto homepage
 
 // These are all in the camoto::gamearchive namespace
 #include <camoto/gamearchive/archive.hpp>
+#include <camoto/gamearchive/archive_cache.hpp>
+#include <camoto/gamearchive/archive_index.hpp>
 #include <camoto/gamearchive/archivetype.hpp>
+#include <camoto/gamearchive/decode_cache.hpp>
 #include <camoto/gamearchive/filtertype.hpp>
 #include <camoto/gamearchive/fixedarchive.hpp>
 #include <camoto/gamearchive/manager.hpp>
+#include <camoto/gamearchive/name_recovery.hpp>
+#include <camoto/gamearchive/path_index.hpp>
 #include <camoto/gamearchive/stream_archfile.hpp>
+#include <camoto/gamearchive/stream_checkpoint.hpp>
+#include <camoto/gamearchive/stream_chunked.hpp>
+#include <camoto/gamearchive/stream_readonly.hpp>
 #include <camoto/gamearchive/util.hpp>
+#include <camoto/gamearchive/visit.hpp>
 
 #endif // _CAMOTO_GAMEARCHIVE_HPP_
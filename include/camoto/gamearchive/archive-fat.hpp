@@ -117,6 +117,42 @@ class CAMOTO_GAMEARCHIVE_API Archive_FAT: virtual public Archive,
 		/// Maximum length of filenames in this archive format.
 		unsigned int lenMaxFilename;
 
+		/// Can file data be stored anywhere in the archive, in any order?
+		/**
+		 * Formats that store the offset of every file in the FAT can set this to
+		 * true in their constructor, to allow enableFreeSpace() to be used.  The
+		 * FAT entries are then renumbered by position rather than by offset when
+		 * files are inserted and removed, so the FAT order need not match the
+		 * order of the file data.
+		 */
+		bool relocatable;
+
+		/// Is file data being placed in free space rather than in FAT order?
+		/**
+		 * @see enableFreeSpace()
+		 */
+		bool freeSpace;
+
+		/// Unused areas between files, as offset -> length.
+		/**
+		 * This only contains areas left behind by changes made since
+		 * enableFreeSpace() was called, not any unused space that was already in
+		 * the archive when it was opened.  Space at the end of the file data is
+		 * never listed here as it is removed immediately.
+		 */
+		std::map<stream::pos, stream::len> freeExtents;
+
+		/// Is an insertMany() or removeMany() in progress?
+		/**
+		 * While this is set, shiftFiles() only adjusts the offsets in memory and
+		 * adds the change to pendingOffsets, so each FAT entry is written once
+		 * at the end instead of once for every file inserted or removed.
+		 */
+		bool batch;
+
+		/// Offset changes not yet written to the FAT, while batch is set.
+		std::map<FileHandle, stream::delta> pendingOffsets;
+
 		/// Create a new Archive_FAT.
 		/**
 		 * @param content
@@ -154,13 +190,232 @@ class CAMOTO_GAMEARCHIVE_API Archive_FAT: virtual public Archive,
 			const std::string& strFilename, stream::len storedSize, std::string type,
 			File::Attribute attr);
 		virtual void remove(const FileHandle& id);
+		virtual FileVector insertMany(const std::vector<NewFile>& files);
+		virtual void removeMany(const FileVector& ids);
 		virtual void rename(const FileHandle& id, const std::string& strNewName);
 		virtual void move(const FileHandle& idBeforeThis, const FileHandle& id);
 		virtual void resize(const FileHandle& id, stream::len newStoredSize,
 			stream::len newRealSize);
 		virtual void flush();
 
+		/// Place file data in gaps instead of keeping it in FAT order.
+		/**
+		 * Normally files are stored one after the other in the same order as the
+		 * FAT, so inserting, removing or enlarging a file means moving the data
+		 * of every file after it.  Once this function has been called, removed
+		 * or shrunk files leave gaps behind, and new or enlarged files are put
+		 * in the first gap large enough (or after the last file) with only the
+		 * file's FAT entry being rewritten.  The gaps can be removed again with
+		 * compact().
+		 *
+		 * This cannot be turned off again, as files will no longer be in FAT
+		 * order.
+		 *
+		 * @return true if free space is now being used, false if the archive
+		 *   format requires files to be stored in FAT order.
+		 */
+		bool enableFreeSpace();
+
+		/// Remove any gaps left between files by enableFreeSpace().
+		/**
+		 * The data following each gap is moved back to fill it.  As with other
+		 * changes the data is only rewritten once, when the archive is flushed.
+		 *
+		 * @throws stream::error on I/O error.
+		 */
+		void compact();
+
+		/// Read raw archive data, ignoring file boundaries.
+		/**
+		 * This allows the data for several neighbouring files to be read at
+		 * once, as visitFiles() does.  Offsets are the same as FATEntry::iOffset,
+		 * so any changes not yet flushed are taken into account.
+		 *
+		 * @param off
+		 *   Offset from the start of the archive.
+		 *
+		 * @param buffer
+		 *   Where to put the data.  Must be at least len bytes long.
+		 *
+		 * @param len
+		 *   Number of bytes to read.
+		 *
+		 * @throws stream::incomplete_read if the end of the archive is reached
+		 *   first.
+		 */
+		void readRaw(stream::pos off, uint8_t *buffer, stream::len len) const;
+
+		/// Save the list of files so the archive can be reopened more quickly.
+		/**
+		 * The index holds every field of every FAT entry, and can be passed to
+		 * ArchiveType::openIndexed() to open the same archive again without
+		 * reading its FAT.  Only the top level of the archive is saved, not the
+		 * contents of any subfolders.
+		 *
+		 * @param index
+		 *   Stream to write the index to, at the current position.
+		 *
+		 * @throws stream::error on I/O error.
+		 */
+		void writeIndex(stream::output& index) const;
+
 	protected:
+		/// Load the list of files from an index written by writeIndex().
+		/**
+		 * Formats with no central FAT call this from their constructor when given
+		 * an index, and only read the FAT themselves if it fails.
+		 *
+		 * @param index
+		 *   Index to read, from the current position.
+		 *
+		 * @return true if the file list was loaded, false if the index is corrupt
+		 *   or does not fit the archive, in which case nothing has been changed.
+		 */
+		bool readIndex(stream::input& index);
+
+		/// Find the offset just past the end of the last file's data.
+		/**
+		 * @param fatSkip
+		 *   Ignore this entry, or NULL to include all files.
+		 *
+		 * @return Offset of the first byte after all file data, or offFirstFile
+		 *   if there are no files.
+		 */
+		stream::pos endOfData(const FATEntry *fatSkip = NULL) const;
+
+		/// Find somewhere to store a block of data when using free space.
+		/**
+		 * The first gap large enough is used, otherwise space is inserted after
+		 * the last file.  The space is not cleared.
+		 *
+		 * @param len
+		 *   Number of bytes needed.
+		 *
+		 * @param fatSkip
+		 *   File being relocated, which should not be counted when finding the
+		 *   end of the file data, or NULL.
+		 *
+		 * @return Offset of the allocated space.
+		 *
+		 * @throws stream::error on I/O error.
+		 */
+		stream::pos allocate(stream::len len, const FATEntry *fatSkip);
+
+		/// Mark a block of data as no longer in use when using free space.
+		/**
+		 * The block is merged with any neighbouring gaps, and if it is at the end
+		 * of the file data it is removed from the archive straight away.
+		 *
+		 * @throws stream::error on I/O error.
+		 */
+		void release(stream::pos off, stream::len len);
+
+		/// Overwrite part of the archive with zeroes.
+		void zeroContent(stream::pos off, stream::len len);
+
+		/// Start holding back FAT offset updates.
+		/**
+		 * @see batch
+		 */
+		void beginBatch();
+
+		/// Write out any offset changes held back since beginBatch().
+		/**
+		 * @throws stream::error on I/O error.
+		 */
+		void endBatch();
+
+		/// Reorder a file's FAT entry without moving its data.
+		/**
+		 * This can be used to implement move() for formats where the order of the
+		 * FAT does not have to match the order of the file data.  The raw FAT
+		 * entries between the old and new position are rotated in place, so any
+		 * fields the format handler doesn't know about are kept, and the FAT
+		 * vector and index numbers are updated to match.
+		 *
+		 * @param idBeforeThis
+		 *   File to put the entry in front of, or an invalid handle to move it to
+		 *   the end of the FAT.
+		 *
+		 * @param id
+		 *   File being moved.
+		 *
+		 * @param fat
+		 *   Stream holding the FAT.  This can be the archive content or a separate
+		 *   stream (e.g. if the FAT is encrypted.)
+		 *
+		 * @param offFAT
+		 *   Offset of the first FAT entry in fat.
+		 *
+		 * @param lenEntry
+		 *   Size of each FAT entry, in bytes.
+		 *
+		 * @throws stream::error on I/O error.
+		 */
+		void moveFATEntry(const FileHandle& idBeforeThis, const FileHandle& id,
+			stream::inout& fat, stream::pos offFAT, stream::len lenEntry);
+
+		/// Update the FAT vector and index numbers for a file being moved.
+		/**
+		 * Nothing is written to the archive.  This is used by moveFATEntry(), and
+		 * can be used directly by formats whose FAT entries are stored in front
+		 * of each file's data, where moveData() has already moved the entry.
+		 *
+		 * @param idBeforeThis
+		 *   File to put the entry in front of, or an invalid handle to move it to
+		 *   the end of the FAT.
+		 *
+		 * @param id
+		 *   File being moved.
+		 *
+		 * @return false if the file is already in place and nothing was changed.
+		 */
+		bool reorderEntry(const FileHandle& idBeforeThis, const FileHandle& id);
+
+		/// Move a file's data in front of another file, without moving the rest.
+		/**
+		 * This can be used to implement move() for formats where the file data
+		 * must be in the same order as the FAT.  Only the data between the old
+		 * and new positions is touched: it is rotated in place with
+		 * rotateContent(), and the offsets of every file in that area are
+		 * updated with updateFileOffset().  Nothing is inserted into or removed
+		 * from the archive, so the files after it don't move.
+		 *
+		 * The FAT entries are not reordered, so this must be followed by a call
+		 * to moveFATEntry() for formats with a separate FAT, or reorderEntry() for
+		 * formats where the FAT entries are headers moved along with the data.
+		 *
+		 * @param idBeforeThis
+		 *   File to put the data in front of, or an invalid handle to move it
+		 *   after the last file.
+		 *
+		 * @param id
+		 *   File being moved.
+		 *
+		 * @throws stream::error on I/O error.
+		 */
+		void moveData(const FileHandle& idBeforeThis, const FileHandle& id);
+
+		/// Swap two neighbouring blocks of data in the archive stream.
+		/**
+		 * The smaller block is held in memory while the larger one is copied
+		 * over in pieces, so the memory needed depends only on the size of the
+		 * smaller block.
+		 *
+		 * @param off
+		 *   Offset of the first block.
+		 *
+		 * @param lenFirst
+		 *   Length of the first block.
+		 *
+		 * @param lenSecond
+		 *   Length of the second block, which starts straight after the first.
+		 *
+		 * @throws stream::error on I/O error.
+		 */
+		void rotateContent(stream::pos off, stream::len lenFirst,
+			stream::len lenSecond);
+
 		/// Shift any files *starting* at or after offStart by delta bytes.
 		/**
 		 * This updates the internal offsets and index numbers.  The FAT is updated
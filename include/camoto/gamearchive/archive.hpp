@@ -22,6 +22,7 @@
 #ifndef _CAMOTO_GAMEARCHIVE_ARCHIVE_HPP_
 #define _CAMOTO_GAMEARCHIVE_ARCHIVE_HPP_
 
+#include <atomic>
 #include <memory>
 #include <exception>
 #include <vector>
@@ -128,6 +129,19 @@ class CAMOTO_GAMEARCHIVE_API Archive: public HasAttributes
 			/// One or more members from Attribute.
 			Attribute fAttr;
 
+			/// Number of times the file's data has been changed.
+			/**
+			 * This is incremented whenever the file is written to, resized or
+			 * removed, so anything holding a copy of the file's data (such as
+			 * DecodeCache) can tell whether the copy is still current.
+			 *
+			 * Writes only have a const FileHandle and a cache may check it from
+			 * another thread, so it is mutable and atomic.  Archive
+			 * implementations must increment it on every change to the data;
+			 * the base Archive class does not do it for them.
+			 */
+			mutable std::atomic<unsigned long> generation;
+
 
 			/// Empty constructor
 			File();
@@ -211,6 +225,26 @@ class CAMOTO_GAMEARCHIVE_API Archive: public HasAttributes
 		virtual std::unique_ptr<stream::inout> open(const FileHandle& id,
 			bool useFilter) = 0;
 
+		/// Read the first few bytes of a file, after any filter is applied.
+		/**
+		 * This is meant for checking what type of data a file holds.  The data
+		 * is only decoded as far as needed, so it is much quicker than opening
+		 * the file with open() and reading from it when the file is compressed.
+		 *
+		 * @param id
+		 *   A valid iterator, obtained from find(), getFileList(), etc.
+		 *
+		 * @param len
+		 *   Number of bytes to read.
+		 *
+		 * @return The data, which will be shorter than len if the file is
+		 *   shorter than len.
+		 *
+		 * @throw stream::error if the file's filter could not be found, or the
+		 *   data could not be read or decoded.
+		 */
+		virtual std::string peek(const FileHandle& id, stream::len len);
+
 		/// Open a folder in the archive.
 		/**
 		 * There is a default implementation of this which triggers an
@@ -301,6 +335,55 @@ class CAMOTO_GAMEARCHIVE_API Archive: public HasAttributes
 		 */
 		virtual void remove(const FileHandle& id) = 0;
 
+		/// Details of a file to add with insertMany().
+		struct NewFile {
+			FileHandle idBeforeThis;    ///< Insert before this file, or at the end
+			std::string strFilename;    ///< Filename of the new file
+			stream::len storedSize;     ///< Initial size of the new file
+			std::string type;           ///< MIME-like file type, see File::type
+			File::Attribute attr;       ///< File attributes
+		};
+
+		/// Insert a number of files into the archive at once.
+		/**
+		 * This has the same effect as calling insert() for each file in turn, but
+		 * allows the format handler to update the archive structure once for the
+		 * whole group rather than once per file, which is much faster when many
+		 * files are being added.
+		 *
+		 * The files are inserted in the order given, so an idBeforeThis can refer
+		 * to an existing file only, but several new files can share the same
+		 * idBeforeThis to be inserted next to each other in order.
+		 *
+		 * The default implementation just calls insert() repeatedly.
+		 *
+		 * @param files
+		 *   Files to insert.
+		 *
+		 * @return Handles to the new files, in the same order as files.  As with
+		 *   insert(), the data for each one must be written by opening the file
+		 *   afterwards.
+		 *
+		 * @throw stream::error
+		 *   One of the files could not be inserted.  Any files from the list that
+		 *   were already inserted are removed again before the exception is
+		 *   passed on, so the caller can retry one file at a time.
+		 */
+		virtual FileVector insertMany(const std::vector<NewFile>& files);
+
+		/// Delete a number of files from the archive at once.
+		/**
+		 * This has the same effect as calling remove() for each file, but allows
+		 * the format handler to update the archive structure once for the whole
+		 * group.  The default implementation just calls remove() repeatedly.
+		 *
+		 * @param ids
+		 *   Files to delete, in any order.
+		 *
+		 * @post As for remove().
+		 */
+		virtual void removeMany(const FileVector& ids);
+
 		/// Rename a file.
 		/**
 		 * @note Will throw exceptions on invalid names (e.g. name too long)
@@ -0,0 +1,215 @@
+/**
+ * @file  camoto/gamearchive/archive_cache.hpp
+ * @brief Share opened archives between everything reading the same file.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_GAMEARCHIVE_ARCHIVE_CACHE_HPP_
+#define _CAMOTO_GAMEARCHIVE_ARCHIVE_CACHE_HPP_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <camoto/config.hpp>
+#include <camoto/stream.hpp>
+#include <camoto/gamearchive/archive.hpp>
+#include <camoto/gamearchive/manager.hpp>
+
+namespace camoto {
+namespace gamearchive {
+
+/// Read-only archive that can be used from many threads at once.
+/**
+ * The file list is fixed once the archive has been opened, so files() and
+ * find() can be called from any thread.  Reading a file takes a lock for as
+ * long as it takes to copy the file's data out of the archive, after which
+ * the returned stream can be used without affecting anyone else.
+ */
+class CAMOTO_GAMEARCHIVE_API SharedArchive
+{
+	public:
+		/// Take ownership of an archive opened with ArchiveType::openReadOnly().
+		/**
+		 * @param archive
+		 *   Archive to share.  Nothing else may use it after this.
+		 *
+		 * @param type
+		 *   Format handler the archive was opened with.
+		 */
+		SharedArchive(std::shared_ptr<Archive> archive,
+			ArchiveManager::handler_t type);
+
+		/// Get the format handler the archive was opened with.
+		ArchiveManager::handler_t type() const;
+
+		/// Get a list of all files in the archive.
+		/**
+		 * @see Archive::files()
+		 */
+		const Archive::FileVector& files() const;
+
+		/// Find the given file.
+		/**
+		 * @see Archive::find()
+		 */
+		const Archive::FileHandle find(const std::string& strFilename) const;
+
+		/// Open a folder within the archive.
+		/**
+		 * Folders are opened each time this is called, so callers that need the
+		 * same folder often should hold on to the returned instance.
+		 *
+		 * @see Archive::openFolder()
+		 */
+		std::shared_ptr<SharedArchive> openFolder(
+			const Archive::FileHandle& id) const;
+
+		/// Read a file from the archive, with its filter applied.
+		/**
+		 * @param id
+		 *   File to read, as returned by files() or find().
+		 *
+		 * @return A read-only stream of the file's data, independent of the
+		 *   archive and any other streams.
+		 *
+		 * @throws stream::error on I/O error.
+		 */
+		std::unique_ptr<stream::input> open(const Archive::FileHandle& id) const;
+
+	protected:
+		/// Share a folder, using the same lock as the archive it is inside.
+		SharedArchive(std::shared_ptr<Archive> archive,
+			ArchiveManager::handler_t type, std::shared_ptr<std::mutex> lock);
+
+		std::shared_ptr<Archive> archive;     ///< Archive being shared
+		ArchiveManager::handler_t archType;   ///< Format of archive
+
+		/// Serialises reads from archive and any folders opened from it, as
+		/// they all read from the same underlying stream.
+		std::shared_ptr<std::mutex> lock;
+};
+
+/// Cache of opened archives, so the same file is only parsed once.
+/**
+ * Opening an archive reads and parses its FAT, which for a large archive can
+ * take milliseconds.  When the same file is opened many times, for example
+ * by separate request handlers, an ArchiveCache hands out the same
+ * SharedArchive each time instead.
+ *
+ * Files are identified by their device, inode, modification time and size,
+ * so an archive that is replaced or modified on disk is opened again rather
+ * than the old instance being returned.  Supplemental files are not checked,
+ * so they must not be changed without also changing the main archive file
+ * or calling clear().
+ *
+ * Archives stay in the cache while anything is holding on to them.  Once
+ * they are no longer in use they become idle, and only the most recently
+ * used idle archives are kept, up to the limit passed to the constructor.
+ *
+ * It is safe to use the same cache from multiple threads.
+ */
+class CAMOTO_GAMEARCHIVE_API ArchiveCache
+{
+	public:
+		/// Create a new, empty cache.
+		/**
+		 * @param maxIdle
+		 *   Maximum number of archives to keep that are not in use elsewhere.
+		 */
+		ArchiveCache(unsigned int maxIdle);
+		~ArchiveCache();
+
+		/// Open an archive file, or return the instance already opened.
+		/**
+		 * @param filename
+		 *   Path to the archive file on disk.
+		 *
+		 * @param type
+		 *   Format of the file.  If this is empty the format is detected with
+		 *   probeFormats(), and stream::error is thrown if it is not certain.
+		 *
+		 * @return The shared archive.  Every caller opening the same unchanged
+		 *   file with the same type gets the same instance.
+		 *
+		 * @throws stream::open_error if the file or any supplemental files
+		 *   could not be opened.
+		 *
+		 * @throws stream::error if the format could not be identified or the
+		 *   archive could not be read.
+		 */
+		std::shared_ptr<SharedArchive> open(const std::string& filename,
+			ArchiveManager::handler_t type = nullptr);
+
+		/// Drop all idle archives.
+		/**
+		 * Archives still in use are kept, but will be opened again next time
+		 * if they are changed on disk.
+		 */
+		void clear();
+
+		/// Change the maximum number of idle archives to keep.
+		void setMaxIdle(unsigned int maxIdle);
+
+		/// Get the number of archives currently held, in use or not.
+		unsigned int size() const;
+
+	protected:
+		/// What identifies an archive file and the way it was opened.
+		struct Key {
+			unsigned long long dev;   ///< Device the file is on
+			unsigned long long ino;   ///< Inode number of the file
+			long long mtime;          ///< Last modification time, seconds
+			long mtime_nsec;          ///< Last modification time, nanoseconds
+			unsigned long long size;  ///< Size of the file, in bytes
+			std::string type;         ///< ArchiveType::code(), or empty
+
+			bool operator< (const Key& b) const;
+		};
+
+		/// A cached archive.
+		struct Entry {
+			/// The archive itself.
+			std::shared_ptr<SharedArchive> archive;
+
+			/// Value of useCounter when the archive was last returned by open().
+			unsigned long lastUsed;
+		};
+
+		/// Drop the least recently used idle archives until under maxIdle.
+		/**
+		 * @pre lock is held.
+		 */
+		void trim();
+
+		/// Protects everything below.
+		mutable std::mutex lock;
+
+		/// Maximum number of idle archives to keep.
+		unsigned int maxIdle;
+
+		/// Incremented each time open() returns an archive.
+		unsigned long useCounter;
+
+		/// Every archive held.
+		std::map<Key, Entry> entries;
+};
+
+} // namespace gamearchive
+} // namespace camoto
+
+#endif // _CAMOTO_GAMEARCHIVE_ARCHIVE_CACHE_HPP_
@@ -0,0 +1,70 @@
+/**
+ * @file  camoto/gamearchive/archive_index.hpp
+ * @brief Keep a saved copy of an archive's file list on disk.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_GAMEARCHIVE_ARCHIVE_INDEX_HPP_
+#define _CAMOTO_GAMEARCHIVE_ARCHIVE_INDEX_HPP_
+
+#include <camoto/config.hpp>
+#include <camoto/gamearchive/archivetype.hpp>
+
+namespace camoto {
+namespace gamearchive {
+
+/// Open an archive file, using an index file to avoid reading every header.
+/**
+ * For formats where ArchiveType::walksFAT() returns true, the file list is
+ * loaded from the index file if it is current, otherwise the archive is
+ * opened normally and the index file is written for next time.  Other formats
+ * are opened normally and the index file is not used.
+ *
+ * The index is considered current if the archive's path, size and
+ * modification time, and a hash of its first and last few kilobytes, are all
+ * the same as when the index was written.  Any problem reading or writing
+ * the index is ignored, and the archive is just opened normally.
+ *
+ * @param type
+ *   Format of the archive.
+ *
+ * @param content
+ *   The archive file, as for ArchiveType::open().
+ *
+ * @param suppData
+ *   Any supplemental data required by this format, as for ArchiveType::open().
+ *
+ * @param filename
+ *   Path of the archive file on disk, which content was opened from.
+ *
+ * @param indexFilename
+ *   Path of the index file.  It will be created if it doesn't exist.
+ *
+ * @return A pointer to an instance of the Archive class, as for
+ *   ArchiveType::open().
+ *
+ * @throws stream::error if the archive could not be opened.
+ */
+std::shared_ptr<Archive> CAMOTO_GAMEARCHIVE_API openWithIndex(
+	const ArchiveType& type, std::unique_ptr<stream::inout> content,
+	SuppData& suppData, const std::string& filename,
+	const std::string& indexFilename);
+
+} // namespace gamearchive
+} // namespace camoto
+
+#endif // _CAMOTO_GAMEARCHIVE_ARCHIVE_INDEX_HPP_
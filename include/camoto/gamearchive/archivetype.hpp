@@ -51,6 +51,27 @@ class CAMOTO_GAMEARCHIVE_API ArchiveType
 			DefinitelyYes, ///< This format has a signature and it matched.
 		};
 
+		/// Static signature that must be present in every file of this format.
+		/**
+		 * These are checked by probeFormats() before isInstance() is called, so
+		 * that formats which cannot possibly match are skipped without running
+		 * their (possibly expensive) detection code.  Matching a signature is
+		 * necessary but not sufficient, isInstance() still makes the final call.
+		 */
+		struct Signature {
+			/// Offset of the magic bytes from the start of the file.
+			stream::pos offset;
+
+			/// Bytes that must appear at offset.  May contain embedded nulls.
+			std::string magic;
+
+			/// File must be at least this many bytes long.  0 for no minimum.
+			stream::len lenMin;
+
+			/// File must be exactly this many bytes long.  0 for any length.
+			stream::len lenExact;
+		};
+
 		/// Get a short code to identify this file format, e.g. "grp-duke3d"
 		/**
 		 * This can be useful for command-line arguments.
@@ -87,6 +108,16 @@ class CAMOTO_GAMEARCHIVE_API ArchiveType
 		 */
 		virtual ArchiveType::Certainty isInstance(stream::input& content) const = 0;
 
+		/// Get the static signatures that identify this format.
+		/**
+		 * A file must match at least one of these signatures to be in this
+		 * format.  Formats without a fixed signature (which can only be
+		 * detected heuristically) return an empty list, which is the default.
+		 *
+		 * @return A (possibly empty) list of alternative signatures.
+		 */
+		virtual std::vector<Signature> signatures() const;
+
 		/// Create a blank archive in this format.
 		/**
 		 * This function writes out the necessary signatures and headers to create
@@ -139,6 +170,109 @@ class CAMOTO_GAMEARCHIVE_API ArchiveType
 		virtual std::shared_ptr<Archive> open(
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const = 0;
 
+		/// Open an archive file for reading only.
+		/**
+		 * This is the same as open() but takes a stream that can't be written
+		 * to, such as a file on a read-only filesystem or a block of memory.
+		 * Since nothing will be written, several archive instances can read the
+		 * same underlying file at the same time, each with its own stream.
+		 *
+		 * Files in the returned archive can be listed and read, but any attempt
+		 * to write changes back (e.g. by calling flush() after modifying the
+		 * archive) will throw stream::write_error.
+		 *
+		 * The default implementation wraps the stream in an inout_readonly and
+		 * passes it to open().
+		 *
+		 * @param content
+		 *   The archive file to read.
+		 *
+		 * @param suppData
+		 *   Any supplemental data required by this format (see getRequiredSupps()).
+		 *   These can also be wrapped in inout_readonly.
+		 *
+		 * @return A pointer to an instance of the Archive class, as for open().
+		 */
+		virtual std::shared_ptr<Archive> openReadOnly(
+			std::unique_ptr<stream::input> content, SuppData& suppData) const;
+
+		/// Does open() have to read through the whole archive to list the files?
+		/**
+		 * Some formats have no central FAT, only a header in front of each
+		 * file, so opening a large archive means one seek and read per file.
+		 * For these formats openIndexed() can rebuild the file list from an index
+		 * saved by Archive_FAT::writeIndex() instead.
+		 *
+		 * @return true if openIndexed() can make use of an index.  The default
+		 *   implementation returns false.
+		 */
+		virtual bool walksFAT() const;
+
+		/// Open an archive file, using a saved list of files.
+		/**
+		 * This is the same as open(), but the list of files is read from an index
+		 * previously written by Archive_FAT::writeIndex(), rather than from the
+		 * archive itself.  If the index can't be read, the archive is opened
+		 * normally.
+		 *
+		 * @pre The index must have been written from an archive with exactly the
+		 *   same content.  The caller is responsible for checking this, as
+		 *   openWithIndex() does.
+		 *
+		 * @param content
+		 *   The archive file to read.
+		 *
+		 * @param suppData
+		 *   Any supplemental data required by this format (see getRequiredSupps()).
+		 *
+		 * @param index
+		 *   Index to read, as written by Archive_FAT::writeIndex().
+		 *
+		 * @return A pointer to an instance of the Archive class, as for open().
+		 *   The default implementation ignores the index and calls open().
+		 */
+		virtual std::shared_ptr<Archive> openIndexed(
+			std::unique_ptr<stream::inout> content, SuppData& suppData,
+			stream::input& index) const;
+
+		/// A file to be stored by write().
+		struct FileData {
+			std::string strFilename;        ///< Filename, as passed to insert()
+			std::string type;               ///< MIME-like type, see Archive::File::type
+			Archive::File::Attribute attr;  ///< File attributes
+			stream::input *content;         ///< File data, before any filtering
+		};
+
+		/// Create a complete archive in a single pass.
+		/**
+		 * This produces the same archive as calling create() and then inserting
+		 * each file at the end, but without going through the insert/shift
+		 * machinery.  Formats that can be written sequentially override this to
+		 * write out the headers, FAT and file data in order, so the time taken is
+		 * proportional to the amount of data and the output stream is never
+		 * seeked.  This means it can be used to write to pipes and sockets.
+		 *
+		 * The default implementation builds the archive in memory with create()
+		 * and copies it out once it is complete.
+		 *
+		 * @param content
+		 *   Stream to write the archive to.  Nothing is read back from it.
+		 *
+		 * @param files
+		 *   Files to store in the archive, in order.  Each content stream is read
+		 *   from the start until its size() is reached.
+		 *
+		 * @param suppData
+		 *   Any supplemental data required by this format (see
+		 *   getRequiredSupps()), as for create().
+		 *
+		 * @throw stream::error
+		 *   I/O error, or a file can't be stored (e.g. its name is too long.)  The
+		 *   output will be incomplete in this case.
+		 */
+		virtual void write(stream::output& content,
+			const std::vector<FileData>& files, SuppData& suppData) const;
+
 		/// Get a list of any required supplemental files.
 		/**
 		 * For some archive formats, data is stored externally to the archive file
@@ -0,0 +1,155 @@
+/**
+ * @file  camoto/gamearchive/decode_cache.hpp
+ * @brief Keep recently used file data in memory after decompression.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_GAMEARCHIVE_DECODE_CACHE_HPP_
+#define _CAMOTO_GAMEARCHIVE_DECODE_CACHE_HPP_
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <camoto/config.hpp>
+#include <camoto/stream.hpp>
+#include <camoto/gamearchive/archive.hpp>
+
+namespace camoto {
+namespace gamearchive {
+
+/// Cache of file data that has already been passed through its filter.
+/**
+ * Opening a compressed file with Archive::open() decompresses it again each
+ * time.  Reading files through a DecodeCache instead keeps the decompressed
+ * data in memory, so opening the same file again returns the data straight
+ * away.  Once the total size of the cached data goes over the budget, the
+ * least recently used files are dropped.
+ *
+ * Entries are tied to the Archive instance and FileHandle they came from, as
+ * well as Archive::File::generation, so any change to a file (by writing to
+ * it, resizing or removing it) means the old data will not be returned.
+ *
+ * A cache can be used for a single archive, or shared between many.  It is
+ * safe to use the same cache from multiple threads, although as usual each
+ * Archive instance may only be used by one thread at a time.
+ */
+class CAMOTO_GAMEARCHIVE_API DecodeCache
+{
+	public:
+		/// Create a new, empty cache.
+		/**
+		 * @param budget
+		 *   Maximum number of bytes of file data to keep.
+		 */
+		DecodeCache(stream::len budget);
+		~DecodeCache();
+
+		/// Open a file in an archive for reading, with its filter applied.
+		/**
+		 * If the file is in the cache, a stream over the cached data is returned.
+		 * Otherwise the file is opened with Archive::open(), its data is read
+		 * into memory and added to the cache, and a stream over that is returned.
+		 *
+		 * Files larger than the budget are still read into memory but are not
+		 * kept.
+		 *
+		 * @param archive
+		 *   Archive holding the file.
+		 *
+		 * @param id
+		 *   File to open.  It must not be a folder.
+		 *
+		 * @return A read-only stream of the file's filtered data.  The stream
+		 *   remains valid even if the file is later changed or dropped from the
+		 *   cache.
+		 *
+		 * @throws stream::error on I/O error.
+		 */
+		std::unique_ptr<stream::input> open(std::shared_ptr<Archive> archive,
+			const Archive::FileHandle& id);
+
+		/// Drop any cached data for the given file.
+		void invalidate(const Archive::FileHandle& id);
+
+		/// Drop all cached data.
+		void clear();
+
+		/// Change the maximum amount of data to keep.
+		/**
+		 * If the new budget is smaller, the least recently used files are
+		 * dropped until the cached data fits.
+		 */
+		void setBudget(stream::len budget);
+
+		/// Get the number of bytes of file data currently held.
+		stream::len size() const;
+
+	protected:
+		/// Lookup key, which is the archive and file addresses.
+		typedef std::pair<const Archive *, const Archive::File *> Key;
+
+		/// A file's cached data.
+		struct Entry {
+			/// Where this entry is in the index.
+			Key key;
+
+			/// Archive the data came from.
+			std::weak_ptr<Archive> archive;
+
+			/// File the data came from.
+			std::weak_ptr<const Archive::File> id;
+
+			/// Archive::File::generation at the time the data was read.
+			unsigned long generation;
+
+			/// The file's data, after filtering.
+			std::shared_ptr<const std::string> data;
+		};
+
+		/// Drop least recently used entries until the data fits in the budget.
+		/**
+		 * @pre lock is held.
+		 */
+		void trim();
+
+		/// Remove one entry.
+		/**
+		 * @pre lock is held.
+		 */
+		void erase(std::map<Key, std::list<Entry>::iterator>::iterator it);
+
+		/// Protects everything below.
+		mutable std::mutex lock;
+
+		/// Maximum number of bytes to keep.
+		stream::len budget;
+
+		/// Number of bytes currently held.
+		stream::len used;
+
+		/// Cached files, most recently used first.
+		std::list<Entry> lru;
+
+		/// Position of each file in lru.
+		std::map<Key, std::list<Entry>::iterator> index;
+};
+
+} // namespace gamearchive
+} // namespace camoto
+
+#endif // _CAMOTO_GAMEARCHIVE_DECODE_CACHE_HPP_
@@ -100,6 +100,10 @@ class CAMOTO_GAMEARCHIVE_API FilterType
 
 		/// Apply the algorithm to an input stream.
 		/**
+		 * Unlike the read/write stream, the data should only be decoded as it is
+		 * read (e.g. via input_checkpointed) so reading the first few bytes of a
+		 * large file is cheap.
+		 *
 		 * @sa apply(std::shared_ptr<stream::inout>)
 		 */
 		virtual std::unique_ptr<stream::input> apply(
@@ -113,6 +117,18 @@ class CAMOTO_GAMEARCHIVE_API FilterType
 		virtual std::unique_ptr<stream::output> apply(
 			std::unique_ptr<stream::output> target, stream::fn_notify_prefiltered_size resize)
 			const = 0;
+
+		/// Apply the algorithm to an input stream that will be read out of order.
+		/**
+		 * This is the same as apply(std::unique_ptr<stream::input>) except that
+		 * filters able to save their state can return an input_checkpointed
+		 * stream, so seeking backwards doesn't have to decode the data again
+		 * from the start.  The default implementation just calls apply().
+		 *
+		 * @sa apply(std::shared_ptr<stream::inout>)
+		 */
+		virtual std::unique_ptr<stream::input> applySeekable(
+			std::unique_ptr<stream::input> target) const;
 };
 
 } // namespace gamearchive
@@ -21,6 +21,7 @@
 #ifndef _CAMOTO_GAMEARCHIVE_MANAGER_HPP_
 #define _CAMOTO_GAMEARCHIVE_MANAGER_HPP_
 
+#include <vector>
 #include <camoto/formatenum.hpp>
 #include <camoto/gamearchive/archivetype.hpp>
 #include <camoto/gamearchive/filtertype.hpp>
@@ -31,6 +32,87 @@ namespace gamearchive {
 typedef FormatEnumerator<ArchiveType> CAMOTO_GAMEARCHIVE_API ArchiveManager;
 typedef FormatEnumerator<FilterType> CAMOTO_GAMEARCHIVE_API FilterManager;
 
+} // namespace gamearchive
+
+// byCode() is specialised to use a hash table built once from formats(), so
+// these declarations must be visible before any call to it.
+template <>
+CAMOTO_GAMEARCHIVE_API FormatEnumerator<gamearchive::ArchiveType>::handler_t
+	FormatEnumerator<gamearchive::ArchiveType>::byCode(const std::string& code);
+
+template <>
+CAMOTO_GAMEARCHIVE_API FormatEnumerator<gamearchive::FilterType>::handler_t
+	FormatEnumerator<gamearchive::FilterType>::byCode(const std::string& code);
+
+namespace gamearchive {
+
+/// Result of checking a stream against a single archive format.
+struct CAMOTO_GAMEARCHIVE_API ProbeResult {
+	/// Format handler that was checked.
+	ArchiveManager::handler_t type;
+
+	/// Value returned by the handler's isInstance().
+	ArchiveType::Certainty certainty;
+};
+
+/// Check whether a stream matches any of a format's static signatures.
+/**
+ * @param type
+ *   Format handler to check against.
+ *
+ * @param content
+ *   Stream to examine.
+ *
+ * @return true if the format has no signatures (so could be anything), or
+ *   if at least one signature matched.  false if the content cannot be in
+ *   this format.
+ */
+CAMOTO_GAMEARCHIVE_API bool signatureMatches(const ArchiveType& type,
+	stream::input& content);
+
+/// Work out which archive formats a stream could be in.
+/**
+ * The start of the stream is read once and compared against the signatures
+ * declared by each format handler.  isInstance() is only called for those
+ * formats whose signature matched.  Formats without a signature are only
+ * probed if none of the formats with a signature recognised the content.
+ *
+ * Probing stops at the first DefinitelyYes result.
+ *
+ * @param content
+ *   Stream to examine.
+ *
+ * @return List of every format that did not return DefinitelyNo, in the
+ *   same order as ArchiveManager::formats().  If the last entry is
+ *   DefinitelyYes then it is the correct format.
+ */
+CAMOTO_GAMEARCHIVE_API std::vector<ProbeResult> probeFormats(
+	stream::input& content);
+
+/// Work out which archive formats a stream could be in, using many threads.
+/**
+ * This produces the same result as probeFormats(), but the isInstance()
+ * checks are run concurrently, each on its own read-only view of a single
+ * in-memory copy of the file.  Once any check returns DefinitelyYes, the
+ * checks for formats listed after it are cancelled: those not yet started
+ * are skipped, and those already running are stopped at their next read or
+ * seek.  A check that does a lot of work between reads will still finish
+ * that work before it notices.
+ *
+ * Files too large to reasonably hold in memory are passed to probeFormats()
+ * instead.
+ *
+ * @param content
+ *   Stream to examine.  It is only read from the calling thread.
+ *
+ * @param numThreads
+ *   Maximum number of probes to run at once.  0 uses one per CPU core.
+ *
+ * @return Same as probeFormats().
+ */
+CAMOTO_GAMEARCHIVE_API std::vector<ProbeResult> probeFormatsParallel(
+	stream::input& content, unsigned int numThreads = 0);
+
 } // namespace gamearchive
 } // namespace camoto
 
@@ -0,0 +1,187 @@
+/**
+ * @file  camoto/gamearchive/name_recovery.hpp
+ * @brief Guess filenames for formats that only store a hash of each name.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_GAMEARCHIVE_NAME_RECOVERY_HPP_
+#define _CAMOTO_GAMEARCHIVE_NAME_RECOVERY_HPP_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include <camoto/config.hpp>
+#include <camoto/gamearchive/archive.hpp>
+
+namespace camoto {
+namespace gamearchive {
+
+/// Hash function used by a format that stores hashes in place of filenames.
+/**
+ * The hash is calculated in steps so that the hash of a common prefix can be
+ * worked out once and then reused for every candidate name starting with it.
+ */
+class CAMOTO_GAMEARCHIVE_API NameHash
+{
+	public:
+		virtual ~NameHash();
+
+		/// Get the hash state before any characters have been added.
+		virtual uint32_t initial() const = 0;
+
+		/// Add more characters to the hash.
+		/**
+		 * @param state
+		 *   Hash state after the characters before these ones.
+		 *
+		 * @param data
+		 *   Characters to add.
+		 *
+		 * @param len
+		 *   Number of characters in data.
+		 *
+		 * @return The new hash state.
+		 */
+		virtual uint32_t update(uint32_t state, const char *data,
+			unsigned int len) const = 0;
+
+		/// Get the final hash value from a hash state.
+		/**
+		 * The default implementation returns the state unchanged.
+		 */
+		virtual uint32_t finish(uint32_t state) const;
+
+		/// Get the hash of a whole filename.
+		uint32_t hash(const std::string& name) const;
+
+		/// Find out whether a filename is a placeholder for an unknown name.
+		/**
+		 * Formats that can't work out a file's name use its hash as the
+		 * filename instead.  The default implementation accepts names made up
+		 * only of lowercase hex digits.
+		 *
+		 * @param name
+		 *   Filename from Archive::File::strName.
+		 *
+		 * @param hash
+		 *   On return, the hash value the placeholder represents.
+		 *
+		 * @return true if the name is a placeholder, false if it is a real
+		 *   filename.
+		 */
+		virtual bool placeholder(const std::string& name, uint32_t *hash) const;
+};
+
+/// Get the hash function used by a format to store filenames.
+/**
+ * @param archTypeCode
+ *   ArchiveType::code() of the format.
+ *
+ * @return The hash function, or an empty pointer if the format stores the
+ *   filenames themselves.
+ */
+CAMOTO_GAMEARCHIVE_API std::shared_ptr<const NameHash> nameHashFor(
+	const std::string& archTypeCode);
+
+/// Get the hashes of every file in an archive whose name is not known.
+/**
+ * @param archive
+ *   Archive to examine.  Only the top level is checked.
+ *
+ * @param nameHash
+ *   Hash function used by the archive's format.
+ */
+CAMOTO_GAMEARCHIVE_API std::set<uint32_t> unknownHashes(
+	const Archive& archive, const NameHash& nameHash);
+
+/// Which candidate names to try in recoverNames().
+struct CAMOTO_GAMEARCHIVE_API NameRecoveryOptions
+{
+	/// Words to build names from, most likely first.  These are used as-is,
+	/// so should be uppercase for formats that only use uppercase names.
+	std::vector<std::string> words;
+
+	/// Extensions to try, without the dot and most likely first.  An empty
+	/// string tries names without any extension.
+	std::vector<std::string> extensions;
+
+	/// Also try every pair of words joined together.
+	bool pairs;
+
+	/// Try appending numbers with up to this many digits to each name, with
+	/// and without leading zeroes (e.g. 2 tries 0-9 and 00-99.)
+	unsigned int maxDigits;
+
+	/// Only try names that fit in DOS 8.3 format.
+	bool dosNames;
+
+	/// Number of threads to search with.  0 uses one per CPU core.
+	unsigned int numThreads;
+
+	/// Most candidates to keep for each hash.
+	unsigned int maxResults;
+
+	NameRecoveryOptions();
+};
+
+/// A filename that matched one of the hashes.
+struct CAMOTO_GAMEARCHIVE_API RecoveredName
+{
+	/// The filename.
+	std::string name;
+
+	/// How likely it is to be the real name.  Higher is better.  This is only
+	/// meaningful compared to other names found in the same search.
+	int score;
+};
+
+/// Try to work out filenames from their hashes, using a dictionary.
+/**
+ * Every combination of word, optional second word, optional number and
+ * extension allowed by the options is hashed and compared against the
+ * targets.  Many different names will match each hash when the hash is
+ * small, so the matches are ranked, preferring names made from fewer and
+ * more common words, fewer digits and more common extensions.
+ *
+ * The search is split between threads by the first word of each name.
+ *
+ * @param nameHash
+ *   Hash function used by the format.
+ *
+ * @param targets
+ *   Hashes to find names for.
+ *
+ * @param options
+ *   Which names to try.
+ *
+ * @param numTried
+ *   If not NULL, set on return to the number of candidate names tried.
+ *
+ * @return The best matches found for each hash in targets, best first.
+ *   Hashes that didn't match any candidates are not included.
+ */
+CAMOTO_GAMEARCHIVE_API std::map<uint32_t, std::vector<RecoveredName>>
+	recoverNames(const NameHash& nameHash, const std::set<uint32_t>& targets,
+	const NameRecoveryOptions& options, unsigned long long *numTried = nullptr);
+
+} // namespace gamearchive
+} // namespace camoto
+
+#endif // _CAMOTO_GAMEARCHIVE_NAME_RECOVERY_HPP_
@@ -0,0 +1,119 @@
+/**
+ * @file  camoto/gamearchive/path_index.hpp
+ * @brief Look up files by full path without reopening each folder.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_GAMEARCHIVE_PATH_INDEX_HPP_
+#define _CAMOTO_GAMEARCHIVE_PATH_INDEX_HPP_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <camoto/config.hpp>
+#include <camoto/gamearchive/archive.hpp>
+
+namespace camoto {
+namespace gamearchive {
+
+/// Index of every file in an archive and its subfolders, by full path.
+/**
+ * findFile() opens each folder along a path every time it is called, which
+ * for formats like Stellar 7's .RES means re-reading the nested archive each
+ * time.  A PathIndex instead opens every folder once, up front, and keeps
+ * the opened folders so that looking up a path is a single hash table
+ * lookup.
+ *
+ * Paths are matched without regard to case, and may use either '/' or '\\'
+ * between folder names.  Where a file in a flat archive has a name that
+ * looks like a path (e.g. "A/B"), it takes precedence over a file B in a
+ * folder A, as it does in findFile().
+ *
+ * The index is not updated when the archive changes, so rebuild() must be
+ * called after inserting, removing or renaming any files.
+ */
+class CAMOTO_GAMEARCHIVE_API PathIndex
+{
+	public:
+		/// Index every file in the archive.
+		/**
+		 * @param root
+		 *   Archive to index, including all its subfolders.
+		 *
+		 * @throws stream::error if a subfolder could not be opened.
+		 */
+		PathIndex(std::shared_ptr<Archive> root);
+
+		/// Look up a file by its full path.
+		/**
+		 * @param path
+		 *   Path to the file, relative to the root archive.
+		 *
+		 * @param pArchive
+		 *   On output, the archive or subfolder holding the file, if found.
+		 *
+		 * @param pFile
+		 *   On output, the file itself, which is only valid for the archive in
+		 *   pArchive.  Set to an empty pointer if the file could not be found.
+		 *
+		 * @return true if the file was found, false if not.
+		 */
+		bool find(const std::string& path, std::shared_ptr<Archive> *pArchive,
+			Archive::FileHandle *pFile) const;
+
+		/// Get the number of files and folders in the index.
+		unsigned long size() const;
+
+		/// Discard the index and build it again from the root archive.
+		void rebuild();
+
+	protected:
+		/// Where a file can be found.
+		struct Location {
+			/// Index into folders of the archive holding the file.
+			unsigned int folder;
+
+			/// The file itself.
+			Archive::FileHandle id;
+		};
+
+		/// Add the files in one archive and all its subfolders to the index.
+		/**
+		 * @param archive
+		 *   Archive to add.
+		 *
+		 * @param prefix
+		 *   Normalised path to the archive, with a trailing slash, or empty for
+		 *   the root archive.
+		 */
+		void add(std::shared_ptr<Archive> archive, const std::string& prefix);
+
+		/// Convert a path into the form used as a key in paths.
+		static std::string normalise(const std::string& path);
+
+		/// Root archive and every subfolder that has been opened.
+		std::vector<std::shared_ptr<Archive>> folders;
+
+		/// Location of each file, by normalised path.
+		std::unordered_map<std::string, Location> paths;
+};
+
+} // namespace gamearchive
+} // namespace camoto
+
+#endif // _CAMOTO_GAMEARCHIVE_PATH_INDEX_HPP_
@@ -137,9 +137,28 @@ class CAMOTO_GAMEARCHIVE_API output_archfile:
 		output_archfile(std::shared_ptr<Archive> archive, Archive::FileHandle id,
 			std::shared_ptr<stream::output> content);
 
+		/// Trim off any spare space reserved by writes.
+		/**
+		 * Any errors are ignored, so flush() should be called first if the final
+		 * resize could fail.
+		 */
+		virtual ~output_archfile();
+
+		/// Write data, enlarging the file in the archive if needed.
+		/**
+		 * When writing past the end of the file, more space than is needed is
+		 * requested from the archive so that a file written in many small pieces
+		 * doesn't cause all the following files to be moved on every write.  The
+		 * spare space is removed again by flush().
+		 */
+		virtual stream::len try_write(const uint8_t *buffer, stream::len len);
+
 		virtual void truncate(stream::len size);
 		virtual void flush();
 
+		/// Size of the file, not counting any spare space reserved by writes.
+		virtual stream::len sub_size() const;
+
 		/// Set the original (decompressed) size of this stream.
 		/**
 		 * This is just a convenience function to call Archive::resize().
@@ -149,6 +168,9 @@ class CAMOTO_GAMEARCHIVE_API output_archfile:
 	protected:
 		/// Archive handle for resizing/truncating.
 		std::shared_ptr<Archive> archive;
+
+		/// Number of bytes at the end of the file reserved for future writes.
+		stream::len lenSpare;
 };
 
 /// Read/write stream accessing a file within an Archive.
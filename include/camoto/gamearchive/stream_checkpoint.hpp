@@ -0,0 +1,213 @@
+/**
+ * @file  camoto/gamearchive/stream_checkpoint.hpp
+ * @brief Decompressing stream that can seek without decoding from the start.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_GAMEARCHIVE_STREAM_CHECKPOINT_HPP_
+#define _CAMOTO_GAMEARCHIVE_STREAM_CHECKPOINT_HPP_
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <camoto/config.hpp>
+#include <camoto/filter.hpp>
+#include <camoto/stream.hpp>
+#include <camoto/util.hpp> // std::make_unique
+#include <camoto/gamearchive/archive.hpp>
+
+namespace camoto {
+namespace gamearchive {
+
+/// Default amount of decoded data between decoder checkpoints.
+#define CHECKPOINT_INTERVAL (16 * 1024)
+
+/// Read-only stream that decodes data through a filter on demand.
+/**
+ * stream::input_filtered decodes all the data as soon as it is opened.  This
+ * stream only decodes as far as the furthest byte that has been read, so
+ * reading the first few bytes of a large file is cheap.
+ *
+ * If a clone function is given, the stream also takes a copy of the filter's
+ * state every so often as it decodes, so when seeking backwards it can carry
+ * on from the closest copy before the new offset rather than starting again.
+ * The list of checkpoints is built up as the data is read.  Without a clone
+ * function, seeking backwards resets the filter and decodes again from the
+ * start of the data.
+ *
+ * The filter must be able to be copied at any point between calls to
+ * filter::transform(), and the copy must carry on from exactly the same
+ * place as the original.  This is true for filters that keep all their state
+ * (including any dictionary) in member variables.
+ *
+ * Each checkpoint holds a complete copy of the filter, so a smaller interval
+ * makes seeks faster at the cost of more memory.
+ */
+class CAMOTO_GAMEARCHIVE_API input_checkpointed: virtual public stream::input
+{
+	public:
+		/// Function used to copy the filter's state.
+		typedef std::function<std::shared_ptr<filter>(const filter&)> fn_clone;
+
+		/// Decode data from a stream, without checkpoints.
+		/**
+		 * @param parent
+		 *   Stream holding the filtered (e.g. compressed) data.  It must be
+		 *   seekable.
+		 *
+		 * @param filt
+		 *   Filter to decode the data with.  It will be reset before use.
+		 */
+		input_checkpointed(std::unique_ptr<stream::input> parent,
+			std::shared_ptr<filter> filt);
+
+		/// Decode data from a stream, with checkpoints.
+		/**
+		 * @param parent
+		 *   Stream holding the filtered (e.g. compressed) data.  It must be
+		 *   seekable.
+		 *
+		 * @param filt
+		 *   Filter to decode the data with.  It will be reset before use.
+		 *
+		 * @param clone
+		 *   Function returning a copy of the filter passed to it.  This is given
+		 *   filt or a copy previously returned by this function.
+		 *
+		 * @param interval
+		 *   Amount of decoded data between checkpoints.
+		 */
+		input_checkpointed(std::unique_ptr<stream::input> parent,
+			std::shared_ptr<filter> filt, fn_clone clone,
+			stream::len interval = CHECKPOINT_INTERVAL);
+		virtual ~input_checkpointed();
+
+		virtual stream::len try_read(uint8_t *buffer, stream::len len);
+		virtual void seekg(stream::delta off, stream::seek_from from);
+		virtual stream::pos tellg() const;
+
+		/// Get the decoded size.
+		/**
+		 * The first time this is called the remaining data is decoded to find
+		 * where it ends, which also records checkpoints for the rest of the data.
+		 */
+		virtual stream::len size() const;
+
+		/// Has enough been decoded to know the size without decoding any more?
+		bool decodedSizeKnown() const;
+
+	protected:
+		/// Copy of the filter's state at one point in the data.
+		struct Checkpoint
+		{
+			stream::pos posOut;    ///< Offset in the decoded data
+			stream::pos posIn;     ///< Offset of the next byte to read from parent
+			/// Filter state, never used directly.  This is null for the first
+			/// checkpoint if there is no clone function.
+			std::shared_ptr<filter> state;
+		};
+
+		/// Get the filter ready to decode the byte at the given offset.
+		/**
+		 * If the offset is in bufOut, or the filter is already before the offset
+		 * and there is no checkpoint between the two, the filter is left as it
+		 * is.  Otherwise it is restored from the closest checkpoint before the
+		 * offset.
+		 */
+		void rewind(stream::pos target);
+
+		/// Decode the next block of data into bufOut, replacing what was there.
+		/**
+		 * @return false at the end of the data.
+		 */
+		bool decode();
+
+		/// Read more filtered data, keeping any that hasn't been used yet.
+		/**
+		 * @return false if no more data could be read.
+		 */
+		bool fill();
+
+		std::unique_ptr<stream::input> parent; ///< Filtered data
+		std::shared_ptr<filter> filt;          ///< Filter doing the decoding
+		fn_clone clone;                        ///< Filter copy function, or empty
+		stream::len interval;                  ///< Distance between checkpoints
+
+		/// Checkpoints recorded so far, in order of offset.  There is always at
+		/// least one, for the start of the data.
+		std::vector<Checkpoint> checkpoints;
+
+		std::vector<uint8_t> bufIn; ///< Filtered data waiting to be decoded
+		stream::len lenBufIn;       ///< Amount of valid data in bufIn
+		stream::len posBufIn;       ///< Amount of bufIn already decoded
+		stream::pos posBufStart;    ///< Offset in parent of bufIn[0]
+
+		std::vector<uint8_t> bufOut; ///< Last block of decoded data
+		stream::len lenBufOut;       ///< Amount of valid data in bufOut
+
+		/// Offset of next byte the filter will produce, which is just after the
+		/// end of bufOut.
+		stream::pos posDecoded;
+		stream::pos offset;         ///< Current read position
+		bool sizeKnown;             ///< true once lenDecoded is valid
+		stream::len lenDecoded;     ///< Total decoded size
+};
+
+/// Decode data with a filter that can be copied with its copy constructor.
+/**
+ * @param F
+ *   Filter class.
+ *
+ * @param parent
+ *   Stream holding the filtered data.
+ */
+template <class F>
+std::unique_ptr<stream::input> make_checkpointed(
+	std::unique_ptr<stream::input> parent)
+{
+	return std::make_unique<input_checkpointed>(
+		std::move(parent),
+		std::make_shared<F>(),
+		[](const filter& f) -> std::shared_ptr<filter> {
+			return std::make_shared<F>(dynamic_cast<const F&>(f));
+		}
+	);
+}
+
+/// Open a file in an archive for reading, with fast seeking if possible.
+/**
+ * This is the same as Archive::open() with the filter applied, except that
+ * the file is read-only and FilterType::applySeekable() is used, so filters
+ * that support it can seek backwards without decoding from the start.
+ *
+ * @param archive
+ *   Archive holding the file.
+ *
+ * @param id
+ *   File to open.
+ *
+ * @return Stream of the file's decoded data.
+ *
+ * @throw stream::error if the file's filter could not be found.
+ */
+std::unique_ptr<stream::input> CAMOTO_GAMEARCHIVE_API openSeekable(
+	std::shared_ptr<Archive> archive, const Archive::FileHandle& id);
+
+} // namespace gamearchive
+} // namespace camoto
+
+#endif // _CAMOTO_GAMEARCHIVE_STREAM_CHECKPOINT_HPP_
@@ -0,0 +1,187 @@
+/**
+ * @file  camoto/gamearchive/stream_chunked.hpp
+ * @brief Read/write stream for data compressed in independent chunks, which
+ *        only re-encodes the chunks that have changed.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_GAMEARCHIVE_STREAM_CHUNKED_HPP_
+#define _CAMOTO_GAMEARCHIVE_STREAM_CHUNKED_HPP_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <camoto/config.hpp>
+#include <camoto/stream.hpp>
+#include <camoto/stream_filtered.hpp>
+
+namespace camoto {
+namespace gamearchive {
+
+/// Compression algorithm that encodes each block of data on its own.
+/**
+ * The encoded data is a fixed-length header followed by one chunk after
+ * another.  Every chunk except the last decodes to chunkSize() bytes, and no
+ * chunk depends on any other, so one can be replaced without touching the
+ * rest.
+ */
+class CAMOTO_GAMEARCHIVE_API ChunkCodec
+{
+	public:
+		/// Location of one chunk in the encoded data.
+		struct Chunk
+		{
+			stream::pos offset; ///< Offset of the chunk from the start of the data
+			stream::len length; ///< Encoded length of the chunk
+		};
+
+		virtual ~ChunkCodec();
+
+		/// Get the amount of decoded data in every chunk but the last.
+		virtual stream::len chunkSize() const = 0;
+
+		/// Find all the chunks in some encoded data.
+		/**
+		 * This should only read the header and whatever is needed to find where
+		 * each chunk starts, so it is much quicker than decoding everything.
+		 *
+		 * @param encoded
+		 *   Encoded data, which is not empty.
+		 *
+		 * @param chunks
+		 *   On return, the location of each chunk in order.
+		 *
+		 * @return The size of the data once decoded.
+		 *
+		 * @throw filter_error if the data is not in the correct format.
+		 */
+		virtual stream::len index(stream::input& encoded,
+			std::vector<Chunk> *chunks) const = 0;
+
+		/// Create the header for a given amount of decoded data.
+		/**
+		 * The header must be the same length no matter what lenDecoded is, so it
+		 * can be updated without moving the chunks that follow.
+		 */
+		virtual std::string header(stream::len lenDecoded) const = 0;
+
+		/// Decode one chunk.
+		/**
+		 * @param encoded
+		 *   Encoded chunk as located by index().
+		 *
+		 * @param lenDecoded
+		 *   Decoded length of the chunk.
+		 */
+		virtual std::string decode(const std::string& encoded,
+			stream::len lenDecoded) const = 0;
+
+		/// Encode one chunk.
+		/**
+		 * @param decoded
+		 *   Data to encode, which is no longer than chunkSize().
+		 */
+		virtual std::string encode(const std::string& decoded) const = 0;
+};
+
+/// Read/write stream that decodes and re-encodes individual chunks.
+/**
+ * stream::filtered decodes the whole file into memory when it is opened, and
+ * encodes all of it again when it is flushed, even if only one byte was
+ * changed.  This stream instead decodes each chunk as it is read, keeps
+ * track of which chunks have been written to, and when flushed only encodes
+ * those chunks and splices them in place of the old ones.  Any data after
+ * them is moved if the new chunks are a different size, but is not
+ * re-encoded.
+ *
+ * The read and write pointers are shared, as they are in stream::file.
+ */
+class CAMOTO_GAMEARCHIVE_API inout_chunked: virtual public stream::inout
+{
+	public:
+		/// Access chunked data.
+		/**
+		 * @param parent
+		 *   Encoded data.  It can be empty, for a new file.
+		 *
+		 * @param codec
+		 *   Algorithm used to encode the data.
+		 *
+		 * @param resize
+		 *   Notification function called during flush() if the decoded size has
+		 *   changed.  As this is not an output_filtered, the first parameter is
+		 *   always null.  This function can be empty.
+		 *
+		 * @throw filter_error if the data is not in the correct format.
+		 */
+		inout_chunked(std::unique_ptr<stream::inout> parent,
+			std::shared_ptr<const ChunkCodec> codec,
+			stream::fn_notify_prefiltered_size resize);
+		virtual ~inout_chunked();
+
+		virtual stream::len try_read(uint8_t *buffer, stream::len len);
+		virtual void seekg(stream::delta off, stream::seek_from from);
+		virtual stream::pos tellg() const;
+		virtual stream::len size() const;
+
+		virtual stream::len try_write(const uint8_t *buffer, stream::len len);
+		virtual void seekp(stream::delta off, stream::seek_from from);
+		virtual stream::pos tellp() const;
+		virtual void truncate(stream::len size);
+		virtual void flush();
+
+	protected:
+		/// Get the decoded data for a chunk.
+		/**
+		 * Chunks that have been written to come from the dirty list, anything
+		 * else is read from the parent and decoded.
+		 */
+		const std::string& getChunk(unsigned int index);
+
+		/// Get a chunk that is about to be changed, and mark it as dirty.
+		std::string& editChunk(unsigned int index);
+
+		/// Decoded length of a chunk when the data is size bytes long.
+		stream::len chunkLength(unsigned int index, stream::len size) const;
+
+		std::unique_ptr<stream::inout> parent;     ///< Encoded data
+		std::shared_ptr<const ChunkCodec> codec;   ///< Encoding algorithm
+		stream::fn_notify_prefiltered_size resize; ///< Size change notification
+		stream::len lenChunk; ///< Cached value of codec->chunkSize()
+
+		/// Location of each chunk in parent, as of the last flush.
+		std::vector<ChunkCodec::Chunk> chunks;
+		unsigned int numValid;      ///< Number of chunks still usable after truncation
+		stream::len lenHeader;      ///< Length of the header in parent
+		stream::len lenEncoded;     ///< Length of parent as of the last flush
+		stream::len lenFlushed;     ///< Decoded size as of the last flush
+
+		stream::len lenDecoded;     ///< Current decoded size
+		stream::pos offset;         ///< Current read/write position
+
+		/// Decoded chunks that have been changed since the last flush.
+		std::map<unsigned int, std::string> dirty;
+
+		int cachedIndex;            ///< Index of cachedChunk, or -1 for none
+		std::string cachedChunk;    ///< Most recently read clean chunk
+};
+
+} // namespace gamearchive
+} // namespace camoto
+
+#endif // _CAMOTO_GAMEARCHIVE_STREAM_CHUNKED_HPP_
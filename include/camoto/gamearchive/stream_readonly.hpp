@@ -0,0 +1,110 @@
+/**
+ * @file  stream_readonly.hpp
+ * @brief Provide a read/write stream interface on top of a read-only stream.
+ *
+ * Copyright (C) 2010-2016 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_STREAM_READONLY_HPP_
+#define _CAMOTO_STREAM_READONLY_HPP_
+
+#include <memory>
+#include <string>
+#include <camoto/config.hpp>
+#include <camoto/stream.hpp>
+
+namespace camoto {
+namespace gamearchive {
+
+/// Stream that allows a read-only stream to be used where an inout is needed.
+/**
+ * Reads are passed straight through to the underlying stream.  Any attempt to
+ * write to or truncate the stream throws stream::write_error, so an archive
+ * opened on one of these can be read normally but flush() will fail if any
+ * changes were made.
+ *
+ * The read and write pointers are shared, as they are in stream::file.
+ */
+class CAMOTO_GAMEARCHIVE_API inout_readonly: virtual public stream::inout
+{
+	public:
+		/// Wrap a read-only stream.
+		/**
+		 * @param parent
+		 *   Stream to read from.  This can be anything from a file opened for
+		 *   reading only to a block of memory.
+		 */
+		inout_readonly(std::unique_ptr<stream::input> parent);
+		virtual ~inout_readonly();
+
+		virtual stream::len try_read(uint8_t *buffer, stream::len len);
+		virtual void seekg(stream::delta off, stream::seek_from from);
+		virtual stream::pos tellg() const;
+		virtual stream::len size() const;
+
+		virtual stream::len try_write(const uint8_t *buffer, stream::len len);
+		virtual void seekp(stream::delta off, stream::seek_from from);
+		virtual stream::pos tellp() const;
+		virtual void truncate(stream::len size);
+		virtual void flush();
+
+	protected:
+		std::unique_ptr<stream::input> parent; ///< Stream being wrapped
+};
+
+/// Read-only stream over part of a block of memory shared with other streams.
+/**
+ * Unlike stream::input_string, the data is not copied, so many streams can
+ * be reading from the same data at the same time, each with its own read
+ * position.  The data must not be changed while any streams are using it.
+ */
+class CAMOTO_GAMEARCHIVE_API input_shared_buffer: virtual public stream::input
+{
+	public:
+		/// Read from part of a shared string.
+		/**
+		 * @param data
+		 *   Data to read.
+		 *
+		 * @param start
+		 *   Offset into data of the first byte in the stream.
+		 *
+		 * @param len
+		 *   Length of the stream.  start + len must not be beyond the end of
+		 *   data.
+		 */
+		input_shared_buffer(std::shared_ptr<const std::string> data,
+			stream::pos start, stream::len len);
+
+		/// Read from the whole of a shared string.
+		input_shared_buffer(std::shared_ptr<const std::string> data);
+
+		virtual stream::len try_read(uint8_t *buffer, stream::len len);
+		virtual void seekg(stream::delta off, stream::seek_from from);
+		virtual stream::pos tellg() const;
+		virtual stream::len size() const;
+
+	protected:
+		std::shared_ptr<const std::string> data; ///< Shared data
+		stream::pos start;  ///< Offset into data where the stream begins
+		stream::len len;    ///< Length of the stream
+		stream::pos offset; ///< Current read position, relative to start
+};
+
+} // namespace gamearchive
+} // namespace camoto
+
+#endif // _CAMOTO_STREAM_READONLY_HPP_
@@ -24,6 +24,7 @@
 #include <camoto/config.hpp>
 #include <camoto/stream_sub.hpp>
 #include <camoto/gamearchive/archive.hpp>
+#include <camoto/gamearchive/path_index.hpp>
 
 namespace camoto {
 namespace gamearchive {
@@ -49,10 +50,137 @@ namespace gamearchive {
 void CAMOTO_GAMEARCHIVE_API findFile(std::shared_ptr<Archive> *pArchive,
 	Archive::FileHandle *pFile, const std::string& filename);
 
+/// Find the given file using a prebuilt index of all subfolders.
+/**
+ * This is the same as the other findFile(), except that paths into
+ * subfolders are looked up in index rather than opening each folder along
+ * the way.
+ *
+ * @param index
+ *   Index built from the archive passed in pArchive.
+ *
+ * @param pArchive
+ *   On input, the archive index was built from.  On output, the archive
+ *   holding the file.
+ *
+ * @param pFile
+ *   On output, the ID of the file itself, or an empty shared_ptr if the file
+ *   could not be found.
+ *
+ * @param filename
+ *   Filename to look for.
+ */
+void CAMOTO_GAMEARCHIVE_API findFile(const PathIndex& index,
+	std::shared_ptr<Archive> *pArchive, Archive::FileHandle *pFile,
+	const std::string& filename);
+
 /// Truncate callback for substreams that are a fixed size.
 void CAMOTO_GAMEARCHIVE_API preventResize(stream::output_sub* sub,
 	stream::len len);
 
+/// Copy a file's data out of the archive without passing it through a stream.
+/**
+ * On Linux, copy_file_range() or sendfile() is used to get the kernel to copy
+ * the data straight from the archive file into the output file, avoiding any
+ * copies through user space.  No filters are applied, so this is only
+ * suitable for files without a filter, or where the raw data is wanted.
+ *
+ * @pre The archive must have been flushed, so that the offsets in the FAT
+ *   match the data on disk.  The archive must also have been opened directly
+ *   on a file (not on a subfolder or a filtered stream) so that the offsets
+ *   are relative to the start of fdArchive.
+ *
+ * @param id
+ *   File to copy.
+ *
+ * @param fdArchive
+ *   File descriptor for the archive file, opened for reading.  Its file
+ *   position is not used or changed.
+ *
+ * @param fdOut
+ *   File descriptor to write to, at its current file position.
+ *
+ * @return true if the data was copied, false if the file's location could not
+ *   be determined or the platform has no suitable API.  Nothing is written to
+ *   fdOut if false is returned, so the caller should copy the data in the
+ *   usual way instead.
+ *
+ * @throw stream::error on I/O error.
+ */
+bool CAMOTO_GAMEARCHIVE_API extractTo(const Archive::FileHandle& id,
+	int fdArchive, int fdOut);
+
+/// A file to be copied by extractMany().
+struct ExtractTarget
+{
+	/// File to copy out of the archive.
+	Archive::FileHandle id;
+
+	/// File descriptor to write to, at its current file position.  Each file
+	/// must have its own descriptor.
+	int fdOut;
+};
+
+/// Copy the data for many files out of the archive at once.
+/**
+ * This does the same as calling extractTo() for each file, and has the same
+ * preconditions.  When built with liburing and running on a kernel that
+ * supports io_uring, the reads and writes for many small files are submitted
+ * to the kernel together, rather than waiting for each one to finish before
+ * starting the next.  Otherwise each file is passed to extractTo() in turn.
+ *
+ * The caller can open the output files in batches, to avoid running out of
+ * file descriptors when extracting a large number of files.
+ *
+ * @param files
+ *   Files to copy, and where to put them.
+ *
+ * @param fdArchive
+ *   File descriptor for the archive file, opened for reading.  Its file
+ *   position is not used or changed.
+ *
+ * @return Any files that could not be copied because extractTo() would have
+ *   returned false for them.  These should be copied in the usual way.
+ *
+ * @throw stream::error on I/O error.  Some of the files may have been copied
+ *   by this point.
+ */
+std::vector<ExtractTarget> CAMOTO_GAMEARCHIVE_API extractMany(
+	const std::vector<ExtractTarget>& files, int fdArchive);
+
+/// Copy a file's data out of the archive, decoding it in fixed-size pieces.
+/**
+ * Archive::open() gives random access to a filtered file by decoding all of
+ * it into memory first, which for a file that expands to hundreds of
+ * megabytes can use more memory than is available.  This function instead
+ * decodes the data a block at a time into a ring buffer of a fixed size,
+ * while another thread writes it out.  If the output can't keep up, decoding
+ * pauses until there is room in the buffer again.
+ *
+ * Memory use is limited to lenBuffer plus a small amount (a few kilobytes)
+ * used by the filter itself, no matter how large the file is.
+ *
+ * @param archive
+ *   Archive holding the file.  It must not be used by any other thread until
+ *   this function returns.
+ *
+ * @param id
+ *   File to extract.  Its filter (if any) is applied.
+ *
+ * @param out
+ *   Stream to write the data to, at its current position.  It is flushed
+ *   once all the data has been written.
+ *
+ * @param lenBuffer
+ *   Size of the ring buffer, in bytes.
+ *
+ * @throw stream::error on I/O error, or filter_error if the data could not be
+ *   decoded.  Some of the data may have been written by this point.
+ */
+void CAMOTO_GAMEARCHIVE_API extractStreaming(Archive& archive,
+	const Archive::FileHandle& id, stream::output& out,
+	stream::len lenBuffer = 256 * 1024);
+
 } // namespace gamearchive
 } // namespace camoto
 
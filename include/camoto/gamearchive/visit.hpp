@@ -0,0 +1,86 @@
+/**
+ * @file  camoto/gamearchive/visit.hpp
+ * @brief Read many files from an archive in on-disk order.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_GAMEARCHIVE_VISIT_HPP_
+#define _CAMOTO_GAMEARCHIVE_VISIT_HPP_
+
+#include <functional>
+#include <camoto/config.hpp>
+#include <camoto/stream.hpp>
+#include <camoto/gamearchive/archive.hpp>
+
+namespace camoto {
+namespace gamearchive {
+
+/// Function called by visitFiles() with the data for each file.
+/**
+ * @param id
+ *   File being visited.
+ *
+ * @param content
+ *   The file's data.  This is only valid until the function returns.
+ */
+typedef std::function<void(const Archive::FileHandle& id,
+	stream::input& content)> fn_visit;
+
+/// Read a number of files from an archive, in the order their data is stored.
+/**
+ * Reading files in FAT order can mean seeking back and forth across the whole
+ * archive, in formats like WAD where the FAT and the data can be in different
+ * orders.  This function instead reads the files in order of their offset
+ * within the archive, and where files are close together their data is
+ * loaded with a single read.
+ *
+ * All reading is done from the calling thread, as archive streams are not
+ * thread-safe.  If numThreads is more than one, the data is then handed to
+ * other threads, which apply any filters (e.g. decompression) and call
+ * fnVisit.  In this case fnVisit must be thread-safe, and files will not be
+ * visited in any particular order.
+ *
+ * Folders are skipped, as are any files that are no longer valid.
+ *
+ * @param archive
+ *   Archive holding the files.
+ *
+ * @param files
+ *   Files to read, e.g. archive->files().
+ *
+ * @param useFilter
+ *   true to pass the data through each file's filter before calling fnVisit,
+ *   false to supply the raw data as stored in the archive.
+ *
+ * @param fnVisit
+ *   Function to call for each file.
+ *
+ * @param numThreads
+ *   Number of threads to call fnVisit from.  0 uses one per CPU core, and 1
+ *   calls fnVisit from the calling thread only.
+ *
+ * @throws stream::error on I/O error.  Any exception thrown by fnVisit stops
+ *   any further files being visited, and is then passed on to the caller.
+ */
+void CAMOTO_GAMEARCHIVE_API visitFiles(std::shared_ptr<Archive> archive,
+	const Archive::FileVector& files, bool useFilter, fn_visit fnVisit,
+	unsigned int numThreads);
+
+} // namespace gamearchive
+} // namespace camoto
+
+#endif // _CAMOTO_GAMEARCHIVE_VISIT_HPP_
@@ -21,10 +21,17 @@
 #include <algorithm>
 #include <cassert>
 #include <functional>
+#include <camoto/iostream_helpers.hpp>
 #include <camoto/util.hpp>
 #include <camoto/gamearchive/archive-fat.hpp>
 #include <camoto/gamearchive/stream_archfile.hpp>
 
+/// Maximum length of any string in an index written by writeIndex().
+#define FAT_INDEX_MAX_STRING 4096
+
+/// Maximum number of files readIndex() will accept.
+#define FAT_INDEX_MAX_FILES  1048576
+
 namespace camoto {
 namespace gamearchive {
 
@@ -49,11 +56,17 @@ Archive_FAT::Archive_FAT(std::unique_ptr<stream::inout> content,
 	stream::pos offFirstFile, int lenMaxFilename)
 	:	content(std::make_shared<stream::seg>(std::move(content))),
 		offFirstFile(offFirstFile),
-		lenMaxFilename(lenMaxFilename)
+		lenMaxFilename(lenMaxFilename),
+		relocatable(false),
+		freeSpace(false),
+		batch(false)
 {
 }
 
 Archive_FAT::Archive_FAT()
+	:	relocatable(false),
+		freeSpace(false),
+		batch(false)
 {
 }
 
@@ -184,8 +197,13 @@ const Archive::FileHandle Archive_FAT::insert(const FileHandle& idBeforeThis,
 		if (this->vcFAT.size()) {
 			auto pFATAfterThis = dynamic_cast<const FATEntry *>(this->vcFAT.back().get());
 			assert(pFATAfterThis);
-			pNewFile->iOffset = pFATAfterThis->iOffset
-				+ pFATAfterThis->lenHeader + pFATAfterThis->storedSize;
+			if (this->relocatable) {
+				// The last FAT entry isn't necessarily the last file in the archive
+				pNewFile->iOffset = this->endOfData();
+			} else {
+				pNewFile->iOffset = pFATAfterThis->iOffset
+					+ pFATAfterThis->lenHeader + pFATAfterThis->storedSize;
+			}
 			pNewFile->iIndex = pFATAfterThis->iIndex + 1;
 		} else {
 			// There are no files in the archive
@@ -194,9 +212,24 @@ const Archive::FileHandle Archive_FAT::insert(const FileHandle& idBeforeThis,
 		}
 	}
 
+	// The FAT of a relocatable format may not be in the same order as the file
+	// data (see move() and enableFreeSpace()), so the other entries can't be
+	// renumbered by offset in shiftFiles().  They are renumbered below instead,
+	// and until then any offset changes (e.g. from preInsertFile() growing the
+	// FAT) would be written to the entries' old slots.  Holding them back until
+	// the entries have been renumbered means each one is written only once,
+	// in the right place.
+	bool ownBatch = this->relocatable && !this->batch;
+	if (ownBatch) this->beginBatch();
+
 	// Add the file's entry from the FAT.  May throw (e.g. filename too long),
 	// archive should be left untouched in this case.
-	this->preInsertFile(pFATBeforeThis, &*pNewFile);
+	try {
+		this->preInsertFile(pFATBeforeThis, &*pNewFile);
+	} catch (const stream::error&) {
+		if (ownBatch) this->endBatch();
+		throw;
+	}
 
 	// Now it's mostly valid.  Really this is here so that it's invalid during
 	// preInsertFile(), so any calls in there to shiftFiles() will ignore the
@@ -204,6 +237,37 @@ const Archive::FileHandle Archive_FAT::insert(const FileHandle& idBeforeThis,
 	// to be marked valid otherwise it won't be skipped/ignored.
 	pNewFile->bValid = true;
 
+	if (this->relocatable) {
+		// Renumber by FAT position.  The on-disk entries have already moved
+		// along with the space preInsertFile() inserted into the FAT.
+		for (auto& i : this->vcFAT) {
+			auto pFAT = FATEntry::cast(i);
+			if (pFAT->iIndex >= pNewFile->iIndex) pFAT->iIndex++;
+		}
+	}
+
+	if (this->freeSpace) {
+		stream::len lenNew = pNewFile->lenHeader + pNewFile->storedSize;
+		stream::pos offNew = this->allocate(lenNew, NULL);
+		stream::delta offDelta = offNew - pNewFile->iOffset;
+		pNewFile->iOffset = offNew;
+		this->updateFileOffset(&*pNewFile, offDelta);
+		this->zeroContent(offNew, lenNew);
+
+		if (this->isValid(idBeforeThis)) {
+			auto itBeforeThis = std::find(this->vcFAT.begin(), this->vcFAT.end(),
+				idBeforeThis);
+			assert(itBeforeThis != this->vcFAT.end());
+			this->vcFAT.insert(itBeforeThis, pNewFile);
+		} else {
+			this->vcFAT.push_back(pNewFile);
+		}
+
+		if (ownBatch) this->endBatch();
+		this->postInsertFile(&*pNewFile);
+		return pNewFile;
+	}
+
 	if (this->isValid(idBeforeThis)) {
 		// Update the offsets of any files located after this one (since they will
 		// all have been shifted forward to make room for the insert.)
@@ -211,7 +275,7 @@ const Archive::FileHandle Archive_FAT::insert(const FileHandle& idBeforeThis,
 			&*pNewFile,
 			pNewFile->iOffset + pNewFile->lenHeader,
 			pNewFile->storedSize,
-			1
+			this->relocatable ? 0 : 1
 		);
 
 		// Add the new file to the vector now all the existing offsets have been
@@ -233,6 +297,7 @@ const Archive::FileHandle Archive_FAT::insert(const FileHandle& idBeforeThis,
 	this->content->seekp(pNewFile->iOffset + pNewFile->lenHeader, stream::start);
 	this->content->insert(pNewFile->storedSize);
 
+	if (ownBatch) this->endBatch();
 	this->postInsertFile(&*pNewFile);
 
 	return pNewFile;
@@ -250,6 +315,7 @@ void Archive_FAT::remove(const FileHandle& id)
 
 	auto pFAT = FATEntry::cast(id);
 	assert(pFAT);
+	pFAT->generation++;
 
 	// Remove the file's entry from the FAT
 	this->preRemoveFile(pFAT);
@@ -263,13 +329,29 @@ void Archive_FAT::remove(const FileHandle& id)
 	assert(itErase != this->vcFAT.end());
 	this->vcFAT.erase(itErase);
 
+	if (this->relocatable) {
+		// Renumber by FAT position, as the FAT may not be in data order
+		for (auto& i : this->vcFAT) {
+			auto pFATOther = FATEntry::cast(i);
+			if (pFATOther->iIndex > pFAT->iIndex) pFATOther->iIndex--;
+		}
+	}
+
+	if (this->freeSpace) {
+		// The removed file's data becomes a gap
+		pFAT->bValid = false;
+		this->release(pFAT->iOffset, pFAT->lenHeader + pFAT->storedSize);
+		this->postRemoveFile(pFAT);
+		return;
+	}
+
 	// Update the offsets of any files located after this one (since they will
 	// all have been shifted back to fill the gap made by the removal.)
 	this->shiftFiles(
 		pFAT,
 		pFAT->iOffset,
 		-((stream::delta)pFAT->storedSize + (stream::delta)pFAT->lenHeader),
-		-1
+		this->relocatable ? 0 : -1
 	);
 
 	// Remove the file's data from the archive
@@ -284,6 +366,35 @@ void Archive_FAT::remove(const FileHandle& id)
 	return;
 }
 
+Archive::FileVector Archive_FAT::insertMany(const std::vector<NewFile>& files)
+{
+	// TESTED BY: fmt_grp_duke3d_insert_many
+	FileVector added;
+	this->beginBatch();
+	try {
+		added = this->Archive::insertMany(files);
+	} catch (const stream::error&) {
+		this->endBatch();
+		throw;
+	}
+	this->endBatch();
+	return added;
+}
+
+void Archive_FAT::removeMany(const FileVector& ids)
+{
+	// TESTED BY: fmt_grp_duke3d_remove_many
+	this->beginBatch();
+	try {
+		this->Archive::removeMany(ids);
+	} catch (const stream::error&) {
+		this->endBatch();
+		throw;
+	}
+	this->endBatch();
+	return;
+}
+
 void Archive_FAT::rename(const FileHandle& id, const std::string& strNewName)
 {
 	// TESTED BY: fmt_grp_duke3d_rename
@@ -306,6 +417,8 @@ void Archive_FAT::rename(const FileHandle& id, const std::string& strNewName)
 
 void Archive_FAT::move(const FileHandle& idBeforeThis, const FileHandle& id)
 {
+	// This copies the whole file and shifts everything after both positions, so
+	// formats that can should override it with moveFATEntry() or moveData().
 	// Open the file we want to move
 	auto src = this->open(id, false);
 	assert(src);
@@ -347,10 +460,14 @@ void Archive_FAT::resize(const FileHandle& id, stream::len newStoredSize,
 	auto pFAT = FATEntry::cast(id);
 	stream::delta iDelta = newStoredSize - id->storedSize;
 
+	// Needed before the sizes change, to tell whether this file is the last one
+	stream::pos offDataEnd = this->endOfData(pFAT);
+
 	stream::len oldStoredSize = pFAT->storedSize;
 	stream::len oldRealSize = pFAT->realSize;
 	pFAT->storedSize = newStoredSize;
 	pFAT->realSize = newRealSize;
+	pFAT->generation++;
 
 	try {
 		// Update the FAT with the file's new sizes
@@ -362,6 +479,56 @@ void Archive_FAT::resize(const FileHandle& id, stream::len newStoredSize,
 		throw;
 	}
 
+	if (this->freeSpace && (iDelta != 0)) {
+		stream::pos offOldEnd = pFAT->iOffset + pFAT->lenHeader + oldStoredSize;
+		if (iDelta < 0) {
+			// Leave the unused space behind as a gap
+			this->release(offOldEnd + iDelta, -iDelta);
+			return;
+		}
+
+		// iDelta must be positive by this point
+		assert(iDelta > 0);
+		stream::len lenGrow = iDelta;
+
+		auto itFree = this->freeExtents.find(offOldEnd);
+		if ((itFree != this->freeExtents.end()) && (itFree->second >= lenGrow)) {
+			// There's a big enough gap straight after the file, so grow into it
+			stream::len lenLeft = itFree->second - lenGrow;
+			this->freeExtents.erase(itFree);
+			if (lenLeft) this->freeExtents[offOldEnd + lenGrow] = lenLeft;
+			this->zeroContent(offOldEnd, lenGrow);
+			return;
+		}
+
+		if (offOldEnd < offDataEnd) {
+			// Other files follow, so move the data somewhere with enough room
+			// rather than shifting all of them.
+			stream::pos offOld = pFAT->iOffset;
+			stream::len lenOld = pFAT->lenHeader + oldStoredSize;
+			stream::pos offNew = this->allocate(pFAT->lenHeader + newStoredSize,
+				pFAT);
+
+			std::vector<char> buf(std::min<stream::len>(lenOld, 65536));
+			for (stream::len done = 0; done < lenOld; ) {
+				stream::len lenChunk = std::min<stream::len>(lenOld - done,
+					buf.size());
+				this->content->seekg(offOld + done, stream::start);
+				this->content->read(buf.data(), lenChunk);
+				this->content->seekp(offNew + done, stream::start);
+				this->content->write(buf.data(), lenChunk);
+				done += lenChunk;
+			}
+			this->zeroContent(offNew + lenOld, iDelta);
+
+			pFAT->iOffset = offNew;
+			this->updateFileOffset(pFAT, offNew - offOld);
+			this->release(offOld, lenOld);
+			return;
+		}
+		// Otherwise this is the last file, so just make it larger as normal.
+	}
+
 	// Add or remove the data in the underlying stream
 	stream::pos iStart;
 	if (iDelta > 0) { // inserting data
@@ -396,6 +563,376 @@ void Archive_FAT::flush()
 	return;
 }
 
+bool Archive_FAT::enableFreeSpace()
+{
+	if (!this->relocatable) return false;
+	this->freeSpace = true;
+	return true;
+}
+
+void Archive_FAT::compact()
+{
+	// Start from the end so the offsets of the remaining gaps are unaffected
+	while (!this->freeExtents.empty()) {
+		auto itLast = std::prev(this->freeExtents.end());
+		stream::pos off = itLast->first;
+		stream::len len = itLast->second;
+		this->freeExtents.erase(itLast);
+
+		this->shiftFiles(NULL, off + len, -(stream::delta)len, 0);
+		this->content->seekp(off, stream::start);
+		this->content->remove(len);
+	}
+	return;
+}
+
+void Archive_FAT::readRaw(stream::pos off, uint8_t *buffer, stream::len len)
+	const
+{
+	this->content->seekg(off, stream::start);
+	this->content->read(buffer, len);
+	return;
+}
+
+void Archive_FAT::writeIndex(stream::output& index) const
+{
+	index << u32le(this->vcFAT.size());
+	for (const auto& i : this->vcFAT) {
+		auto pFAT = FATEntry::cast(i);
+		index
+			<< u32le(pFAT->iIndex)
+			<< u32le(pFAT->iOffset)
+			<< u32le(pFAT->lenHeader)
+			<< u32le(pFAT->storedSize)
+			<< u32le(pFAT->realSize)
+			<< u32le((unsigned int)pFAT->fAttr)
+			<< nullTerminated(pFAT->strName, FAT_INDEX_MAX_STRING)
+			<< nullTerminated(pFAT->type, FAT_INDEX_MAX_STRING)
+			<< nullTerminated(pFAT->filter, FAT_INDEX_MAX_STRING)
+		;
+	}
+	return;
+}
+
+bool Archive_FAT::readIndex(stream::input& index)
+{
+	stream::len lenArchive = this->content->size();
+	FileVector files;
+	try {
+		uint32_t numFiles;
+		index >> u32le(numFiles);
+		if (numFiles > FAT_INDEX_MAX_FILES) return false;
+		for (unsigned int i = 0; i < numFiles; i++) {
+			auto f = this->createNewFATEntry();
+			uint32_t attr;
+			index
+				>> u32le(f->iIndex)
+				>> u32le(f->iOffset)
+				>> u32le(f->lenHeader)
+				>> u32le(f->storedSize)
+				>> u32le(f->realSize)
+				>> u32le(attr)
+				>> nullTerminated(f->strName, FAT_INDEX_MAX_STRING)
+				>> nullTerminated(f->type, FAT_INDEX_MAX_STRING)
+				>> nullTerminated(f->filter, FAT_INDEX_MAX_STRING)
+			;
+			f->fAttr = (File::Attribute)attr;
+			f->bValid = true;
+			if (f->iOffset + f->lenHeader + f->storedSize > lenArchive) {
+				// Index doesn't belong to this archive
+				return false;
+			}
+			files.push_back(std::move(f));
+		}
+	} catch (const stream::error&) {
+		return false;
+	}
+	this->vcFAT = std::move(files);
+	return true;
+}
+
+stream::pos Archive_FAT::endOfData(const FATEntry *fatSkip) const
+{
+	stream::pos offEnd = this->offFirstFile;
+	bool first = true;
+	for (const auto& i : this->vcFAT) {
+		auto pFAT = dynamic_cast<const FATEntry *>(&*i);
+		if (pFAT == fatSkip) continue;
+		stream::pos offFileEnd = pFAT->iOffset + pFAT->lenHeader + pFAT->storedSize;
+		if (first || (offFileEnd > offEnd)) offEnd = offFileEnd;
+		first = false;
+	}
+	return offEnd;
+}
+
+stream::pos Archive_FAT::allocate(stream::len len, const FATEntry *fatSkip)
+{
+	stream::pos offEnd = this->endOfData(fatSkip);
+	if (len == 0) return offEnd;
+
+	for (auto i = this->freeExtents.begin(); i != this->freeExtents.end(); i++) {
+		if (i->second < len) continue;
+		stream::pos off = i->first;
+		stream::len lenLeft = i->second - len;
+		this->freeExtents.erase(i);
+		if (lenLeft) this->freeExtents[off + len] = lenLeft;
+		return off;
+	}
+
+	// No gaps large enough, so add the space after the last file.  This will
+	// only move anything that follows the file data, like a trailing FAT.
+	this->shiftFiles(fatSkip, offEnd, len, 0);
+	this->content->seekp(offEnd, stream::start);
+	this->content->insert(len);
+	return offEnd;
+}
+
+void Archive_FAT::release(stream::pos off, stream::len len)
+{
+	if (len == 0) return;
+
+	// Merge with the gaps either side
+	auto itNext = this->freeExtents.lower_bound(off);
+	if ((itNext != this->freeExtents.end()) && (itNext->first == off + len)) {
+		len += itNext->second;
+		itNext = this->freeExtents.erase(itNext);
+	}
+	if (itNext != this->freeExtents.begin()) {
+		auto itPrev = std::prev(itNext);
+		if (itPrev->first + itPrev->second == off) {
+			off = itPrev->first;
+			len += itPrev->second;
+			this->freeExtents.erase(itPrev);
+		}
+	}
+
+	stream::pos offEnd = this->endOfData(NULL);
+	if (off + len >= offEnd) {
+		// Nothing follows the gap, so it can be removed without moving any files
+		this->shiftFiles(NULL, off + len, -(stream::delta)len, 0);
+		this->content->seekp(off, stream::start);
+		this->content->remove(len);
+	} else {
+		this->freeExtents[off] = len;
+	}
+	return;
+}
+
+void Archive_FAT::zeroContent(stream::pos off, stream::len len)
+{
+	if (len == 0) return;
+	std::vector<char> zero(std::min<stream::len>(len, 65536), 0);
+	this->content->seekp(off, stream::start);
+	while (len > 0) {
+		stream::len lenChunk = std::min<stream::len>(len, zero.size());
+		this->content->write(zero.data(), lenChunk);
+		len -= lenChunk;
+	}
+	return;
+}
+
+void Archive_FAT::beginBatch()
+{
+	assert(!this->batch);
+	this->batch = true;
+	return;
+}
+
+void Archive_FAT::endBatch()
+{
+	this->batch = false;
+
+	std::map<FileHandle, stream::delta> pending;
+	pending.swap(this->pendingOffsets);
+	for (const auto& i : pending) {
+		// Skip files that were removed, or that ended up back where they started
+		if ((!i.first->bValid) || (i.second == 0)) continue;
+		this->updateFileOffset(FATEntry::cast(i.first), i.second);
+	}
+	return;
+}
+
+void Archive_FAT::moveFATEntry(const FileHandle& idBeforeThis,
+	const FileHandle& id, stream::inout& fat, stream::pos offFAT,
+	stream::len lenEntry)
+{
+	assert(this->isValid(id));
+	auto pFAT = FATEntry::cast(id);
+
+	unsigned int indexOld = pFAT->iIndex;
+	if (!this->reorderEntry(idBeforeThis, id)) return;
+	unsigned int indexNew = pFAT->iIndex;
+
+	unsigned int indexFirst = std::min(indexOld, indexNew);
+	unsigned int indexLast = std::max(indexOld, indexNew);
+
+	// Rotate the on-disk entries by one place
+	std::string entries;
+	fat.seekg(offFAT + indexFirst * lenEntry, stream::start);
+	fat >> fixedLength(entries, (indexLast - indexFirst + 1) * lenEntry);
+	if (indexOld < indexNew) {
+		std::rotate(entries.begin(), entries.begin() + lenEntry, entries.end());
+	} else {
+		std::rotate(entries.begin(), entries.end() - lenEntry, entries.end());
+	}
+	fat.seekp(offFAT + indexFirst * lenEntry, stream::start);
+	fat.write(entries);
+	return;
+}
+
+bool Archive_FAT::reorderEntry(const FileHandle& idBeforeThis,
+	const FileHandle& id)
+{
+	assert(this->isValid(id));
+	auto pFAT = FATEntry::cast(id);
+
+	// Work out where the entry ends up once it has been taken out of the list
+	unsigned int indexOld = pFAT->iIndex;
+	unsigned int indexNew;
+	if (this->isValid(idBeforeThis)) {
+		indexNew = FATEntry::cast(idBeforeThis)->iIndex;
+		if (indexNew > indexOld) indexNew--;
+	} else {
+		indexNew = this->vcFAT.size() - 1;
+	}
+	if (indexNew == indexOld) return false;
+
+	unsigned int indexFirst = std::min(indexOld, indexNew);
+	unsigned int indexLast = std::max(indexOld, indexNew);
+
+	// Renumber everything in between
+	for (auto& i : this->vcFAT) {
+		auto pFATOther = FATEntry::cast(i);
+		if ((pFATOther->iIndex < indexFirst) || (pFATOther->iIndex > indexLast)) {
+			continue;
+		}
+		if (pFATOther == pFAT) {
+			pFATOther->iIndex = indexNew;
+		} else if (indexOld < indexNew) {
+			pFATOther->iIndex--;
+		} else {
+			pFATOther->iIndex++;
+		}
+	}
+
+	// Keep the vector in FAT order
+	auto itOld = std::find(this->vcFAT.begin(), this->vcFAT.end(), id);
+	assert(itOld != this->vcFAT.end());
+	auto itNew = this->vcFAT.begin() + indexNew;
+	if (itOld < itNew) {
+		std::rotate(itOld, itOld + 1, itNew + 1);
+	} else {
+		std::rotate(itNew, itOld, itOld + 1);
+	}
+	return true;
+}
+
+void Archive_FAT::moveData(const FileHandle& idBeforeThis,
+	const FileHandle& id)
+{
+	assert(this->isValid(id));
+	auto pFAT = FATEntry::cast(id);
+	stream::pos offSrc = pFAT->iOffset;
+	stream::len lenSrc = pFAT->lenHeader + pFAT->storedSize;
+
+	stream::pos offDest;
+	if (this->isValid(idBeforeThis)) {
+		offDest = FATEntry::cast(idBeforeThis)->iOffset;
+	} else {
+		offDest = this->endOfData(NULL);
+	}
+
+	// The files in between move the other way by the size of the moved file
+	stream::pos offFirst, offEnd;
+	stream::delta deltaOthers;
+	if (offDest < offSrc) {
+		this->rotateContent(offDest, offSrc - offDest, lenSrc);
+		offFirst = offDest;
+		offEnd = offSrc;
+		deltaOthers = lenSrc;
+		pFAT->iOffset = offDest;
+	} else if (offDest > offSrc + lenSrc) {
+		this->rotateContent(offSrc, lenSrc, offDest - offSrc - lenSrc);
+		offFirst = offSrc + lenSrc;
+		offEnd = offDest;
+		deltaOthers = -(stream::delta)lenSrc;
+		pFAT->iOffset = offDest - lenSrc;
+	} else {
+		// Already in place
+		return;
+	}
+
+	for (auto& i : this->vcFAT) {
+		auto pFATOther = FATEntry::cast(i);
+		stream::delta delta;
+		if (pFATOther == pFAT) {
+			delta = (stream::delta)pFAT->iOffset - offSrc;
+		} else if ((pFATOther->iOffset >= offFirst) && (pFATOther->iOffset < offEnd)) {
+			pFATOther->iOffset += deltaOthers;
+			delta = deltaOthers;
+		} else {
+			continue;
+		}
+		if (this->batch) {
+			this->pendingOffsets[i] += delta;
+		} else {
+			this->updateFileOffset(pFATOther, delta);
+		}
+	}
+
+	// Any gaps being tracked move along with the files
+	if (!this->freeExtents.empty()) {
+		std::map<stream::pos, stream::len> gaps;
+		for (const auto& i : this->freeExtents) {
+			if ((i.first >= offFirst) && (i.first < offEnd)) {
+				gaps[i.first + deltaOthers] = i.second;
+			} else {
+				gaps[i.first] = i.second;
+			}
+		}
+		this->freeExtents.swap(gaps);
+	}
+	return;
+}
+
+void Archive_FAT::rotateContent(stream::pos off, stream::len lenFirst,
+	stream::len lenSecond)
+{
+	if ((lenFirst == 0) || (lenSecond == 0)) return;
+
+	// Hold the smaller block in memory, slide the larger one over into its
+	// place, then write the smaller one into the space left behind.
+	bool firstSmaller = lenFirst <= lenSecond;
+	stream::len lenKeep = firstSmaller ? lenFirst : lenSecond;
+	stream::len lenSlide = firstSmaller ? lenSecond : lenFirst;
+	std::vector<uint8_t> keep(lenKeep);
+	this->readRaw(firstSmaller ? off : off + lenFirst, keep.data(), lenKeep);
+
+	std::vector<uint8_t> buf(std::min<stream::len>(lenSlide, 65536));
+	for (stream::len done = 0; done < lenSlide; ) {
+		stream::len lenChunk = std::min<stream::len>(lenSlide - done, buf.size());
+		stream::pos offFrom, offTo;
+		if (firstSmaller) {
+			// Second block moves back, so copy from the front to avoid
+			// overwriting anything not yet copied
+			offFrom = off + lenFirst + done;
+			offTo = off + done;
+		} else {
+			// First block moves forward, so copy from the end
+			offFrom = off + lenFirst - done - lenChunk;
+			offTo = off + lenFirst + lenSecond - done - lenChunk;
+		}
+		this->readRaw(offFrom, buf.data(), lenChunk);
+		this->content->seekp(offTo, stream::start);
+		this->content->write(buf.data(), lenChunk);
+		done += lenChunk;
+	}
+
+	this->content->seekp(firstSmaller ? off + lenSecond : off, stream::start);
+	this->content->write(keep.data(), lenKeep);
+	return;
+}
+
 void Archive_FAT::shiftFiles(const FATEntry *fatSkip, stream::pos offStart,
 	stream::delta deltaOffset, int deltaIndex)
 {
@@ -411,8 +948,25 @@ void Archive_FAT::shiftFiles(const FATEntry *fatSkip, stream::pos offStart,
 			// ensure the right place in the file gets changed.
 			pFAT->iIndex += deltaIndex;
 
-			this->updateFileOffset(pFAT, deltaOffset);
+			if (this->batch) {
+				this->pendingOffsets[i] += deltaOffset;
+			} else {
+				this->updateFileOffset(pFAT, deltaOffset);
+			}
+		}
+	}
+
+	// Any gaps being tracked move along with the files
+	if ((deltaOffset != 0) && !this->freeExtents.empty()) {
+		std::map<stream::pos, stream::len> moved;
+		for (const auto& i : this->freeExtents) {
+			if (i.first >= offStart) {
+				moved[i.first + deltaOffset] = i.second;
+			} else {
+				moved[i.first] = i.second;
+			}
 		}
+		this->freeExtents.swap(moved);
 	}
 	return;
 }
@@ -20,11 +20,13 @@
 
 #include <camoto/util.hpp>
 #include <camoto/gamearchive/archive.hpp>
+#include <camoto/gamearchive/manager.hpp>
 
 namespace camoto {
 namespace gamearchive {
 
 Archive::File::File()
+	:	generation(0)
 {
 }
 
@@ -49,5 +51,54 @@ Archive::File::Attribute Archive::getSupportedAttributes() const
 	return File::Attribute::Default;
 }
 
+std::string Archive::peek(const FileHandle& id, stream::len len)
+{
+	std::unique_ptr<stream::input> content = this->open(id, false);
+	if (!id->filter.empty()) {
+		auto pFilterType = FilterManager::byCode(id->filter);
+		if (!pFilterType) {
+			throw stream::error(createString(
+				"could not find filter \"" << id->filter << "\""
+			));
+		}
+		// The input-only streams decode on demand, unlike the read/write ones
+		// returned by open(id, true) which decode everything up front.
+		content = pFilterType->apply(std::move(content));
+	}
+
+	std::string data(len, '\0');
+	stream::len lenRead = 0;
+	while (lenRead < len) {
+		stream::len r = content->try_read(
+			reinterpret_cast<uint8_t *>(&data[lenRead]), len - lenRead);
+		if (r == 0) break;
+		lenRead += r;
+	}
+	data.resize(lenRead);
+	return data;
+}
+
+Archive::FileVector Archive::insertMany(const std::vector<NewFile>& files)
+{
+	FileVector added;
+	try {
+		for (const auto& i : files) {
+			added.push_back(this->insert(i.idBeforeThis, i.strFilename,
+				i.storedSize, i.type, i.attr));
+		}
+	} catch (const stream::error&) {
+		// Put things back the way they were
+		for (const auto& i : added) this->remove(i);
+		throw;
+	}
+	return added;
+}
+
+void Archive::removeMany(const FileVector& ids)
+{
+	for (const auto& i : ids) this->remove(i);
+	return;
+}
+
 } // namespace gamearchive
 } // namespace camoto
@@ -0,0 +1,220 @@
+/**
+ * @file  archive_cache.cpp
+ * @brief Share opened archives between everything reading the same file.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+#include <sys/stat.h>
+#include <camoto/stream_file.hpp>
+#include <camoto/stream_string.hpp>
+#include <camoto/util.hpp>
+#include <camoto/gamearchive/archive_cache.hpp>
+#include <camoto/gamearchive/stream_readonly.hpp>
+
+namespace camoto {
+namespace gamearchive {
+
+SharedArchive::SharedArchive(std::shared_ptr<Archive> archive,
+	ArchiveManager::handler_t type)
+	:	archive(archive),
+		archType(type),
+		lock(std::make_shared<std::mutex>())
+{
+}
+
+SharedArchive::SharedArchive(std::shared_ptr<Archive> archive,
+	ArchiveManager::handler_t type, std::shared_ptr<std::mutex> lock)
+	:	archive(archive),
+		archType(type),
+		lock(lock)
+{
+}
+
+ArchiveManager::handler_t SharedArchive::type() const
+{
+	return this->archType;
+}
+
+const Archive::FileVector& SharedArchive::files() const
+{
+	return this->archive->files();
+}
+
+const Archive::FileHandle SharedArchive::find(const std::string& strFilename)
+	const
+{
+	return this->archive->find(strFilename);
+}
+
+std::shared_ptr<SharedArchive> SharedArchive::openFolder(
+	const Archive::FileHandle& id) const
+{
+	std::lock_guard<std::mutex> l(*this->lock);
+	// Can't use make_shared as the constructor is protected
+	return std::shared_ptr<SharedArchive>(new SharedArchive(
+		this->archive->openFolder(id), this->archType, this->lock));
+}
+
+std::unique_ptr<stream::input> SharedArchive::open(
+	const Archive::FileHandle& id) const
+{
+	stream::string buffer;
+	{
+		std::lock_guard<std::mutex> l(*this->lock);
+		auto content = this->archive->open(id, true);
+		stream::copy(buffer, *content);
+	}
+	return std::make_unique<input_shared_buffer>(
+		std::make_shared<const std::string>(std::move(buffer.data)));
+}
+
+bool ArchiveCache::Key::operator< (const Key& b) const
+{
+	return std::tie(this->dev, this->ino, this->mtime, this->mtime_nsec,
+		this->size, this->type)
+		< std::tie(b.dev, b.ino, b.mtime, b.mtime_nsec, b.size, b.type);
+}
+
+ArchiveCache::ArchiveCache(unsigned int maxIdle)
+	:	maxIdle(maxIdle),
+		useCounter(0)
+{
+}
+
+ArchiveCache::~ArchiveCache()
+{
+}
+
+std::shared_ptr<SharedArchive> ArchiveCache::open(const std::string& filename,
+	ArchiveManager::handler_t type)
+{
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0) {
+		throw stream::open_error(createString(
+			"Unable to access " << filename
+		));
+	}
+	Key key;
+	key.dev = st.st_dev;
+	key.ino = st.st_ino;
+	key.mtime = st.st_mtime;
+#ifdef __linux__
+	key.mtime_nsec = st.st_mtim.tv_nsec;
+#else
+	key.mtime_nsec = 0;
+#endif
+	key.size = st.st_size;
+	if (type) key.type = type->code();
+
+	{
+		std::lock_guard<std::mutex> l(this->lock);
+		auto it = this->entries.find(key);
+		if (it != this->entries.end()) {
+			it->second.lastUsed = ++this->useCounter;
+			return it->second.archive;
+		}
+	}
+
+	// Not cached, so open it.  This is done without holding the lock, so other
+	// threads can use the cache in the meantime.
+	auto content = std::make_unique<stream::input_file>(filename);
+	if (!type) {
+		auto results = probeFormats(*content);
+		if (
+			results.empty()
+			|| (results.back().certainty != ArchiveType::Certainty::DefinitelyYes)
+		) {
+			throw stream::error(createString(
+				"Unable to identify the format of " << filename
+			));
+		}
+		type = results.back().type;
+	}
+
+	SuppData suppData;
+	for (const auto& s : type->getRequiredSupps(*content, filename)) {
+		suppData[s.first] = std::make_unique<inout_readonly>(
+			std::make_unique<stream::input_file>(s.second));
+	}
+	auto shared = std::make_shared<SharedArchive>(
+		type->openReadOnly(std::move(content), suppData), type);
+
+	std::lock_guard<std::mutex> l(this->lock);
+	// Another thread may have opened the same file in the meantime, in which
+	// case use theirs so everyone gets the same instance.
+	auto& entry = this->entries[key];
+	if (!entry.archive) entry.archive = shared;
+	entry.lastUsed = ++this->useCounter;
+	// Take a reference before trimming, as it may erase this entry (if it is
+	// idle and the oldest) which would leave nothing to return.
+	auto archive = entry.archive;
+	this->trim();
+	return archive;
+}
+
+void ArchiveCache::clear()
+{
+	std::lock_guard<std::mutex> l(this->lock);
+	for (auto it = this->entries.begin(); it != this->entries.end(); ) {
+		auto itNext = std::next(it);
+		if (it->second.archive.use_count() == 1) this->entries.erase(it);
+		it = itNext;
+	}
+	return;
+}
+
+void ArchiveCache::setMaxIdle(unsigned int maxIdle)
+{
+	std::lock_guard<std::mutex> l(this->lock);
+	this->maxIdle = maxIdle;
+	this->trim();
+	return;
+}
+
+unsigned int ArchiveCache::size() const
+{
+	std::lock_guard<std::mutex> l(this->lock);
+	return this->entries.size();
+}
+
+void ArchiveCache::trim()
+{
+	// An archive is idle when the cache holds the only reference to it
+	std::vector<std::map<Key, Entry>::iterator> idle;
+	for (auto it = this->entries.begin(); it != this->entries.end(); it++) {
+		if (it->second.archive.use_count() == 1) idle.push_back(it);
+	}
+	if (idle.size() <= this->maxIdle) return;
+
+	// Drop the ones that were used longest ago
+	std::sort(idle.begin(), idle.end(),
+		[](const std::map<Key, Entry>::iterator& a,
+			const std::map<Key, Entry>::iterator& b) {
+			return a->second.lastUsed < b->second.lastUsed;
+		}
+	);
+	for (unsigned int i = 0; i < idle.size() - this->maxIdle; i++) {
+		this->entries.erase(idle[i]);
+	}
+	return;
+}
+
+} // namespace gamearchive
+} // namespace camoto
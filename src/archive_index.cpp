@@ -0,0 +1,132 @@
+/**
+ * @file  archive_index.cpp
+ * @brief Keep a saved copy of an archive's file list on disk.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <sys/stat.h>
+#include <camoto/iostream_helpers.hpp>
+#include <camoto/stream_file.hpp>
+#include <camoto/util.hpp>
+#include <camoto/gamearchive/archive-fat.hpp>
+#include <camoto/gamearchive/archive_index.hpp>
+
+/// Signature at the start of every index file.
+#define INDEX_SIGNATURE      "Camoto archive index v1"
+
+/// Maximum length of the signature and key strings in an index file.
+#define INDEX_MAX_KEY        8192
+
+/// Number of bytes at each end of the archive included in the hash.
+#define INDEX_HASH_LEN       4096
+
+namespace camoto {
+namespace gamearchive {
+
+/// Work out a string that will change if the archive file changes.
+/**
+ * @return The key, or an empty string if the file's details couldn't be
+ *   obtained, in which case no index should be used.
+ */
+static std::string indexKey(const ArchiveType& type, stream::input& content,
+	const std::string& filename)
+{
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0) return std::string();
+#ifdef __linux__
+	long mtimeNsec = st.st_mtim.tv_nsec;
+#else
+	long mtimeNsec = 0;
+#endif
+
+	// Hash the start and end of the file, to catch any changes made without
+	// altering the size, within the resolution of the modification time.
+	stream::len lenArchive = content.size();
+	uint64_t hash = 14695981039346656037ULL; // FNV-1a
+	std::vector<uint8_t> block(INDEX_HASH_LEN);
+	auto hashBlock = [&](stream::pos off, stream::len len) {
+		content.seekg(off, stream::start);
+		content.read(block.data(), len);
+		for (stream::len i = 0; i < len; i++) {
+			hash ^= block[i];
+			hash *= 1099511628211ULL;
+		}
+		return;
+	};
+	stream::len lenHead = std::min<stream::len>(lenArchive, INDEX_HASH_LEN);
+	hashBlock(0, lenHead);
+	stream::len lenTail = std::min<stream::len>(lenArchive - lenHead,
+		INDEX_HASH_LEN);
+	if (lenTail) hashBlock(lenArchive - lenTail, lenTail);
+
+	return createString(type.code() << '\n' << filename << '\n' << lenArchive
+		<< '\n' << st.st_mtime << '.' << mtimeNsec << '\n'
+		<< std::hex << hash);
+}
+
+std::shared_ptr<Archive> openWithIndex(const ArchiveType& type,
+	std::unique_ptr<stream::inout> content, SuppData& suppData,
+	const std::string& filename, const std::string& indexFilename)
+{
+	if (!type.walksFAT()) return type.open(std::move(content), suppData);
+
+	std::string key = indexKey(type, *content, filename);
+	if (key.empty()) return type.open(std::move(content), suppData);
+
+	std::unique_ptr<stream::input_file> index;
+	try {
+		index = std::make_unique<stream::input_file>(indexFilename);
+		std::string sig, savedKey;
+		*index
+			>> nullTerminated(sig, INDEX_MAX_KEY)
+			>> nullTerminated(savedKey, INDEX_MAX_KEY)
+		;
+		if ((sig.compare(INDEX_SIGNATURE) != 0) || (savedKey.compare(key) != 0)) {
+			// Index is for a different file, or the file has changed since
+			index.reset();
+		}
+	} catch (const stream::error&) {
+		// No index yet, or it can't be read
+		index.reset();
+	}
+	if (index) return type.openIndexed(std::move(content), suppData, *index);
+
+	auto archive = type.open(std::move(content), suppData);
+
+	// Save the file list for next time
+	auto archFAT = std::dynamic_pointer_cast<Archive_FAT>(archive);
+	if (archFAT) {
+		try {
+			std::string sig = INDEX_SIGNATURE;
+			stream::output_file out(indexFilename, true);
+			out
+				<< nullTerminated(sig, INDEX_MAX_KEY)
+				<< nullTerminated(key, INDEX_MAX_KEY)
+			;
+			archFAT->writeIndex(out);
+			out.flush();
+		} catch (const stream::error&) {
+			// The index is only there to save time, so it doesn't matter if it
+			// can't be written.
+		}
+	}
+	return archive;
+}
+
+} // namespace gamearchive
+} // namespace camoto
@@ -19,11 +19,67 @@
  */
 
 #include <iostream>
+#include <camoto/stream_string.hpp>
+#include <camoto/util.hpp> // std::make_unique
 #include <camoto/gamearchive/archivetype.hpp>
+#include <camoto/gamearchive/stream_readonly.hpp>
 
 using namespace camoto;
 using namespace camoto::gamearchive;
 
+std::vector<ArchiveType::Signature> ArchiveType::signatures() const
+{
+	return {};
+}
+
+std::shared_ptr<Archive> ArchiveType::openReadOnly(
+	std::unique_ptr<stream::input> content, SuppData& suppData) const
+{
+	return this->open(std::make_unique<inout_readonly>(std::move(content)),
+		suppData);
+}
+
+bool ArchiveType::walksFAT() const
+{
+	return false;
+}
+
+std::shared_ptr<Archive> ArchiveType::openIndexed(
+	std::unique_ptr<stream::inout> content, SuppData& suppData,
+	stream::input& index) const
+{
+	return this->open(std::move(content), suppData);
+}
+
+void ArchiveType::write(stream::output& content,
+	const std::vector<FileData>& files, SuppData& suppData) const
+{
+	// No sequential writer for this format, so build the archive the normal way
+	// and copy it out at the end.
+	auto buffer = std::make_unique<stream::string>();
+	stream::string *pBuffer = buffer.get();
+	auto pArchive = this->create(std::move(buffer), suppData);
+
+	std::vector<Archive::NewFile> newFiles;
+	for (const auto& i : files) {
+		newFiles.push_back({nullptr, i.strFilename, i.content->size(), i.type,
+			i.attr});
+	}
+	auto ids = pArchive->insertMany(newFiles);
+
+	for (unsigned int n = 0; n < ids.size(); n++) {
+		auto dst = pArchive->open(ids[n], true);
+		files[n].content->seekg(0, stream::start);
+		stream::copy(*dst, *files[n].content);
+		dst->flush();
+	}
+	pArchive->flush();
+
+	content.write(pBuffer->data);
+	content.flush();
+	return;
+}
+
 CAMOTO_GAMEARCHIVE_API std::ostream& camoto::gamearchive::operator<< (
 	std::ostream& s, const ArchiveType::Certainty& r)
 {
@@ -0,0 +1,147 @@
+/**
+ * @file  decode_cache.cpp
+ * @brief Keep recently used file data in memory after decompression.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <camoto/stream_string.hpp>
+#include <camoto/util.hpp>
+#include <camoto/gamearchive/decode_cache.hpp>
+#include <camoto/gamearchive/stream_readonly.hpp>
+
+namespace camoto {
+namespace gamearchive {
+
+DecodeCache::DecodeCache(stream::len budget)
+	:	budget(budget),
+		used(0)
+{
+}
+
+DecodeCache::~DecodeCache()
+{
+}
+
+std::unique_ptr<stream::input> DecodeCache::open(
+	std::shared_ptr<Archive> archive, const Archive::FileHandle& id)
+{
+	Key key(archive.get(), id.get());
+	{
+		std::lock_guard<std::mutex> l(this->lock);
+		auto it = this->index.find(key);
+		if (it != this->index.end()) {
+			auto& entry = *it->second;
+			// Make sure this isn't a different archive or file that happens to
+			// be at the same address as one that has since been destroyed.
+			if (
+				(entry.archive.lock() == archive)
+				&& (entry.id.lock() == id)
+				&& (entry.generation == id->generation)
+			) {
+				// Move to the front of the list as the most recently used
+				this->lru.splice(this->lru.begin(), this->lru, it->second);
+				return std::make_unique<input_shared_buffer>(entry.data);
+			}
+			// The file has changed since it was cached
+			this->erase(it);
+		}
+	}
+
+	// Not cached, so decode it.  This is done without holding the lock, so
+	// other threads can use the cache in the meantime.
+	unsigned long generation = id->generation;
+	auto content = archive->open(id, true);
+	stream::string buffer;
+	stream::copy(buffer, *content);
+	auto data = std::make_shared<const std::string>(std::move(buffer.data));
+
+	{
+		std::lock_guard<std::mutex> l(this->lock);
+		if (data->length() <= this->budget) {
+			// Another thread may have cached the same file in the meantime
+			auto it = this->index.find(key);
+			if (it != this->index.end()) this->erase(it);
+
+			Entry entry;
+			entry.key = key;
+			entry.archive = archive;
+			entry.id = id;
+			entry.generation = generation;
+			entry.data = data;
+			this->lru.push_front(entry);
+			this->index[key] = this->lru.begin();
+			this->used += data->length();
+			this->trim();
+		}
+	}
+	return std::make_unique<input_shared_buffer>(data);
+}
+
+void DecodeCache::invalidate(const Archive::FileHandle& id)
+{
+	std::lock_guard<std::mutex> l(this->lock);
+	// The same file could be listed under more than one archive address if
+	// an archive was destroyed and a new one opened, so check every entry.
+	for (auto it = this->index.begin(); it != this->index.end(); ) {
+		auto itNext = std::next(it);
+		if (it->first.second == id.get()) this->erase(it);
+		it = itNext;
+	}
+	return;
+}
+
+void DecodeCache::clear()
+{
+	std::lock_guard<std::mutex> l(this->lock);
+	this->index.clear();
+	this->lru.clear();
+	this->used = 0;
+	return;
+}
+
+void DecodeCache::setBudget(stream::len budget)
+{
+	std::lock_guard<std::mutex> l(this->lock);
+	this->budget = budget;
+	this->trim();
+	return;
+}
+
+stream::len DecodeCache::size() const
+{
+	std::lock_guard<std::mutex> l(this->lock);
+	return this->used;
+}
+
+void DecodeCache::trim()
+{
+	while ((this->used > this->budget) && !this->lru.empty()) {
+		this->erase(this->index.find(this->lru.back().key));
+	}
+	return;
+}
+
+void DecodeCache::erase(std::map<Key, std::list<Entry>::iterator>::iterator it)
+{
+	this->used -= it->second->data->length();
+	this->lru.erase(it->second);
+	this->index.erase(it);
+	return;
+}
+
+} // namespace gamearchive
+} // namespace camoto
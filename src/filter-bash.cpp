@@ -24,6 +24,7 @@
 #include <camoto/iostream_helpers.hpp>
 #include <camoto/stream_filtered.hpp>
 #include <camoto/util.hpp> // std::make_unique
+#include <camoto/gamearchive/stream_checkpoint.hpp>
 #include <camoto/filter-lzw.hpp>
 
 #include "filter-bash-rle.hpp"
@@ -96,7 +97,7 @@ std::unique_ptr<stream::inout> FilterType_Bash::apply(
 std::unique_ptr<stream::input> FilterType_Bash::apply(
 	std::unique_ptr<stream::input> target) const
 {
-	auto st1 = std::make_unique<stream::input_filtered>(
+	auto st1 = std::make_unique<input_checkpointed>(
 		std::move(target),
 		std::make_shared<filter_lzw_decompress>(
 			9,   // initial codeword length (in bits)
@@ -109,7 +110,7 @@ std::unique_ptr<stream::input> FilterType_Bash::apply(
 		)
 	);
 
-	return std::make_unique<stream::input_filtered>(
+	return std::make_unique<input_checkpointed>(
 		std::move(st1),
 		std::make_shared<filter_bash_unrle>()
 	);
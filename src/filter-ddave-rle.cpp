@@ -26,6 +26,7 @@
 #include <camoto/stream_filtered.hpp>
 #include <camoto/util.hpp> // std::make_unique
 #include <camoto/gamearchive/filtertype.hpp>
+#include <camoto/gamearchive/stream_checkpoint.hpp>
 #include "filter-ddave-rle.hpp"
 #include "filter-decomp-size.hpp"
 
@@ -283,7 +284,7 @@ std::unique_ptr<stream::inout> FilterType_DDaveRLE::apply(
 std::unique_ptr<stream::input> FilterType_DDaveRLE::apply(
 	std::unique_ptr<stream::input> target) const
 {
-	return std::make_unique<stream::input_filtered>(
+	return std::make_unique<input_checkpointed>(
 		std::move(target),
 		std::make_unique<filter_decomp_size_remove>(
 			std::make_unique<filter_ddave_unrle>()
@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <camoto/stream_filtered.hpp>
 #include <camoto/util.hpp> // std::make_unique
+#include <camoto/gamearchive/stream_checkpoint.hpp>
 #include "filter-glb-raptor.hpp"
 
 namespace camoto {
@@ -171,7 +172,7 @@ std::unique_ptr<stream::inout> FilterType_GLB_Raptor_FAT::apply(
 std::unique_ptr<stream::input> FilterType_GLB_Raptor_FAT::apply(
 	std::unique_ptr<stream::input> target) const
 {
-	return std::make_unique<stream::input_filtered>(
+	return std::make_unique<input_checkpointed>(
 		std::move(target),
 		std::make_shared<filter_glb_decrypt>(GLB_KEY, GLB_BLOCKLEN)
 	);
@@ -229,7 +230,7 @@ std::unique_ptr<stream::inout> FilterType_GLB_Raptor_File::apply(
 std::unique_ptr<stream::input> FilterType_GLB_Raptor_File::apply(
 	std::unique_ptr<stream::input> target) const
 {
-	return std::make_unique<stream::input_filtered>(
+	return std::make_unique<input_checkpointed>(
 		std::move(target),
 		std::make_shared<filter_glb_decrypt>(GLB_KEY, 0)
 	);
@@ -21,6 +21,7 @@
 #include <cassert>
 #include <camoto/stream_filtered.hpp>
 #include <camoto/util.hpp> // std::make_unique
+#include <camoto/gamearchive/stream_checkpoint.hpp>
 #include "filter-got-lzss.hpp"
 
 namespace camoto {
@@ -237,7 +238,7 @@ std::unique_ptr<stream::inout> FilterType_DAT_GOT::apply(
 std::unique_ptr<stream::input> FilterType_DAT_GOT::apply(
 	std::unique_ptr<stream::input> target) const
 {
-	return std::make_unique<stream::input_filtered>(
+	return std::make_unique<input_checkpointed>(
 		std::move(target),
 		std::make_shared<filter_got_unlzss>()
 	);
@@ -254,6 +255,14 @@ std::unique_ptr<stream::output> FilterType_DAT_GOT::apply(
 	);
 }
 
+std::unique_ptr<stream::input> FilterType_DAT_GOT::applySeekable(
+	std::unique_ptr<stream::input> target) const
+{
+	// The whole state, including the dictionary, is held in the filter object
+	// so copying it gives a checkpoint.
+	return make_checkpointed<filter_got_unlzss>(std::move(target));
+}
+
 
 } // namespace gamearchive
 } // namespace camoto
@@ -91,6 +91,8 @@ class FilterType_DAT_GOT: virtual public FilterType
 		virtual std::unique_ptr<stream::output> apply(
 			std::unique_ptr<stream::output> target, stream::fn_notify_prefiltered_size resize)
 			const;
+		virtual std::unique_ptr<stream::input> applySeekable(
+			std::unique_ptr<stream::input> target) const;
 };
 
 } // namespace gamearchive
@@ -21,9 +21,11 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <camoto/iostream_helpers.hpp>
 #include <camoto/stream_filtered.hpp>
 #include <camoto/util.hpp> // std::make_unique
+#include <camoto/gamearchive/stream_checkpoint.hpp>
 #include <camoto/filter-lzss.hpp>
 #include <camoto/filter-crop.hpp>
 #include <camoto/filter-pad.hpp>
@@ -92,12 +94,17 @@ std::unique_ptr<stream::inout> FilterType_Prehistorik::apply(
 std::unique_ptr<stream::input> FilterType_Prehistorik::apply(
 	std::unique_ptr<stream::input> target) const
 {
-	auto st1 = std::make_unique<stream::input_filtered>(
+	// Skip over the decompressed size with a substream rather than a filter, so
+	// the size of the compressed data is known without decoding anything.
+	stream::len lenTarget = target->size();
+	stream::len lenSkip = std::min<stream::len>(lenTarget, PH_DECOMP_LEN);
+	auto st1 = std::make_unique<stream::input_sub>(
 		std::move(target),
-		std::make_shared<filter_crop>(PH_DECOMP_LEN)
+		lenSkip,
+		lenTarget - lenSkip
 	);
 
-	return std::make_unique<stream::input_filtered>(
+	return std::make_unique<input_checkpointed>(
 		std::move(st1),
 		std::make_shared<filter_lzss_decompress>(bitstream::bigEndian, 2, 8)
 	);
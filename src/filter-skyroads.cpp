@@ -22,6 +22,7 @@
 #include <functional>
 #include <camoto/stream_filtered.hpp>
 #include <camoto/util.hpp> // std::make_unique
+#include <camoto/gamearchive/stream_checkpoint.hpp>
 #include "filter-skyroads.hpp"
 
 namespace camoto {
@@ -256,7 +257,7 @@ std::unique_ptr<stream::inout> FilterType_SkyRoads::apply(
 std::unique_ptr<stream::input> FilterType_SkyRoads::apply(
 	std::unique_ptr<stream::input> target) const
 {
-	return std::make_unique<stream::input_filtered>(
+	return std::make_unique<input_checkpointed>(
 		std::move(target),
 		std::make_shared<filter_skyroads_unlzs>()
 	);
@@ -23,13 +23,16 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <functional>
 #include <stack>
 #include <camoto/filter.hpp>
 #include <camoto/stream_filtered.hpp>
 #include <camoto/util.hpp> // std::make_unique
+#include <camoto/gamearchive/stream_checkpoint.hpp>
 #include <camoto/bitstream.hpp>
+#include <camoto/iostream_helpers.hpp>
 #include <camoto/util.hpp>
 
 #include "filter-stargunner.hpp"
@@ -46,12 +49,19 @@ void filter_stargunner_decompress::reset(stream::len lenInput)
 }
 
 void filter_stargunner_decompress::explode_chunk(const uint8_t* in,
-	unsigned int expanded_size, uint8_t* out)
+	unsigned int lenIn, unsigned int expanded_size, uint8_t* out)
 {
 	uint8_t tableA[256], tableB[256];
 	unsigned int inpos = 0;
 	unsigned int outpos = 0;
 
+	// The sub-block lengths and codewords come from the file, so don't trust
+	// them to stay within either buffer.
+	auto nextByte = [&]() {
+		if (inpos >= lenIn) throw filter_error("Data is truncated");
+		return in[inpos++];
+	};
+
 	while (outpos < expanded_size) {
 		// Initialise the dictionary so that no bytes are codewords (or if you
 		// prefer, each byte expands to itself only.)
@@ -64,7 +74,7 @@ void filter_stargunner_decompress::explode_chunk(const uint8_t* in,
 		uint8_t code;
 		unsigned int tablepos = 0;
 		do {
-			code = in[inpos++];
+			code = nextByte();
 
 			// If the code has the high bit set, the lower 7 bits plus one is the
 			// number of codewords that will be skipped from the dictionary.  (Those
@@ -80,20 +90,20 @@ void filter_stargunner_decompress::explode_chunk(const uint8_t* in,
 				if (tablepos >= 256) {
 					throw filter_error("Dictionary was larger than 256 bytes");
 				}
-				uint8_t data = in[inpos++];
+				uint8_t data = nextByte();
 				tableA[tablepos] = data;
 				if (tablepos != data) {
 					// If this codeword didn't expand to itself, store the second byte
 					// of the expansion pair.
-					tableB[tablepos] = in[inpos++];
+					tableB[tablepos] = nextByte();
 				}
 				tablepos++;
 			}
 		} while (tablepos < 256);
 
 		// Read the length of the data encoded with this dictionary
-		int len = in[inpos++];
-		len |= in[inpos++] << 8;
+		int len = nextByte();
+		len |= nextByte() << 8;
 
 		//
 		// Decompress the data
@@ -109,11 +119,14 @@ void filter_stargunner_decompress::explode_chunk(const uint8_t* in,
 			} else {
 				// There is no data in the expansion buffer, use the input data
 				if (--len == -1) break; // no more input data
-				code = in[inpos++];
+				code = nextByte();
 			}
 
 			if (code == tableA[code]) {
 				// This byte is itself, write this to the output
+				if (outpos >= expanded_size) {
+					throw filter_error("Data expanded to more than the chunk size");
+				}
 				out[outpos++] = code;
 			} else {
 				// This byte is actually a codeword, expand it into the expansion buffer
@@ -181,7 +194,7 @@ void filter_stargunner_decompress::transform(uint8_t *out, stream::len *lenOut,
 			unsigned int chunkSize;
 			if (this->finalSize < CHUNK_SIZE) chunkSize = this->finalSize;
 			else chunkSize = CHUNK_SIZE;
-			this->explode_chunk(this->bufIn + 2, chunkSize, this->bufOut);
+			this->explode_chunk(this->bufIn + 2, lenChunk, chunkSize, this->bufOut);
 			this->finalSize -= chunkSize;
 			if (chunkSize < CHUNK_SIZE) {
 				// This was a partial chunk so 'right-justify' it to the end of the
@@ -214,6 +227,263 @@ void filter_stargunner_decompress::transform(uint8_t *out, stream::len *lenOut,
 }
 
 
+/// Length of the header at the start of the compressed data.
+#define SG_HEADER_LEN 8
+
+/// Deepest a codeword can be nested, so that expanding it will always fit in
+/// the decompressor's expansion buffer.
+#define SG_MAX_DEPTH 14
+
+/// Fewest times a pair must appear before it is worth adding to the
+/// dictionary.  Each dictionary entry takes up to three bytes.
+#define SG_MIN_PAIRS 4
+
+/// Create the header for a compressed file.
+static std::string sgHeader(stream::len lenDecoded)
+{
+	std::string header("PGBP\0\0\0\0", SG_HEADER_LEN);
+	header[4] = lenDecoded & 0xFF;
+	header[5] = (lenDecoded >> 8) & 0xFF;
+	header[6] = (lenDecoded >> 16) & 0xFF;
+	header[7] = (lenDecoded >> 24) & 0xFF;
+	return header;
+}
+
+std::string filter_stargunner_compress::implode_chunk(const uint8_t* in,
+	unsigned int len)
+{
+	std::vector<uint8_t> data(in, in + len);
+	uint8_t tableA[256], tableB[256];
+	unsigned int depth[256];
+	bool unused[256];
+	for (int i = 0; i < 256; i++) {
+		tableA[i] = i;
+		tableB[i] = 0;
+		depth[i] = 0;
+		unused[i] = true;
+	}
+	// Byte values in the data can never be codewords, even if every instance
+	// is later replaced, as codewords expand back into them.
+	for (auto c : data) unused[c] = false;
+
+	std::vector<uint16_t> count(65536, 0);
+	std::vector<unsigned int> seen; // pairs with a non-zero count
+	for (;;) {
+		int code = -1;
+		for (int i = 0; i < 256; i++) {
+			if (unused[i]) {
+				code = i;
+				break;
+			}
+		}
+		if (code < 0) break; // no codewords left
+
+		// Find the most common pair, not counting overlaps like "aaa" twice
+		unsigned int best = 0, bestCount = 0;
+		unsigned int lastCounted = data.size();
+		for (unsigned int i = 0; i + 1 < data.size(); i++) {
+			unsigned int pair = (data[i] << 8) | data[i + 1];
+			if (
+				(lastCounted + 1 == i)
+				&& (pair == (unsigned int)((data[i - 1] << 8) | data[i]))
+			) {
+				continue;
+			}
+			lastCounted = i;
+			if (count[pair] == 0) seen.push_back(pair);
+			count[pair]++;
+			if (
+				(count[pair] > bestCount)
+				&& (std::max(depth[pair >> 8], depth[pair & 0xFF]) < SG_MAX_DEPTH)
+			) {
+				best = pair;
+				bestCount = count[pair];
+			}
+		}
+		for (auto p : seen) count[p] = 0;
+		seen.clear();
+		if (bestCount < SG_MIN_PAIRS) break;
+
+		uint8_t a = best >> 8, b = best & 0xFF;
+		unsigned int w = 0;
+		for (unsigned int r = 0; r < data.size(); ) {
+			if ((r + 1 < data.size()) && (data[r] == a) && (data[r + 1] == b)) {
+				data[w++] = code;
+				r += 2;
+			} else {
+				data[w++] = data[r++];
+			}
+		}
+		data.resize(w);
+		tableA[code] = a;
+		tableB[code] = b;
+		depth[code] = std::max(depth[a], depth[b]) + 1;
+		unused[code] = false;
+	}
+
+	// Write out the dictionary, skipping over runs of bytes that expand to
+	// themselves.
+	std::string body;
+	unsigned int pos = 0;
+	while (pos < 256) {
+		unsigned int skip = 0;
+		while ((pos + skip < 256) && (tableA[pos + skip] == pos + skip) && (skip < 128)) {
+			skip++;
+		}
+		if (skip) {
+			body += (char)(127 + skip);
+			pos += skip;
+			if (pos == 256) break;
+			// A skip is always followed by one codeword
+			body += (char)tableA[pos];
+			if (tableA[pos] != pos) body += (char)tableB[pos];
+			pos++;
+			continue;
+		}
+		unsigned int run = 0;
+		while ((pos + run < 256) && (tableA[pos + run] != pos + run) && (run < 128)) {
+			run++;
+		}
+		body += (char)(run - 1);
+		for (unsigned int i = 0; i < run; i++, pos++) {
+			body += (char)tableA[pos];
+			body += (char)tableB[pos];
+		}
+	}
+
+	body += (char)(data.size() & 0xFF);
+	body += (char)(data.size() >> 8);
+	body.append((const char *)data.data(), data.size());
+
+	std::string chunk;
+	chunk += (char)(body.length() & 0xFF);
+	chunk += (char)(body.length() >> 8);
+	chunk += body;
+	assert(chunk.length() <= CMP_CHUNK_SIZE);
+	return chunk;
+}
+
+void filter_stargunner_compress::reset(stream::len lenInput)
+{
+	this->lenBufIn = 0;
+	this->lenInput = lenInput;
+	this->numIn = 0;
+	this->pending = sgHeader(lenInput);
+	this->posPending = 0;
+	return;
+}
+
+void filter_stargunner_compress::transform(uint8_t *out, stream::len *lenOut,
+	const uint8_t *in, stream::len *lenIn)
+{
+	stream::len r = 0, w = 0;
+	for (;;) {
+		// Write out anything already compressed
+		if (this->posPending < this->pending.length()) {
+			stream::len amt = std::min<stream::len>(
+				this->pending.length() - this->posPending, *lenOut - w);
+			if (amt == 0) break; // output buffer full
+			memcpy(out + w, this->pending.data() + this->posPending, amt);
+			w += amt;
+			this->posPending += amt;
+			continue;
+		}
+
+		// Fill up the next chunk
+		stream::len amt = std::min<stream::len>(CHUNK_SIZE - this->lenBufIn,
+			*lenIn - r);
+		memcpy(this->bufIn + this->lenBufIn, in + r, amt);
+		r += amt;
+		this->lenBufIn += amt;
+		this->numIn += amt;
+
+		if (
+			(this->lenBufIn == CHUNK_SIZE)
+			|| (
+				(this->lenBufIn > 0)
+				&& ((this->numIn >= this->lenInput) || (*lenIn == 0))
+			)
+		) {
+			this->pending = implode_chunk(this->bufIn, this->lenBufIn);
+			this->posPending = 0;
+			this->lenBufIn = 0;
+			continue;
+		}
+		break; // need more input
+	}
+	*lenIn = r;
+	*lenOut = w;
+	return;
+}
+
+stream::len ChunkCodec_Stargunner::chunkSize() const
+{
+	return CHUNK_SIZE;
+}
+
+stream::len ChunkCodec_Stargunner::index(stream::input& encoded,
+	std::vector<Chunk> *chunks) const
+{
+	stream::len lenEncoded = encoded.size();
+	if (lenEncoded < SG_HEADER_LEN) throw filter_error("Not enough data");
+
+	std::string sig;
+	uint32_t lenDecoded;
+	encoded.seekg(0, stream::start);
+	encoded
+		>> fixedLength(sig, 4)
+		>> u32le(lenDecoded)
+	;
+	if (sig.compare("PGBP") != 0) {
+		throw filter_error("Data is not compressed in Stargunner format");
+	}
+
+	chunks->clear();
+	stream::pos pos = SG_HEADER_LEN;
+	stream::len remaining = lenDecoded;
+	while (remaining) {
+		if (pos + 2 > lenEncoded) throw filter_error("Data is truncated");
+		uint16_t lenChunk;
+		encoded.seekg(pos, stream::start);
+		encoded >> u16le(lenChunk);
+		if (pos + 2 + lenChunk > lenEncoded) {
+			throw filter_error("Data is truncated");
+		}
+		Chunk c;
+		c.offset = pos;
+		c.length = 2 + lenChunk;
+		chunks->push_back(c);
+		pos += c.length;
+		remaining -= std::min<stream::len>(remaining, CHUNK_SIZE);
+	}
+	return lenDecoded;
+}
+
+std::string ChunkCodec_Stargunner::header(stream::len lenDecoded) const
+{
+	return sgHeader(lenDecoded);
+}
+
+std::string ChunkCodec_Stargunner::decode(const std::string& encoded,
+	stream::len lenDecoded) const
+{
+	if (encoded.length() > CMP_CHUNK_SIZE) {
+		throw filter_error("Chunk is too large");
+	}
+	if (encoded.length() < 2) throw filter_error("Data is truncated");
+	std::string out(lenDecoded, '\0');
+	auto decomp = std::make_unique<filter_stargunner_decompress>();
+	decomp->explode_chunk((const uint8_t *)encoded.data() + 2,
+		encoded.length() - 2, lenDecoded, (uint8_t *)&out[0]);
+	return out;
+}
+
+std::string ChunkCodec_Stargunner::encode(const std::string& decoded) const
+{
+	return filter_stargunner_compress::implode_chunk(
+		(const uint8_t *)decoded.data(), decoded.length());
+}
+
 FilterType_Stargunner::FilterType_Stargunner()
 {
 }
@@ -243,11 +513,11 @@ std::unique_ptr<stream::inout> FilterType_Stargunner::apply(
 	std::unique_ptr<stream::inout> target, stream::fn_notify_prefiltered_size resize)
 	const
 {
-	return std::make_unique<stream::filtered>(
+	// Each chunk is compressed on its own, so only the ones that are changed
+	// need to be compressed again.
+	return std::make_unique<inout_chunked>(
 		std::move(target),
-		std::make_shared<filter_stargunner_decompress>(),
-		/// @todo Implement Stargunner compression
-		std::unique_ptr<filter>(),//std::make_shared<filter_stargunner_compress>(),
+		std::make_shared<ChunkCodec_Stargunner>(),
 		resize
 	);
 }
@@ -255,7 +525,7 @@ std::unique_ptr<stream::inout> FilterType_Stargunner::apply(
 std::unique_ptr<stream::input> FilterType_Stargunner::apply(
 	std::unique_ptr<stream::input> target) const
 {
-	return std::make_unique<stream::input_filtered>(
+	return std::make_unique<input_checkpointed>(
 		std::move(target),
 		std::make_shared<filter_stargunner_decompress>()
 	);
@@ -267,11 +537,18 @@ std::unique_ptr<stream::output> FilterType_Stargunner::apply(
 {
 	return std::make_unique<stream::output_filtered>(
 		std::move(target),
-		/// @todo Implement Stargunner compression
-		std::unique_ptr<filter>(),//std::make_shared<filter_stargunner_compress>(),
+		std::make_shared<filter_stargunner_compress>(),
 		resize
 	);
 }
 
+std::unique_ptr<stream::input> FilterType_Stargunner::applySeekable(
+	std::unique_ptr<stream::input> target) const
+{
+	// The filter keeps the current chunk in its own buffers, so copying it
+	// gives a checkpoint.
+	return make_checkpointed<filter_stargunner_decompress>(std::move(target));
+}
+
 } // namespace gamearchive
 } // namespace camoto
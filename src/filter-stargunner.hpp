@@ -25,6 +25,7 @@
 #include <camoto/stream.hpp>
 #include <camoto/bitstream.hpp>
 #include <camoto/gamearchive/filtertype.hpp>
+#include <camoto/gamearchive/stream_chunked.hpp>
 
 namespace camoto {
 namespace gamearchive {
@@ -43,15 +44,21 @@ class filter_stargunner_decompress: virtual public filter
 		 * @param in
 		 *   Input data.  First byte is the one immediately following the chunk length.
 		 *
+		 * @param lenIn
+		 *   Number of bytes available in the input buffer.
+		 *
 		 * @param expanded_size
 		 *   The size of the input chunk after decompression.  The output buffer must
 		 *   be able to hold this many bytes.
 		 *
 		 * @param out
 		 *   Output buffer.
+		 *
+		 * @throw filter_error if the data runs past the end of the input, or
+		 *   would expand to more than expanded_size bytes.
 		 */
-		void explode_chunk(const uint8_t* in, unsigned int expanded_size,
-			uint8_t* out);
+		void explode_chunk(const uint8_t* in, unsigned int lenIn,
+			unsigned int expanded_size, uint8_t* out);
 
 		virtual void reset(stream::len lenInput);
 		virtual void transform(uint8_t *out, stream::len *lenOut,
@@ -68,6 +75,51 @@ class filter_stargunner_decompress: virtual public filter
 		unsigned int posOut;   ///< How much data has been read out of bufOut
 };
 
+class filter_stargunner_compress: virtual public filter
+{
+	public:
+		/// Compress a data chunk.
+		/**
+		 * Byte pairs that appear often are replaced by byte values that aren't
+		 * used in the data, until there are no more unused values or no pairs
+		 * worth replacing.
+		 *
+		 * @param in
+		 *   Input data.
+		 *
+		 * @param len
+		 *   Length of the input data, no more than CHUNK_SIZE.
+		 *
+		 * @return The compressed chunk, including the leading chunk length.
+		 */
+		static std::string implode_chunk(const uint8_t* in, unsigned int len);
+
+		virtual void reset(stream::len lenInput);
+		virtual void transform(uint8_t *out, stream::len *lenOut,
+			const uint8_t *in, stream::len *lenIn);
+
+	protected:
+		uint8_t bufIn[CHUNK_SIZE]; ///< Data waiting to be compressed
+		unsigned int lenBufIn;     ///< How much data is valid in bufIn
+		stream::len lenInput;      ///< Size of all the data to be compressed
+		stream::len numIn;         ///< How much data has been read so far
+		std::string pending;       ///< Compressed data not yet written out
+		unsigned int posPending;   ///< How much of pending has been written
+};
+
+/// Access to each Stargunner chunk independently.
+class ChunkCodec_Stargunner: virtual public ChunkCodec
+{
+	public:
+		virtual stream::len chunkSize() const;
+		virtual stream::len index(stream::input& encoded,
+			std::vector<Chunk> *chunks) const;
+		virtual std::string header(stream::len lenDecoded) const;
+		virtual std::string decode(const std::string& encoded,
+			stream::len lenDecoded) const;
+		virtual std::string encode(const std::string& decoded) const;
+};
+
 /// Stargunner decompression filter.
 class FilterType_Stargunner: virtual public FilterType
 {
@@ -86,6 +138,8 @@ class FilterType_Stargunner: virtual public FilterType
 		virtual std::unique_ptr<stream::output> apply(
 			std::unique_ptr<stream::output> target, stream::fn_notify_prefiltered_size resize)
 			const;
+		virtual std::unique_ptr<stream::input> applySeekable(
+			std::unique_ptr<stream::input> target) const;
 };
 
 } // namespace gamearchive
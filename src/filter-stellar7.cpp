@@ -23,6 +23,7 @@
 
 #include <camoto/stream_filtered.hpp>
 #include <camoto/util.hpp> // std::make_unique
+#include <camoto/gamearchive/stream_checkpoint.hpp>
 #include <camoto/filter-lzw.hpp>
 
 #include "filter-stellar7.hpp"
@@ -88,7 +89,7 @@ std::unique_ptr<stream::inout> FilterType_Stellar7::apply(
 std::unique_ptr<stream::input> FilterType_Stellar7::apply(
 	std::unique_ptr<stream::input> target) const
 {
-	return std::make_unique<stream::input_filtered>(
+	return std::make_unique<input_checkpointed>(
 		std::move(target),
 		std::make_shared<filter_lzw_decompress>(
 			9,   // initial codeword length (in bits)
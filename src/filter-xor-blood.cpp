@@ -20,6 +20,7 @@
 
 #include <camoto/stream_filtered.hpp>
 #include <camoto/util.hpp> // std::make_unique
+#include <camoto/gamearchive/stream_checkpoint.hpp>
 #include "filter-xor-blood.hpp"
 
 namespace camoto {
@@ -80,7 +81,7 @@ std::unique_ptr<stream::inout> FilterType_RFF::apply(
 std::unique_ptr<stream::input> FilterType_RFF::apply(
 	std::unique_ptr<stream::input> target) const
 {
-	return std::make_unique<stream::input_filtered>(
+	return std::make_unique<input_checkpointed>(
 		std::move(target),
 		std::make_shared<filter_rff_crypt>(RFF_FILE_CRYPT_LEN, 0)
 	);
@@ -20,6 +20,7 @@
 
 #include <camoto/stream_filtered.hpp>
 #include <camoto/util.hpp> // std::make_unique
+#include <camoto/gamearchive/stream_checkpoint.hpp>
 #include "filter-xor-sagent.hpp"
 #include "filter-bitswap.hpp"
 
@@ -101,8 +102,8 @@ std::unique_ptr<stream::input> FilterType_SAM_Base::apply(
 {
 	auto fswap = std::make_shared<filter_bitswap>();
 
-	return std::make_unique<stream::input_filtered>(
-		std::make_unique<stream::input_filtered>(
+	return std::make_unique<input_checkpointed>(
+		std::make_unique<input_checkpointed>(
 			std::move(target),
 			fswap
 		),
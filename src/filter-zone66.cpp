@@ -26,6 +26,7 @@
 #include <functional>
 #include <camoto/stream_filtered.hpp>
 #include <camoto/util.hpp> // std::make_unique
+#include <camoto/gamearchive/stream_checkpoint.hpp>
 
 #include "filter-zone66.hpp"
 
@@ -296,7 +297,7 @@ std::unique_ptr<stream::inout> FilterType_Zone66::apply(
 std::unique_ptr<stream::input> FilterType_Zone66::apply(
 	std::unique_ptr<stream::input> target) const
 {
-	return std::make_unique<stream::input_filtered>(
+	return std::make_unique<input_checkpointed>(
 		std::move(target),
 		std::make_shared<filter_z66_decompress>()
 	);
@@ -147,6 +147,7 @@ void FixedArchive::resize(const FileHandle& id, stream::pos newStoredSize,
 	auto entry = FixedEntry::cast(id);
 	const FixedArchiveFile *file = &this->vcFiles[entry->index];
 	if (file->fnResize) {
+		id->generation++;
 		file->fnResize(*this->content, entry, newStoredSize, newRealSize);
 	} else if (id->storedSize != newStoredSize) {
 		throw stream::error(createString("This is a fixed archive, files "
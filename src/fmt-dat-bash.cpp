@@ -133,6 +133,18 @@ std::shared_ptr<Archive> ArchiveType_DAT_Bash::open(
 	return std::make_shared<Archive_DAT_Bash>(std::move(content));
 }
 
+bool ArchiveType_DAT_Bash::walksFAT() const
+{
+	return true;
+}
+
+std::shared_ptr<Archive> ArchiveType_DAT_Bash::openIndexed(
+	std::unique_ptr<stream::inout> content, SuppData& suppData,
+	stream::input& index) const
+{
+	return std::make_shared<Archive_DAT_Bash>(std::move(content), &index);
+}
+
 SuppFilenames ArchiveType_DAT_Bash::getRequiredSupps(stream::input& content,
 	const std::string& filename) const
 {
@@ -140,9 +152,12 @@ SuppFilenames ArchiveType_DAT_Bash::getRequiredSupps(stream::input& content,
 }
 
 
-Archive_DAT_Bash::Archive_DAT_Bash(std::unique_ptr<stream::inout> content)
+Archive_DAT_Bash::Archive_DAT_Bash(std::unique_ptr<stream::inout> content,
+	stream::input *index)
 	:	Archive_FAT(std::move(content), DAT_FIRST_FILE_OFFSET, DAT_MAX_FILENAME_LEN)
 {
+	if (index && this->readIndex(*index)) return;
+
 	stream::pos lenArchive = this->content->size();
 
 	this->content->seekg(0, stream::start);
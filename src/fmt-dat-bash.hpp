@@ -43,6 +43,10 @@ class ArchiveType_DAT_Bash: virtual public ArchiveType
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
 		virtual std::shared_ptr<Archive> open(
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
+		virtual bool walksFAT() const;
+		virtual std::shared_ptr<Archive> openIndexed(
+			std::unique_ptr<stream::inout> content, SuppData& suppData,
+			stream::input& index) const;
 		virtual SuppFilenames getRequiredSupps(stream::input& content,
 			const std::string& filename) const;
 };
@@ -51,7 +55,17 @@ class ArchiveType_DAT_Bash: virtual public ArchiveType
 class Archive_DAT_Bash: virtual public Archive_FAT
 {
 	public:
-		Archive_DAT_Bash(std::unique_ptr<stream::inout> content);
+		/// Open an archive.
+		/**
+		 * @param content
+		 *   Archive data.
+		 *
+		 * @param index
+		 *   Optional index written by writeIndex(), to avoid reading every
+		 *   file's header.  NULL to read the headers from the archive.
+		 */
+		Archive_DAT_Bash(std::unique_ptr<stream::inout> content,
+			stream::input *index = NULL);
 		virtual ~Archive_DAT_Bash();
 
 		// As per Archive (see there for docs)
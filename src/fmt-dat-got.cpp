@@ -176,6 +176,9 @@ SuppFilenames ArchiveType_DAT_GoT::getRequiredSupps(stream::input& content,
 Archive_DAT_GoT::Archive_DAT_GoT(std::unique_ptr<stream::inout> content)
 	:	Archive_FAT(std::move(content), GOT_FIRST_FILE_OFFSET, GOT_MAX_FILENAME_LEN)
 {
+	// Files are located only by their FAT offset, so gaps are allowed
+	this->relocatable = true;
+
 	// Create a substream to decrypt the FAT
 	auto fatSubStream = std::make_unique<stream::sub>(
 		this->content,
@@ -246,6 +249,13 @@ Archive::File::Attribute Archive_DAT_GoT::getSupportedAttributes() const
 	return File::Attribute::Compressed;
 }
 
+void Archive_DAT_GoT::move(const FileHandle& idBeforeThis, const FileHandle& id)
+{
+	// TESTED BY: fmt_got_dat_move
+	this->moveFATEntry(idBeforeThis, id, *this->fatStream, 0, GOT_FAT_ENTRY_LEN);
+	return;
+}
+
 void Archive_DAT_GoT::updateFileName(const FATEntry *pid, const std::string& strNewName)
 {
 	// TESTED BY: fmt_got_dat_rename
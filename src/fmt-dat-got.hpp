@@ -57,6 +57,7 @@ class Archive_DAT_GoT: virtual public Archive_FAT
 		virtual ~Archive_DAT_GoT();
 
 		virtual void flush();
+		virtual void move(const FileHandle& idBeforeThis, const FileHandle& id);
 		virtual Archive::File::Attribute getSupportedAttributes() const;
 
 		virtual void updateFileName(const FATEntry *pid,
@@ -114,6 +114,18 @@ std::shared_ptr<Archive> ArchiveType_DAT_Sango::open(
 	return std::make_shared<Archive_DAT_Sango>(std::move(content));
 }
 
+bool ArchiveType_DAT_Sango::walksFAT() const
+{
+	return true;
+}
+
+std::shared_ptr<Archive> ArchiveType_DAT_Sango::openIndexed(
+	std::unique_ptr<stream::inout> content, SuppData& suppData,
+	stream::input& index) const
+{
+	return std::make_shared<Archive_DAT_Sango>(std::move(content), &index);
+}
+
 SuppFilenames ArchiveType_DAT_Sango::getRequiredSupps(stream::input& content,
 	const std::string& filename) const
 {
@@ -121,7 +133,8 @@ SuppFilenames ArchiveType_DAT_Sango::getRequiredSupps(stream::input& content,
 }
 
 
-Archive_DAT_Sango::Archive_DAT_Sango(std::unique_ptr<stream::inout> content)
+Archive_DAT_Sango::Archive_DAT_Sango(std::unique_ptr<stream::inout> content,
+	stream::input *index)
 	:	Archive_FAT(std::move(content), DAT_FIRST_FILE_OFFSET, 0)
 {
 	this->content->seekg(0, stream::end);
@@ -129,6 +142,8 @@ Archive_DAT_Sango::Archive_DAT_Sango(std::unique_ptr<stream::inout> content)
 
 	if (this->lenArchive < DAT_FAT_ENTRY_LEN) throw stream::error("file too short");
 
+	if (index && this->readIndex(*index)) return;
+
 	uint32_t offEndFAT;
 	this->content->seekg(0, stream::start);
 	*this->content >> u32le(offEndFAT);
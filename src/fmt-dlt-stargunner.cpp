@@ -96,6 +96,13 @@ ArchiveType::Certainty ArchiveType_DLT_Stargunner::isInstance(
 	return Certainty::DefinitelyNo;
 }
 
+std::vector<ArchiveType::Signature> ArchiveType_DLT_Stargunner::signatures() const
+{
+	return {
+		{0, "DAVE", DLT_HEADER_LEN, 0},
+	};
+}
+
 std::shared_ptr<Archive> ArchiveType_DLT_Stargunner::create(
 	std::unique_ptr<stream::inout> content, SuppData& suppData) const
 {
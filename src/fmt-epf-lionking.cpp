@@ -107,6 +107,13 @@ ArchiveType::Certainty ArchiveType_EPF_LionKing::isInstance(
 	return Certainty::DefinitelyNo;
 }
 
+std::vector<ArchiveType::Signature> ArchiveType_EPF_LionKing::signatures() const
+{
+	return {
+		{0, "EPFS", EPF_HEADER_LEN, 0},
+	};
+}
+
 std::shared_ptr<Archive> ArchiveType_EPF_LionKing::create(
 	std::unique_ptr<stream::inout> content, SuppData& suppData) const
 {
@@ -78,6 +78,13 @@ ArchiveType::Certainty ArchiveType_EXE_CCaves::isInstance(
 	return Certainty::DefinitelyNo;
 }
 
+std::vector<ArchiveType::Signature> ArchiveType_EXE_CCaves::signatures() const
+{
+	return {
+		{0x1E00, "\x55\x89\xE5\x8B\x46\x06\xBA\xA0", 0, 191984},
+	};
+}
+
 std::shared_ptr<Archive> ArchiveType_EXE_CCaves::create(
 	std::unique_ptr<stream::inout> content, SuppData& suppData) const
 {
@@ -100,6 +100,13 @@ ArchiveType::Certainty ArchiveType_EXE_DDave::isInstance(
 	return Certainty::DefinitelyNo;
 }
 
+std::vector<ArchiveType::Signature> ArchiveType_EXE_DDave::signatures() const
+{
+	return {
+		{0x26A80, "Trouble loading tileset!$", 0, 172848},
+	};
+}
+
 std::shared_ptr<Archive> ArchiveType_EXE_DDave::create(
 	std::unique_ptr<stream::inout> content, SuppData& suppData) const
 {
@@ -92,6 +92,13 @@ ArchiveType::Certainty ArchiveType_GLB_Galactix::isInstance(
 	return Certainty::DefinitelyYes;
 }
 
+std::vector<ArchiveType::Signature> ArchiveType_GLB_Galactix::signatures() const
+{
+	return {
+		{4, std::string("GLIB FILE\0", 10), 0, 0},
+	};
+}
+
 std::shared_ptr<Archive> ArchiveType_GLB_Galactix::create(
 	std::unique_ptr<stream::inout> content, SuppData& suppData) const
 {
@@ -104,6 +104,13 @@ ArchiveType::Certainty ArchiveType_GLB_Raptor::isInstance(
 	return Certainty::DefinitelyYes;
 }
 
+std::vector<ArchiveType::Signature> ArchiveType_GLB_Raptor::signatures() const
+{
+	return {
+		{0, std::string("\x64\x9B\xD1\x09", 4), 0, 0},
+	};
+}
+
 std::shared_ptr<Archive> ArchiveType_GLB_Raptor::create(
 	std::unique_ptr<stream::inout> content, SuppData& suppData) const
 {
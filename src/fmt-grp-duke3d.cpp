@@ -99,6 +99,13 @@ ArchiveType::Certainty ArchiveType_GRP_Duke3D::isInstance(
 	return Certainty::DefinitelyYes;
 }
 
+std::vector<ArchiveType::Signature> ArchiveType_GRP_Duke3D::signatures() const
+{
+	return {
+		{0, "KenSilverman", GRP_FAT_ENTRY_LEN, 0},
+	};
+}
+
 std::shared_ptr<Archive> ArchiveType_GRP_Duke3D::create(
 	std::unique_ptr<stream::inout> content, SuppData& suppData) const
 {
@@ -113,6 +120,33 @@ std::shared_ptr<Archive> ArchiveType_GRP_Duke3D::open(
 	return std::make_shared<Archive_GRP_Duke3D>(std::move(content));
 }
 
+void ArchiveType_GRP_Duke3D::write(stream::output& content,
+	const std::vector<FileData>& files, SuppData& suppData) const
+{
+	// TESTED BY: fmt_grp_duke3d_new_write
+	// The FAT only holds the file sizes, which we know already, so it can be
+	// written out in full before any of the data.
+	content.write("KenSilverman", 12);
+	content << u32le(files.size());
+	for (const auto& i : files) {
+		if (i.strFilename.length() > GRP_MAX_FILENAME_LEN) {
+			throw stream::error(createString("maximum filename length is "
+				<< GRP_MAX_FILENAME_LEN << " chars"));
+		}
+		std::string name = i.strFilename;
+		camoto::uppercase(name);
+		content
+			<< nullPadded(name, GRP_FILENAME_FIELD_LEN)
+			<< u32le(i.content->size());
+	}
+	for (const auto& i : files) {
+		i.content->seekg(0, stream::start);
+		stream::copy(content, *i.content);
+	}
+	content.flush();
+	return;
+}
+
 SuppFilenames ArchiveType_GRP_Duke3D::getRequiredSupps(stream::input& data,
 	const std::string& filename) const
 {
@@ -162,6 +196,18 @@ Archive_GRP_Duke3D::~Archive_GRP_Duke3D()
 {
 }
 
+void Archive_GRP_Duke3D::move(const FileHandle& idBeforeThis,
+	const FileHandle& id)
+{
+	// TESTED BY: fmt_grp_duke3d_move
+	// The data is stored in FAT order, so move both.  The FAT has no offsets to
+	// update.
+	this->moveData(idBeforeThis, id);
+	this->moveFATEntry(idBeforeThis, id, *this->content, GRP_FAT_OFFSET,
+		GRP_FAT_ENTRY_LEN);
+	return;
+}
+
 void Archive_GRP_Duke3D::updateFileName(const FATEntry *pid,
 	const std::string& strNewName)
 {
@@ -39,10 +39,13 @@ class ArchiveType_GRP_Duke3D: virtual public ArchiveType
 		virtual std::vector<std::string> fileExtensions() const;
 		virtual std::vector<std::string> games() const;
 		virtual ArchiveType::Certainty isInstance(stream::input& content) const;
+		virtual std::vector<Signature> signatures() const;
 		virtual std::shared_ptr<Archive> create(
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
 		virtual std::shared_ptr<Archive> open(
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
+		virtual void write(stream::output& content,
+			const std::vector<FileData>& files, SuppData& suppData) const;
 		virtual SuppFilenames getRequiredSupps(stream::input& content,
 			const std::string& filename) const;
 };
@@ -54,6 +57,7 @@ class Archive_GRP_Duke3D: virtual public Archive_FAT
 		Archive_GRP_Duke3D(std::unique_ptr<stream::inout> content);
 		virtual ~Archive_GRP_Duke3D();
 
+		virtual void move(const FileHandle& idBeforeThis, const FileHandle& id);
 		virtual void updateFileName(const FATEntry *pid,
 			const std::string& strNewName);
 		virtual void updateFileSize(const FATEntry *pid, stream::delta sizeDelta);
@@ -94,6 +94,13 @@ ArchiveType::Certainty ArchiveType_GWx_HomeBrew::isInstance(
 	return Certainty::DefinitelyYes;
 }
 
+std::vector<ArchiveType::Signature> ArchiveType_GWx_HomeBrew::signatures() const
+{
+	return {
+		{0, "HomeBrew File Folder\x1A", GWx_FAT_OFFSET, 0},
+	};
+}
+
 std::shared_ptr<Archive> ArchiveType_GWx_HomeBrew::create(
 	std::unique_ptr<stream::inout> content, SuppData& suppData) const
 {
@@ -90,6 +90,13 @@ ArchiveType::Certainty ArchiveType_HOG_Descent::isInstance(
 	return Certainty::DefinitelyNo;
 }
 
+std::vector<ArchiveType::Signature> ArchiveType_HOG_Descent::signatures() const
+{
+	return {
+		{0, "DHF", HOG_HEADER_LEN, 0},
+	};
+}
+
 std::shared_ptr<Archive> ArchiveType_HOG_Descent::create(
 	std::unique_ptr<stream::inout> content, SuppData& suppData) const
 {
@@ -104,6 +111,18 @@ std::shared_ptr<Archive> ArchiveType_HOG_Descent::open(
 	return std::make_shared<Archive_HOG_Descent>(std::move(content));
 }
 
+bool ArchiveType_HOG_Descent::walksFAT() const
+{
+	return true;
+}
+
+std::shared_ptr<Archive> ArchiveType_HOG_Descent::openIndexed(
+	std::unique_ptr<stream::inout> content, SuppData& suppData,
+	stream::input& index) const
+{
+	return std::make_shared<Archive_HOG_Descent>(std::move(content), &index);
+}
+
 SuppFilenames ArchiveType_HOG_Descent::getRequiredSupps(stream::input& content,
 	const std::string& filename) const
 {
@@ -111,9 +130,12 @@ SuppFilenames ArchiveType_HOG_Descent::getRequiredSupps(stream::input& content,
 }
 
 
-Archive_HOG_Descent::Archive_HOG_Descent(std::unique_ptr<stream::inout> content)
+Archive_HOG_Descent::Archive_HOG_Descent(std::unique_ptr<stream::inout> content,
+	stream::input *index)
 	:	Archive_FAT(std::move(content), HOG_FIRST_FILE_OFFSET, HOG_MAX_FILENAME_LEN)
 {
+	if (index && this->readIndex(*index)) return;
+
 	stream::pos lenArchive = this->content->size();
 
 	this->content->seekg(HOG_FIRST_FILE_OFFSET, stream::start); // skip sig
@@ -161,6 +183,17 @@ Archive_HOG_Descent::~Archive_HOG_Descent()
 {
 }
 
+void Archive_HOG_Descent::move(const FileHandle& idBeforeThis,
+	const FileHandle& id)
+{
+	// TESTED BY: fmt_hog_descent_move
+	// Each FAT entry is a header in front of the file data, so it moves along
+	// with the data.
+	this->moveData(idBeforeThis, id);
+	this->reorderEntry(idBeforeThis, id);
+	return;
+}
+
 void Archive_HOG_Descent::updateFileName(const FATEntry *pid, const std::string& strNewName)
 {
 	// TESTED BY: fmt_hog_descent_rename
@@ -39,10 +39,15 @@ class ArchiveType_HOG_Descent: virtual public ArchiveType
 		virtual std::vector<std::string> fileExtensions() const;
 		virtual std::vector<std::string> games() const;
 		virtual ArchiveType::Certainty isInstance(stream::input& content) const;
+		virtual std::vector<Signature> signatures() const;
 		virtual std::shared_ptr<Archive> create(
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
 		virtual std::shared_ptr<Archive> open(
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
+		virtual bool walksFAT() const;
+		virtual std::shared_ptr<Archive> openIndexed(
+			std::unique_ptr<stream::inout> content, SuppData& suppData,
+			stream::input& index) const;
 		virtual SuppFilenames getRequiredSupps(stream::input& content,
 			const std::string& filename) const;
 };
@@ -51,9 +56,20 @@ class ArchiveType_HOG_Descent: virtual public ArchiveType
 class Archive_HOG_Descent: virtual public Archive_FAT
 {
 	public:
-		Archive_HOG_Descent(std::unique_ptr<stream::inout> content);
+		/// Open an archive.
+		/**
+		 * @param content
+		 *   Archive data.
+		 *
+		 * @param index
+		 *   Optional index written by writeIndex(), to avoid reading every
+		 *   file's header.  NULL to read the headers from the archive.
+		 */
+		Archive_HOG_Descent(std::unique_ptr<stream::inout> content,
+			stream::input *index = NULL);
 		virtual ~Archive_HOG_Descent();
 
+		virtual void move(const FileHandle& idBeforeThis, const FileHandle& id);
 		virtual void updateFileName(const FATEntry *pid,
 			const std::string& strNewName);
 		virtual void updateFileSize(const FATEntry *pid, stream::delta sizeDelta);
@@ -21,8 +21,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <string>
 #include <sstream>
+#include <vector>
 #include <camoto/iostream_helpers.hpp>
 #include <camoto/util.hpp> // std::make_unique
 #include "fmt-lbr-vinyl.hpp"
@@ -41,325 +43,427 @@
 namespace camoto {
 namespace gamearchive {
 
-const char *filenames[] = {
-"1000P.CMP",
-"100P.CMP",
-"250P.CMP",
-"500P.CMP",
-"50P.CMP",
-"APPLE.CMP",
-"APPLE.SND",
-"BAMBOOP.CMP",
-"BAPPLE0.OMP",
-"BETA.BIN",
-"BGRENSHT.CMP",
-"BLOOK.CMP",
-"BLUEBALL.CMP",
-"BLUEKEY.CMP",
-"BLUE.PAL",
-"BLUE.TLS",
-"BOTTLE.CMP",
-"BOUNCE.CMP",
-"BRAIN.CMP",
-"BREATH.CMP",
-"BRIDGE.CMP",
-"BSHOT.CMP",
-"BUTFLY.CMP",
-"CANNON.CMP",
-"CASPLAT1.CMP",
-"CASPLAT2.CMP",
-"CASPLAT3.CMP",
-"CASPLAT4.CMP",
-"CASTLE.PAL",
-"CASTLE.TLS",
-"COVERUP.MUS",
-"CREDITS.PAL",
-"CREDITS.SCR",
-"CRUSH.MUS",
-"CSTARS.CMP",
-"DATA.DAT",
-"DARKBAR2.GRA",
-"DEATH.CMP",
-"DEMO_1.DTA",
-"DEMO_2.DTA",
-"DEMO_3.DTA",
-"DIFFBUTN.CMP",
-"DIFFMENU.CMP",
-"DOTS1.CMP",
-"DUNGEON.PAL",
-"DUNGEON.TLS",
-"DUNPLAT1.CMP",
-"DUSTCLUD.CMP",
-"ECHOT1.CMP",
-"EGYPPLAT.CMP",
-"EGYPT.PAL",
-"EGYPT.TLS",
-"ENDBOSSW.CMP",
-"ENDING.SCN",
-"ENTER2.SND",
-"EPISODE.PAL",
-"EPISODE.SCR",
-"EVILEYE.MUS",
-"EXIT.CMP",
-"EXPL1.SND",
-"FEVER.MUS",
-"FIRE231.CMP",
-"FRUIT.SND",
-"GAME1.PAL",
-"GAMEOPT.GRA",
-"GATEKEY.CMP",
-"GOLDKEY.CMP",
-"GRAVE.PAL",
-"GRAVE.TLS",
-"GREYKEY.CMP",
-"GRID.DTA",
-"HARDHEAD.CMP",
-"HEALJUG.CMP",
-"HEALPOT.CMP",
-"HEALPOTD.CMP",
-"HEALPOT.SND",
-"HELLO.T",
-"HORUS.MUS",
-"HURT.SND",
-"HUTS.PAL",
-"HUTS.TLS",
-"INBET.PAL",
-"INBETW.SCR",
-"INOUTP00.CMP",
-"INSURED.MUS",
-"INTRO.MUS",
-"JFIREB.CMP",
-"JILL.CMP",
-"JILLEXPB.CMP",
-"JILLEXP.CMP",
-"JILLFIRE.CMP",
-"JILL.SPR",
-"JUNGLE2.FON",
-"JUNGLE.FON",
-"KNIFE.CMP",
-"LAND.SND",
-"LC_CAPS.RAW",
-"LC_NUMS.RAW",
-"LEVEL1-1.M",
-"LEVEL1-2.M",
-"LEVEL1-3.M",
-"LEVEL1-4.M",
-"LEVEL1-5.M",
-"LEVEL1-6.M",
-"LEVEL1-7.M",
-"LEVEL1-8.M",
-"LEVEL1-9.M",
-"LEVEL2-1.M",
-"LEVEL2-2.M",
-"LEVEL2-3.M",
-"LEVEL2-4.M",
-"LEVEL2-5.M",
-"LEVEL2-6.M",
-"LEVEL2-7.M",
-"LEVEL2-8.M",
-"LEVEL2-9.M",
-"LEVEL3-1.M",
-"LEVEL3-2.M",
-"LEVEL3-3.M",
-"LEVEL3-4.M",
-"LEVEL3-5.M",
-"LEVEL3-6.M",
-"LEVEL3-7.M",
-"LEVEL3-8.M",
-"LEVEL3-9.M",
-"LGRENSHT.CMP",
-"LITSCROL.CMP",
-"MAINFONT.GRA",
-"MANEATPL.CMP",
-"MENU2.RAW",
-"MENUCH.GRA",
-"MENUCLIK.SND",
-"MENU.RAW",
-"MENUYSNO.GRA",
-"MIDLEVEL.CMP",
-"MIDPOST.SND",
-"MMREST.GRA",
-"MONDIE.SND",
-"MOUNT.TLS",
-"MPLAT211.CMP",
-"MPLAT212.CMP",
-"MPLAT221.CMP",
-"MPLAT311.CMP",
-"MPLAT331.CMP",
-"MPLAT332.CMP",
-"MUSHSHOT.CMP",
-"MYSTIC.MUS",
-"NEWBEH.CMP",
-"OLDBEH.CMP",
-"ORDER.RES",
-"OSIRIS.MUS",
-"OUTGATE.CMP",
-"OVERHEAD.PAL",
-"OVERHEAD.TLS",
-"OVERHED1.MAP",
-"OVERHED2.MAP",
-"OVERHED3.MAP",
-"PAN2.SND",
-"PRESENT.GRA",
-"PRESENT.PAL",
-"PROWLER.MUS",
-"PURPLE.PAL",
-"PURPLE.TLS",
-"PUZZ6.MUS",
-"RABBIT.CMP",
-"RABBITD.CMP",
-"REDKEY.CMP",
-"RETROJIL.MUS",
-"RING.CMP",
-"RUFEYE.CMP",
-"RUFEYES.CMP",
-"RUFEYSE.CMP",
-"SAVEBOXG.GRA",
-"SAVEBOXO.GRA",
-"SCORE.CMP",
-"SCROLLG.CMP",
-"SCROLLO.CMP",
-"SGREENE.CMP",
-"SHOTEXPL.CMP",
-"SHOTTEST.CMP",
-"SHWRREM.GRA",
-"SIXPS.GRA",
-"SIXPS.PAL",
-"SKELBONE.CMP",
-"SKELETON.CMP",
-"SKELETON.SND",
-"SKELFLY.CMP",
-"SMALLEX.CMP",
-"SMALNUM.CMP",
-"SPARE.SCR",
-"SPIKEBA.CMP",
-"SPLADY.CMP",
-"SPLAT211.CMP",
-"SPLAT223.CMP",
-"SPLAT231.CMP",
-"SPRING.SND",
-"SPROIN.CMP",
-"SQUARE.TLS",
-"STAR.CMP",
-"STARDUST.MUS",
-"STHORNSH.CMP",
-"STICKEYE.CMP",
-"STIKHORN.CMP",
-"STLSPIKE.CMP",
-"STORY.PAL",
-"STORY.SCR",
-"STRIKE.MUS",
-"STRYFNT1.GRA",
-"SVINYL.SPR",
-"TAFA.MUS",
-"T.CMP",
-"TEST0004.CMP",
-"THROW.SND",
-"TITLE.PAL",
-"TITLE.SCR",
-"TORNADO.CMP",
-"TRAMPLE.MUS",
-"TREEMPLA.CMP",
-"TREES.PAL",
-"TREES.TLS",
-"TWILIGHT.MUS",
-"UGH.CMP",
-"UNLOGIC1.GRA",
-"UNLOGIC1.PAL",
-"UNLOGIC.UNM",
-"VINE.CMP",
-"VINYLDIE.SND",
-"VINYL.GRA",
-"VINYL.PAL",
-"VINYL.SPR",
-"VSMALLE.CMP",
-"WEAPBLNK.OMP",
-"WEAPBLUE.OMP",
-"WEAPBOTL.OMP",
-"WEAPFIRE.OMP",
-"WEAPFSKF.OMP",
-"WEAPSLKF.OMP",
-"WEAPSTAR.OMP",
-"WFIREB.CMP",
-"WOODSPIK.CMP",
-"XHUTS.PAL",
-"YELLOW.PAL",
-"YELLOW.TLS",
-"YES.CMP",
+/// Calculate one entry in lbrHashTable.
+/**
+ * This is the CRC-16 (polynomial 0x1021) of a single byte, which is shifted
+ * left one bit at a time.
+ */
+constexpr uint16_t lbrHashTableEntry(unsigned int value, int bits)
+{
+	return (bits == 0) ? value : lbrHashTableEntry(
+		(value & 0x8000) ? (((value << 1) & 0xFFFF) ^ 0x1021) : ((value << 1) & 0xFFFF),
+		bits - 1
+	);
+}
+
+#define LBR_T1(n)   lbrHashTableEntry((n) << 8, 8)
+#define LBR_T4(n)   LBR_T1(n), LBR_T1(n + 1), LBR_T1(n + 2), LBR_T1(n + 3)
+#define LBR_T16(n)  LBR_T4(n), LBR_T4(n + 4), LBR_T4(n + 8), LBR_T4(n + 12)
+#define LBR_T64(n)  LBR_T16(n), LBR_T16(n + 16), LBR_T16(n + 32), LBR_T16(n + 48)
+
+/// CRC-16 lookup table, so filenames can be hashed a byte at a time.
+constexpr uint16_t lbrHashTable[256] = {
+	LBR_T64(0), LBR_T64(64), LBR_T64(128), LBR_T64(192)
+};
+
+/// Add one more character to an LBR hash.
+/**
+ * @param hash
+ *   Hash of the characters before c.
+ *
+ * @param c
+ *   Next character of the filename.
+ */
+constexpr uint16_t lbrHashByte(uint16_t hash, char c)
+{
+	return ((hash << 8) ^ lbrHashTable[((hash >> 8) ^ (uint8_t)c) & 0xFF])
+		& 0xFFFF;
+}
+
+/// Hash function to convert filenames into LBR hashes.
+/**
+ * This is constexpr so that the hashes of the built-in filenames below are
+ * worked out by the compiler.
+ *
+ * @param name
+ *   Remaining characters of the filename.
+ *
+ * @param hash
+ *   Hash of the characters before name.
+ */
+constexpr uint16_t lbrHash(const char *name, uint16_t hash = 0)
+{
+	return (*name == '\0') ? hash : lbrHash(name + 1, lbrHashByte(hash, *name));
+}
+
+/// A known filename and its hash.
+struct LBRName {
+	uint16_t hash;
+	const char *name;
+};
+
+#define LBR_NAME(n) { lbrHash(n), n }
+
+/// Filenames used by the game, so the hashes in the FAT can be turned back
+/// into names.
+constexpr LBRName lbrNames[] = {
+LBR_NAME("1000P.CMP"),
+LBR_NAME("100P.CMP"),
+LBR_NAME("250P.CMP"),
+LBR_NAME("500P.CMP"),
+LBR_NAME("50P.CMP"),
+LBR_NAME("APPLE.CMP"),
+LBR_NAME("APPLE.SND"),
+LBR_NAME("BAMBOOP.CMP"),
+LBR_NAME("BAPPLE0.OMP"),
+LBR_NAME("BETA.BIN"),
+LBR_NAME("BGRENSHT.CMP"),
+LBR_NAME("BLOOK.CMP"),
+LBR_NAME("BLUEBALL.CMP"),
+LBR_NAME("BLUEKEY.CMP"),
+LBR_NAME("BLUE.PAL"),
+LBR_NAME("BLUE.TLS"),
+LBR_NAME("BOTTLE.CMP"),
+LBR_NAME("BOUNCE.CMP"),
+LBR_NAME("BRAIN.CMP"),
+LBR_NAME("BREATH.CMP"),
+LBR_NAME("BRIDGE.CMP"),
+LBR_NAME("BSHOT.CMP"),
+LBR_NAME("BUTFLY.CMP"),
+LBR_NAME("CANNON.CMP"),
+LBR_NAME("CASPLAT1.CMP"),
+LBR_NAME("CASPLAT2.CMP"),
+LBR_NAME("CASPLAT3.CMP"),
+LBR_NAME("CASPLAT4.CMP"),
+LBR_NAME("CASTLE.PAL"),
+LBR_NAME("CASTLE.TLS"),
+LBR_NAME("COVERUP.MUS"),
+LBR_NAME("CREDITS.PAL"),
+LBR_NAME("CREDITS.SCR"),
+LBR_NAME("CRUSH.MUS"),
+LBR_NAME("CSTARS.CMP"),
+LBR_NAME("DATA.DAT"),
+LBR_NAME("DARKBAR2.GRA"),
+LBR_NAME("DEATH.CMP"),
+LBR_NAME("DEMO_1.DTA"),
+LBR_NAME("DEMO_2.DTA"),
+LBR_NAME("DEMO_3.DTA"),
+LBR_NAME("DIFFBUTN.CMP"),
+LBR_NAME("DIFFMENU.CMP"),
+LBR_NAME("DOTS1.CMP"),
+LBR_NAME("DUNGEON.PAL"),
+LBR_NAME("DUNGEON.TLS"),
+LBR_NAME("DUNPLAT1.CMP"),
+LBR_NAME("DUSTCLUD.CMP"),
+LBR_NAME("ECHOT1.CMP"),
+LBR_NAME("EGYPPLAT.CMP"),
+LBR_NAME("EGYPT.PAL"),
+LBR_NAME("EGYPT.TLS"),
+LBR_NAME("ENDBOSSW.CMP"),
+LBR_NAME("ENDING.SCN"),
+LBR_NAME("ENTER2.SND"),
+LBR_NAME("EPISODE.PAL"),
+LBR_NAME("EPISODE.SCR"),
+LBR_NAME("EVILEYE.MUS"),
+LBR_NAME("EXIT.CMP"),
+LBR_NAME("EXPL1.SND"),
+LBR_NAME("FEVER.MUS"),
+LBR_NAME("FIRE231.CMP"),
+LBR_NAME("FRUIT.SND"),
+LBR_NAME("GAME1.PAL"),
+LBR_NAME("GAMEOPT.GRA"),
+LBR_NAME("GATEKEY.CMP"),
+LBR_NAME("GOLDKEY.CMP"),
+LBR_NAME("GRAVE.PAL"),
+LBR_NAME("GRAVE.TLS"),
+LBR_NAME("GREYKEY.CMP"),
+LBR_NAME("GRID.DTA"),
+LBR_NAME("HARDHEAD.CMP"),
+LBR_NAME("HEALJUG.CMP"),
+LBR_NAME("HEALPOT.CMP"),
+LBR_NAME("HEALPOTD.CMP"),
+LBR_NAME("HEALPOT.SND"),
+LBR_NAME("HELLO.T"),
+LBR_NAME("HORUS.MUS"),
+LBR_NAME("HURT.SND"),
+LBR_NAME("HUTS.PAL"),
+LBR_NAME("HUTS.TLS"),
+LBR_NAME("INBET.PAL"),
+LBR_NAME("INBETW.SCR"),
+LBR_NAME("INOUTP00.CMP"),
+LBR_NAME("INSURED.MUS"),
+LBR_NAME("INTRO.MUS"),
+LBR_NAME("JFIREB.CMP"),
+LBR_NAME("JILL.CMP"),
+LBR_NAME("JILLEXPB.CMP"),
+LBR_NAME("JILLEXP.CMP"),
+LBR_NAME("JILLFIRE.CMP"),
+LBR_NAME("JILL.SPR"),
+LBR_NAME("JUNGLE2.FON"),
+LBR_NAME("JUNGLE.FON"),
+LBR_NAME("KNIFE.CMP"),
+LBR_NAME("LAND.SND"),
+LBR_NAME("LC_CAPS.RAW"),
+LBR_NAME("LC_NUMS.RAW"),
+LBR_NAME("LEVEL1-1.M"),
+LBR_NAME("LEVEL1-2.M"),
+LBR_NAME("LEVEL1-3.M"),
+LBR_NAME("LEVEL1-4.M"),
+LBR_NAME("LEVEL1-5.M"),
+LBR_NAME("LEVEL1-6.M"),
+LBR_NAME("LEVEL1-7.M"),
+LBR_NAME("LEVEL1-8.M"),
+LBR_NAME("LEVEL1-9.M"),
+LBR_NAME("LEVEL2-1.M"),
+LBR_NAME("LEVEL2-2.M"),
+LBR_NAME("LEVEL2-3.M"),
+LBR_NAME("LEVEL2-4.M"),
+LBR_NAME("LEVEL2-5.M"),
+LBR_NAME("LEVEL2-6.M"),
+LBR_NAME("LEVEL2-7.M"),
+LBR_NAME("LEVEL2-8.M"),
+LBR_NAME("LEVEL2-9.M"),
+LBR_NAME("LEVEL3-1.M"),
+LBR_NAME("LEVEL3-2.M"),
+LBR_NAME("LEVEL3-3.M"),
+LBR_NAME("LEVEL3-4.M"),
+LBR_NAME("LEVEL3-5.M"),
+LBR_NAME("LEVEL3-6.M"),
+LBR_NAME("LEVEL3-7.M"),
+LBR_NAME("LEVEL3-8.M"),
+LBR_NAME("LEVEL3-9.M"),
+LBR_NAME("LGRENSHT.CMP"),
+LBR_NAME("LITSCROL.CMP"),
+LBR_NAME("MAINFONT.GRA"),
+LBR_NAME("MANEATPL.CMP"),
+LBR_NAME("MENU2.RAW"),
+LBR_NAME("MENUCH.GRA"),
+LBR_NAME("MENUCLIK.SND"),
+LBR_NAME("MENU.RAW"),
+LBR_NAME("MENUYSNO.GRA"),
+LBR_NAME("MIDLEVEL.CMP"),
+LBR_NAME("MIDPOST.SND"),
+LBR_NAME("MMREST.GRA"),
+LBR_NAME("MONDIE.SND"),
+LBR_NAME("MOUNT.TLS"),
+LBR_NAME("MPLAT211.CMP"),
+LBR_NAME("MPLAT212.CMP"),
+LBR_NAME("MPLAT221.CMP"),
+LBR_NAME("MPLAT311.CMP"),
+LBR_NAME("MPLAT331.CMP"),
+LBR_NAME("MPLAT332.CMP"),
+LBR_NAME("MUSHSHOT.CMP"),
+LBR_NAME("MYSTIC.MUS"),
+LBR_NAME("NEWBEH.CMP"),
+LBR_NAME("OLDBEH.CMP"),
+LBR_NAME("ORDER.RES"),
+LBR_NAME("OSIRIS.MUS"),
+LBR_NAME("OUTGATE.CMP"),
+LBR_NAME("OVERHEAD.PAL"),
+LBR_NAME("OVERHEAD.TLS"),
+LBR_NAME("OVERHED1.MAP"),
+LBR_NAME("OVERHED2.MAP"),
+LBR_NAME("OVERHED3.MAP"),
+LBR_NAME("PAN2.SND"),
+LBR_NAME("PRESENT.GRA"),
+LBR_NAME("PRESENT.PAL"),
+LBR_NAME("PROWLER.MUS"),
+LBR_NAME("PURPLE.PAL"),
+LBR_NAME("PURPLE.TLS"),
+LBR_NAME("PUZZ6.MUS"),
+LBR_NAME("RABBIT.CMP"),
+LBR_NAME("RABBITD.CMP"),
+LBR_NAME("REDKEY.CMP"),
+LBR_NAME("RETROJIL.MUS"),
+LBR_NAME("RING.CMP"),
+LBR_NAME("RUFEYE.CMP"),
+LBR_NAME("RUFEYES.CMP"),
+LBR_NAME("RUFEYSE.CMP"),
+LBR_NAME("SAVEBOXG.GRA"),
+LBR_NAME("SAVEBOXO.GRA"),
+LBR_NAME("SCORE.CMP"),
+LBR_NAME("SCROLLG.CMP"),
+LBR_NAME("SCROLLO.CMP"),
+LBR_NAME("SGREENE.CMP"),
+LBR_NAME("SHOTEXPL.CMP"),
+LBR_NAME("SHOTTEST.CMP"),
+LBR_NAME("SHWRREM.GRA"),
+LBR_NAME("SIXPS.GRA"),
+LBR_NAME("SIXPS.PAL"),
+LBR_NAME("SKELBONE.CMP"),
+LBR_NAME("SKELETON.CMP"),
+LBR_NAME("SKELETON.SND"),
+LBR_NAME("SKELFLY.CMP"),
+LBR_NAME("SMALLEX.CMP"),
+LBR_NAME("SMALNUM.CMP"),
+LBR_NAME("SPARE.SCR"),
+LBR_NAME("SPIKEBA.CMP"),
+LBR_NAME("SPLADY.CMP"),
+LBR_NAME("SPLAT211.CMP"),
+LBR_NAME("SPLAT223.CMP"),
+LBR_NAME("SPLAT231.CMP"),
+LBR_NAME("SPRING.SND"),
+LBR_NAME("SPROIN.CMP"),
+LBR_NAME("SQUARE.TLS"),
+LBR_NAME("STAR.CMP"),
+LBR_NAME("STARDUST.MUS"),
+LBR_NAME("STHORNSH.CMP"),
+LBR_NAME("STICKEYE.CMP"),
+LBR_NAME("STIKHORN.CMP"),
+LBR_NAME("STLSPIKE.CMP"),
+LBR_NAME("STORY.PAL"),
+LBR_NAME("STORY.SCR"),
+LBR_NAME("STRIKE.MUS"),
+LBR_NAME("STRYFNT1.GRA"),
+LBR_NAME("SVINYL.SPR"),
+LBR_NAME("TAFA.MUS"),
+LBR_NAME("T.CMP"),
+LBR_NAME("TEST0004.CMP"),
+LBR_NAME("THROW.SND"),
+LBR_NAME("TITLE.PAL"),
+LBR_NAME("TITLE.SCR"),
+LBR_NAME("TORNADO.CMP"),
+LBR_NAME("TRAMPLE.MUS"),
+LBR_NAME("TREEMPLA.CMP"),
+LBR_NAME("TREES.PAL"),
+LBR_NAME("TREES.TLS"),
+LBR_NAME("TWILIGHT.MUS"),
+LBR_NAME("UGH.CMP"),
+LBR_NAME("UNLOGIC1.GRA"),
+LBR_NAME("UNLOGIC1.PAL"),
+LBR_NAME("UNLOGIC.UNM"),
+LBR_NAME("VINE.CMP"),
+LBR_NAME("VINYLDIE.SND"),
+LBR_NAME("VINYL.GRA"),
+LBR_NAME("VINYL.PAL"),
+LBR_NAME("VINYL.SPR"),
+LBR_NAME("VSMALLE.CMP"),
+LBR_NAME("WEAPBLNK.OMP"),
+LBR_NAME("WEAPBLUE.OMP"),
+LBR_NAME("WEAPBOTL.OMP"),
+LBR_NAME("WEAPFIRE.OMP"),
+LBR_NAME("WEAPFSKF.OMP"),
+LBR_NAME("WEAPSLKF.OMP"),
+LBR_NAME("WEAPSTAR.OMP"),
+LBR_NAME("WFIREB.CMP"),
+LBR_NAME("WOODSPIK.CMP"),
+LBR_NAME("XHUTS.PAL"),
+LBR_NAME("YELLOW.PAL"),
+LBR_NAME("YELLOW.TLS"),
+LBR_NAME("YES.CMP"),
 
 // These names were guessed by looking at others
-"ENDG1.PAL",
-"ENDG1.SCR",
-"ENDG2.PAL",
-"ENDG2.SCR",
-"ENDG3.PAL",
-"ENDG3.SCR",
-"MOUNT.PAL",
-"JUNGLE3.FON",
+LBR_NAME("ENDG1.PAL"),
+LBR_NAME("ENDG1.SCR"),
+LBR_NAME("ENDG2.PAL"),
+LBR_NAME("ENDG2.SCR"),
+LBR_NAME("ENDG3.PAL"),
+LBR_NAME("ENDG3.SCR"),
+LBR_NAME("MOUNT.PAL"),
+LBR_NAME("JUNGLE3.FON"),
 
 // These names were brute-forced from the hashes against a dictionary, so they
 // could be wrong (each hash matches about 56 billion different filenames...)
-"BEGIN.PAL",    // Also ARCHIL.PAL.   Before Bl, so probably correct.
-"P.PAL",        // Also SANGGIL.PAL.  Between O-P, maybe correct.
-"HDICFONT.GRA", // probably wrong
-"KOEWA.SND",    // almost certainly wrong, also JADEJM.SND
-"PALET1.PAL",
-"QTYFONT.GRA",
-"SHWFFONT.GRA",
-"ROLPC.TIM",    // brute forced, but correct because...
-"ROLPC.MUS",    // ...there's a matching song name too
+LBR_NAME("BEGIN.PAL"),    // Also ARCHIL.PAL.   Before Bl, so probably correct.
+LBR_NAME("P.PAL"),        // Also SANGGIL.PAL.  Between O-P, maybe correct.
+LBR_NAME("HDICFONT.GRA"), // probably wrong
+LBR_NAME("KOEWA.SND"),    // almost certainly wrong, also JADEJM.SND
+LBR_NAME("PALET1.PAL"),
+LBR_NAME("QTYFONT.GRA"),
+LBR_NAME("SHWFFONT.GRA"),
+LBR_NAME("ROLPC.TIM"),    // brute forced, but correct because...
+LBR_NAME("ROLPC.MUS"),    // ...there's a matching song name too
 
 // These names were guessed from the music filenames but with a different
 // extension for the instruments.
-"COVERUP.TIM",
-"CRUSH.TIM",
-"EVILEYE.TIM",
-"FEVER.TIM",
-"HORUS.TIM",
-"INSURED.TIM",
-"INTRO.TIM",
-"MYSTIC.TIM",
-"OSIRIS.TIM",
-"PROWLER.TIM",
-"PUZZ6.TIM",
-"RETROJIL.TIM",
-"STARDUST.TIM",
-"STRIKE.TIM",
-"TAFA.TIM",
-"TRAMPLE.TIM",
-"TWILIGHT.TIM",
+LBR_NAME("COVERUP.TIM"),
+LBR_NAME("CRUSH.TIM"),
+LBR_NAME("EVILEYE.TIM"),
+LBR_NAME("FEVER.TIM"),
+LBR_NAME("HORUS.TIM"),
+LBR_NAME("INSURED.TIM"),
+LBR_NAME("INTRO.TIM"),
+LBR_NAME("MYSTIC.TIM"),
+LBR_NAME("OSIRIS.TIM"),
+LBR_NAME("PROWLER.TIM"),
+LBR_NAME("PUZZ6.TIM"),
+LBR_NAME("RETROJIL.TIM"),
+LBR_NAME("STARDUST.TIM"),
+LBR_NAME("STRIKE.TIM"),
+LBR_NAME("TAFA.TIM"),
+LBR_NAME("TRAMPLE.TIM"),
+LBR_NAME("TWILIGHT.TIM"),
 
 // These were guessed by lemm
-"BAPPLE1.OMP",
-"BAPPLE2.OMP",
-"BAPPLE3.OMP",
-"BAPPLE4.OMP",
+LBR_NAME("BAPPLE1.OMP"),
+LBR_NAME("BAPPLE2.OMP"),
+LBR_NAME("BAPPLE3.OMP"),
+LBR_NAME("BAPPLE4.OMP"),
 
 // These were guessed by wiivn
-"SWOOSH.SND",
-"TEXTBOX.GRA",
-"TEXTBOX2.GRA",
+LBR_NAME("SWOOSH.SND"),
+LBR_NAME("TEXTBOX.GRA"),
+LBR_NAME("TEXTBOX2.GRA"),
 
 // Files used by test code
-"ONE.DAT",
-"TWO.DAT",
-"THREE.DAT",
-"FOUR.DAT",
+LBR_NAME("ONE.DAT"),
+LBR_NAME("TWO.DAT"),
+LBR_NAME("THREE.DAT"),
+LBR_NAME("FOUR.DAT"),
 
 };
 
 /// Hash function to convert filenames into LBR hashes
-int calcHash(const std::string& data)
+uint16_t calcHash(const std::string& data)
+{
+	uint16_t hash = 0;
+	for (auto c : data) hash = lbrHashByte(hash, c);
+	return hash;
+}
+
+/// Find the built-in filename matching a hash.
+/**
+ * @return The filename, or NULL if none of the known names have this hash.
+ */
+const char *lbrNameFromHash(uint16_t hash)
 {
-	int hash = 0;
-	for (std::string::const_iterator i = data.begin(); i != data.end(); i++) {
-		hash ^= *i << 8;
-		for (int j = 0; j < 8; j++) {
-			hash <<= 1;
-			if (hash & 0x10000) hash ^= 0x1021;
+	// The hashes are calculated by the compiler, but C++11 can't sort them at
+	// compile time, so an index in hash order is built the first time it's
+	// needed and shared by every archive opened after that.
+	static const std::vector<const LBRName *> byHash = []() {
+		std::vector<const LBRName *> v;
+		for (const auto& n : lbrNames) v.push_back(&n);
+		std::stable_sort(v.begin(), v.end(),
+			[](const LBRName *a, const LBRName *b) {
+				return a->hash < b->hash;
+			}
+		);
+		return v;
+	}();
+
+	// If more than one name has the same hash, use the last one in the list.
+	auto it = std::upper_bound(byHash.begin(), byHash.end(), hash,
+		[](uint16_t h, const LBRName *n) {
+			return h < n->hash;
 		}
+	);
+	if ((it == byHash.begin()) || ((*--it)->hash != hash)) return nullptr;
+	return (*it)->name;
+}
+
+uint32_t NameHash_LBR_Vinyl::initial() const
+{
+	return 0;
+}
+
+uint32_t NameHash_LBR_Vinyl::update(uint32_t state, const char *data,
+	unsigned int len) const
+{
+	uint16_t hash = state;
+	for (const char *end = data + len; data != end; data++) {
+		hash = lbrHashByte(hash, *data);
 	}
-	return hash & 0xffff;
+	return hash;
 }
 
 ArchiveType_LBR_Vinyl::ArchiveType_LBR_Vinyl()
@@ -474,12 +578,6 @@ Archive_LBR_Vinyl::Archive_LBR_Vinyl(std::unique_ptr<stream::inout> content)
 
 	if (numFiles > 0) {
 
-		// Pre-calculate all the hashes
-		std::map<int, const char *> fn;
-		for (unsigned int f = 0; f < sizeof(filenames) / sizeof(char *); f++) {
-			fn[calcHash(filenames[f])] = filenames[f];
-		}
-
 		uint32_t offNext, offCur;
 		uint16_t hashNext = 0, hashCur; // TODO: store in new LBREntry class
 		*this->content
@@ -508,9 +606,9 @@ Archive_LBR_Vinyl::Archive_LBR_Vinyl(std::unique_ptr<stream::inout> content)
 			f->type = FILETYPE_GENERIC;
 			f->fAttr = File::Attribute::Default;
 			f->bValid = true;
-			std::map<int, const char *>::iterator fnit = fn.find(hashCur);
-			if (fnit != fn.end()) {
-				f->strName = fnit->second;
+			const char *name = lbrNameFromHash(hashCur);
+			if (name) {
+				f->strName = name;
 			} else {
 				// No match, use the hash as the filename
 				std::stringstream ss;
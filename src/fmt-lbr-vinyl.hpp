@@ -23,6 +23,7 @@
 
 #include <camoto/gamearchive/archivetype.hpp>
 #include <camoto/gamearchive/archive-fat.hpp>
+#include <camoto/gamearchive/name_recovery.hpp>
 
 namespace camoto {
 namespace gamearchive {
@@ -66,6 +67,15 @@ class Archive_LBR_Vinyl: virtual public Archive_FAT
 		void updateFileCount(uint32_t iNewCount);
 };
 
+/// CRC-16 hash used by Vinyl Goddess From Mars .LBR files in place of names.
+class NameHash_LBR_Vinyl: virtual public NameHash
+{
+	public:
+		virtual uint32_t initial() const;
+		virtual uint32_t update(uint32_t state, const char *data,
+			unsigned int len) const;
+};
+
 } // namespace gamearchive
 } // namespace camoto
 
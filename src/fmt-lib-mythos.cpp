@@ -95,6 +95,13 @@ ArchiveType::Certainty ArchiveType_LIB_Mythos::isInstance(
 	return Certainty::DefinitelyYes;
 }
 
+std::vector<ArchiveType::Signature> ArchiveType_LIB_Mythos::signatures() const
+{
+	return {
+		{0, "LIB\x1A", LIB_FAT_ENTRY_LEN, 0},
+	};
+}
+
 std::shared_ptr<Archive> ArchiveType_LIB_Mythos::create(
 	std::unique_ptr<stream::inout> content, SuppData& suppData) const
 {
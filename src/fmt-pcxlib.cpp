@@ -149,6 +149,13 @@ ArchiveType::Certainty ArchiveType_PCXLib::isInstance(
 	return Certainty::DefinitelyYes;
 }
 
+std::vector<ArchiveType::Signature> ArchiveType_PCXLib::signatures() const
+{
+	return {
+		{0, "\x01\xCA", PCX_FAT_OFFSET, 0},
+	};
+}
+
 std::shared_ptr<Archive> ArchiveType_PCXLib::create(
 	std::unique_ptr<stream::inout> content, SuppData& suppData) const
 {
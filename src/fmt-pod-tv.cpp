@@ -154,6 +154,9 @@ SuppFilenames ArchiveType_POD_TV::getRequiredSupps(stream::input& content,
 Archive_POD_TV::Archive_POD_TV(std::unique_ptr<stream::inout> content)
 	:	Archive_FAT(std::move(content), POD_FIRST_FILE_OFFSET, POD_MAX_FILENAME_LEN)
 {
+	// Each FAT entry has an offset, so the data needn't be in FAT order
+	this->relocatable = true;
+
 	this->content->seekg(0, stream::start);
 	uint32_t numFiles;
 	*this->content >> u32le(numFiles);
@@ -209,6 +212,14 @@ void Archive_POD_TV::flush()
 	return;
 }
 
+void Archive_POD_TV::move(const FileHandle& idBeforeThis, const FileHandle& id)
+{
+	// TESTED BY: fmt_pod_tv_move
+	// File data can be in any order, so leave it where it is.
+	this->moveFATEntry(idBeforeThis, id, *this->content, POD_FAT_OFFSET, POD_FAT_ENTRY_LEN);
+	return;
+}
+
 void Archive_POD_TV::updateFileName(const FATEntry *pid, const std::string& strNewName)
 {
 	// TESTED BY: fmt_pod_tv_rename
@@ -55,6 +55,7 @@ class Archive_POD_TV: virtual public Archive_FAT
 		virtual ~Archive_POD_TV();
 
 		virtual void flush();
+		virtual void move(const FileHandle& idBeforeThis, const FileHandle& id);
 
 		virtual void updateFileName(const FATEntry *pid,
 			const std::string& strNewName);
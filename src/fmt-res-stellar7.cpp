@@ -123,6 +123,19 @@ std::shared_ptr<Archive> ArchiveType_RES_Stellar7::open(
 	return std::make_shared<Archive_RES_Stellar7_Folder>(std::move(content));
 }
 
+bool ArchiveType_RES_Stellar7::walksFAT() const
+{
+	return true;
+}
+
+std::shared_ptr<Archive> ArchiveType_RES_Stellar7::openIndexed(
+	std::unique_ptr<stream::inout> content, SuppData& suppData,
+	stream::input& index) const
+{
+	return std::make_shared<Archive_RES_Stellar7_Folder>(std::move(content),
+		&index);
+}
+
 SuppFilenames ArchiveType_RES_Stellar7::getRequiredSupps(stream::input& content,
 	const std::string& filename) const
 {
@@ -131,9 +144,11 @@ SuppFilenames ArchiveType_RES_Stellar7::getRequiredSupps(stream::input& content,
 
 
 Archive_RES_Stellar7_Folder::Archive_RES_Stellar7_Folder(
-	std::unique_ptr<stream::inout> content)
+	std::unique_ptr<stream::inout> content, stream::input *index)
 	:	Archive_FAT(std::move(content), RES_FIRST_FILE_OFFSET, RES_MAX_FILENAME_LEN)
 {
+	if (index && this->readIndex(*index)) return;
+
 	stream::pos lenArchive = this->content->size();
 
 	this->content->seekg(0, stream::start);
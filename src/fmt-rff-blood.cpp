@@ -21,6 +21,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <camoto/iostream_helpers.hpp>
 #include <camoto/stream_string.hpp>
@@ -100,6 +101,13 @@ ArchiveType::Certainty ArchiveType_RFF_Blood::isInstance(
 	return Certainty::DefinitelyNo;
 }
 
+std::vector<ArchiveType::Signature> ArchiveType_RFF_Blood::signatures() const
+{
+	return {
+		{0, "RFF\x1A", RFF_HEADER_LEN, 0},
+	};
+}
+
 std::shared_ptr<Archive> ArchiveType_RFF_Blood::create(
 	std::unique_ptr<stream::inout> content, SuppData& suppData) const
 {
@@ -122,6 +130,59 @@ std::shared_ptr<Archive> ArchiveType_RFF_Blood::open(
 	return std::make_shared<Archive_RFF_Blood>(std::move(content));
 }
 
+void ArchiveType_RFF_Blood::write(stream::output& content,
+	const std::vector<FileData>& files, SuppData& suppData) const
+{
+	// TESTED BY: fmt_rff_blood_new_write
+	// Check the filenames first, so nothing is written if one is invalid.
+	std::vector<std::string> bases, exts;
+	stream::len lenData = 0;
+	for (const auto& i : files) {
+		std::string name = i.strFilename, base, ext;
+		camoto::uppercase(name);
+		Archive_RFF_Blood::splitFilename(name, &base, &ext);
+		bases.push_back(base);
+		exts.push_back(ext);
+		lenData += i.content->size();
+	}
+
+	// The header is the same as create() writes, except for the FAT offset.
+	// Version 2.0 files are never encrypted, so the FAT goes after the data in
+	// the clear.
+	content.write("RFF\x1A", 4);
+	content
+		<< u32le(0x0200)
+		<< u32le(RFF_HEADER_LEN + lenData)
+		<< u32le(files.size())
+		<< u32le(0)
+		<< u32le(0)
+		<< u32le(0)
+		<< u32le(0);
+
+	for (const auto& i : files) {
+		i.content->seekg(0, stream::start);
+		stream::copy(content, *i.content);
+	}
+
+	stream::pos offFile = RFF_FIRST_FILE_OFFSET;
+	for (unsigned int n = 0; n < files.size(); n++) {
+		stream::len lenFile = files[n].content->size();
+		content
+			<< nullPadded("", 16) // unknown
+			<< u32le(offFile)
+			<< u32le(lenFile)
+			<< u32le(0) // unknown
+			<< u32le(0) // last modified time
+			<< u8(0) // flags
+			<< nullPadded(exts[n], 3)
+			<< nullPadded(bases[n], 8)
+			<< u32le(0); // unknown
+		offFile += lenFile;
+	}
+	content.flush();
+	return;
+}
+
 SuppFilenames ArchiveType_RFF_Blood::getRequiredSupps(stream::input& content,
 	const std::string& filename) const
 {
@@ -131,8 +192,13 @@ SuppFilenames ArchiveType_RFF_Blood::getRequiredSupps(stream::input& content,
 
 Archive_RFF_Blood::Archive_RFF_Blood(std::unique_ptr<stream::inout> content)
 	:	Archive_FAT(std::move(content), RFF_FIRST_FILE_OFFSET, ARCH_STD_DOS_FILENAMES),
-		modifiedFAT(false)
+		fatDirtyStart(0),
+		fatDirtyEnd(0),
+		fatInPlace(false)
 {
+	// Every file has its own offset so they can be stored in any order
+	this->relocatable = true;
+
 	stream::pos lenArchive = this->content->size();
 
 	if (lenArchive < 16) throw stream::error("File too short");
@@ -183,6 +249,9 @@ Archive_RFF_Blood::Archive_RFF_Blood(std::unique_ptr<stream::inout> content)
 
 	this->fatStream->seekg(0, stream::start);
 
+	this->offFATHeader = offFAT;
+	this->fatSeed = offFAT & 0xFF;
+
 	for (unsigned int i = 0; i < numFiles; i++) {
 		auto f = this->createNewFATEntry();
 
@@ -221,6 +290,11 @@ Archive_RFF_Blood::Archive_RFF_Blood(std::unique_ptr<stream::inout> content)
 		this->vcFAT.push_back(std::move(f));
 	}
 
+	// If nothing is stored between the files and the FAT, and nothing follows
+	// the FAT, later changes can update the FAT where it is.
+	this->fatInPlace = (offFAT == this->endOfData())
+		&& (lenArchive == offFAT + numFiles * RFF_FAT_ENTRY_LEN);
+
 	// Populate attributes
 	this->v_attributes.emplace_back();
 	auto& attrVer = this->v_attributes.back();
@@ -285,6 +359,9 @@ void Archive_RFF_Blood::attribute(unsigned int index, int newValue)
 		*this->content << u16le(this->version);
 		*this->content << u16le(0); // TODO: write 1 here for 0x200?
 
+		// The FAT is encrypted differently in the new version
+		this->markFATChanged(0, this->vcFAT.size() * RFF_FAT_ENTRY_LEN);
+
 		this->v_attributes[0].changed = false;
 	}
 	return;
@@ -292,75 +369,98 @@ void Archive_RFF_Blood::attribute(unsigned int index, int newValue)
 
 void Archive_RFF_Blood::flush()
 {
-	if (this->modifiedFAT) {
+	// The FAT goes after the last file, which won't be the last one in the FAT
+	// if free space is being used.
+	uint32_t offFAT = this->endOfData();
+	stream::len lenFAT = this->vcFAT.size() * RFF_FAT_ENTRY_LEN;
 
-		// Write the new FAT offset into the file header
-		uint32_t offFAT;
-		if (this->vcFAT.size() == 0) {
-			// No files
-			offFAT = RFF_FIRST_FILE_OFFSET;
-		} else {
-			const FATEntry *pLast = dynamic_cast<const FATEntry *>(this->vcFAT.back().get());
-			assert(pLast);
-			offFAT = pLast->iOffset + pLast->lenHeader + pLast->storedSize;
-		}
-		this->content->seekp(RFF_FATOFFSET_OFFSET, stream::start);
-		*this->content << u32le(offFAT);
+	if ((this->fatDirtyStart < this->fatDirtyEnd) || (offFAT != this->offFATHeader)) {
 
 		// Work out how much to add to or remove from the end of the archive so that
 		// it ends immediately following the FAT.
 		stream::pos lenArchive = this->content->size();
-		stream::pos offEndFAT = offFAT + this->vcFAT.size() * RFF_FAT_ENTRY_LEN;
-		stream::delta lenDelta = offEndFAT - lenArchive;
-
-		// If we need to make room for a larger FAT, do that now so there's room to
-		// commit it.  If we're removing data we'll do that later.
-		if (lenDelta > 0) {
-			//this->content->seekp(offEndFAT, stream::start);
-			this->content->seekp(offFAT, stream::start);
-			this->content->insert(lenDelta);
-
-		} else if (lenDelta < 0) {
-			// If there's extra data in the archive following the FAT, remove that now.
-			// This will remove data from the FAT but that's ok because we have it all
-			// in memory and we're about to write it out.
-			//this->content->seekp(offEndFAT, stream::start);
-			this->content->seekp(offFAT, stream::start);
-			this->content->remove(-lenDelta);
-		}
 
-		// Write the FAT back out
-
-		// Create a substream to decrypt the FAT
-		auto fatSubStream = std::make_shared<stream::sub>(
-			this->content,
-			offFAT,
-			this->vcFAT.size() * RFF_FAT_ENTRY_LEN,
-			stream::fn_truncate_sub()
-		);
+		if (this->fatInPlace) {
+			// The FAT written last time is still just after the file data, so any
+			// entries added or removed only change the end of it.  New entries are
+			// always dirty so they will be written below.
+			stream::len lenOldFAT = lenArchive - offFAT;
+			if (lenFAT > lenOldFAT) {
+				this->content->seekp(lenArchive, stream::start);
+				this->content->insert(lenFAT - lenOldFAT);
+			} else if (lenFAT < lenOldFAT) {
+				this->content->seekp(offFAT + lenFAT, stream::start);
+				this->content->remove(lenOldFAT - lenFAT);
+			}
 
-		std::shared_ptr<stream::output> fatPlaintext;
-		if (this->version >= 0x301) {
-			// The FAT is encrypted in this version
-			fatPlaintext = std::make_shared<stream::output_filtered>(
-				fatSubStream,
-				std::make_shared<filter_rff_crypt>(0, offFAT & 0xFF),
-				stream::fn_notify_prefiltered_size()
-			);
+			// If the FAT has moved the key changes, so it all has to be encrypted
+			// again.
+			if ((this->version >= 0x301) && ((offFAT & 0xFF) != this->fatSeed)) {
+				this->markFATChanged(0, lenFAT);
+			}
 		} else {
-			fatPlaintext = fatSubStream;
+			stream::pos offEndFAT = offFAT + lenFAT;
+			stream::delta lenDelta = offEndFAT - lenArchive;
+
+			// If we need to make room for a larger FAT, do that now so there's room to
+			// commit it.  If we're removing data we'll do that later.
+			if (lenDelta > 0) {
+				//this->content->seekp(offEndFAT, stream::start);
+				this->content->seekp(offFAT, stream::start);
+				this->content->insert(lenDelta);
+
+			} else if (lenDelta < 0) {
+				// If there's extra data in the archive following the FAT, remove that now.
+				// This will remove data from the FAT but that's ok because we have it all
+				// in memory and we're about to write it out.
+				//this->content->seekp(offEndFAT, stream::start);
+				this->content->seekp(offFAT, stream::start);
+				this->content->remove(-lenDelta);
+			}
+			this->markFATChanged(0, lenFAT);
 		}
 
-		this->fatStream->seekg(0, stream::start);
-		stream::copy(*fatPlaintext, *this->fatStream);
-		// Need to flush here because we're going to access the underlying stream
-		fatPlaintext->flush();
+		// Write the changed part of the FAT back out.  Each pair of bytes shares
+		// a key, so start on an even byte to be able to work out the key.
+		stream::pos start = this->fatDirtyStart & ~(stream::pos)1;
+		stream::pos end = std::min<stream::pos>(this->fatDirtyEnd, lenFAT);
+		if (start < end) {
+			auto fatSubStream = std::make_shared<stream::sub>(
+				this->content,
+				offFAT + start,
+				end - start,
+				stream::fn_truncate_sub()
+			);
+
+			std::shared_ptr<stream::output> fatPlaintext;
+			if (this->version >= 0x301) {
+				// The FAT is encrypted in this version
+				fatPlaintext = std::make_shared<stream::output_filtered>(
+					fatSubStream,
+					std::make_shared<filter_rff_crypt>(0,
+						(offFAT & 0xFF) + (start >> 1)),
+					stream::fn_notify_prefiltered_size()
+				);
+			} else {
+				fatPlaintext = fatSubStream;
+			}
+
+			std::string changed;
+			this->fatStream->seekg(start, stream::start);
+			*this->fatStream >> fixedLength(changed, end - start);
+			fatPlaintext->write(changed);
+			// Need to flush here because we're going to access the underlying stream
+			fatPlaintext->flush();
+		}
 
 		// Write the new FAT offset into the file header
 		this->content->seekp(RFF_FATOFFSET_OFFSET, stream::start);
 		*this->content << u32le(offFAT);
 
-		this->modifiedFAT = false;
+		this->offFATHeader = offFAT;
+		this->fatSeed = offFAT & 0xFF;
+		this->fatInPlace = true;
+		this->fatDirtyStart = this->fatDirtyEnd = 0;
 	}
 
 	// Commit this->content
@@ -368,6 +468,19 @@ void Archive_RFF_Blood::flush()
 	return;
 }
 
+void Archive_RFF_Blood::move(const FileHandle& idBeforeThis, const FileHandle& id)
+{
+	// TESTED BY: fmt_rff_blood_move
+	unsigned int indexOld = FATEntry::cast(id)->iIndex;
+	this->moveFATEntry(idBeforeThis, id, *this->fatStream, 0, RFF_FAT_ENTRY_LEN);
+	unsigned int indexNew = FATEntry::cast(id)->iIndex;
+	this->markFATChanged(
+		std::min(indexOld, indexNew) * RFF_FAT_ENTRY_LEN,
+		(std::max(indexOld, indexNew) + 1) * RFF_FAT_ENTRY_LEN
+	);
+	return;
+}
+
 void Archive_RFF_Blood::updateFileName(const FATEntry *pid, const std::string& strNewName)
 {
 	// TESTED BY: fmt_rff_blood_rename
@@ -383,7 +496,7 @@ void Archive_RFF_Blood::updateFileName(const FATEntry *pid, const std::string& s
 		<< nullPadded(ext, 3)
 		<< nullPadded(base, 8);
 
-	this->modifiedFAT = true;
+	this->markFATChanged(RFF_FILENAME_OFFSET(pid), RFF_FILENAME_OFFSET(pid) + 11);
 	return;
 }
 
@@ -393,7 +506,7 @@ void Archive_RFF_Blood::updateFileOffset(const FATEntry *pid, stream::delta offD
 	// TESTED BY: fmt_rff_blood_resize*
 	this->fatStream->seekp(RFF_FILEOFFSET_OFFSET(pid), stream::start);
 	*this->fatStream << u32le(pid->iOffset);
-	this->modifiedFAT = true;
+	this->markFATChanged(RFF_FILEOFFSET_OFFSET(pid), RFF_FILEOFFSET_OFFSET(pid) + 4);
 	return;
 }
 
@@ -403,7 +516,7 @@ void Archive_RFF_Blood::updateFileSize(const FATEntry *pid, stream::delta sizeDe
 	// TESTED BY: fmt_rff_blood_resize*
 	this->fatStream->seekp(RFF_FILESIZE_OFFSET(pid), stream::start);
 	*this->fatStream << u32le(pid->storedSize);
-	this->modifiedFAT = true;
+	this->markFATChanged(RFF_FILESIZE_OFFSET(pid), RFF_FILESIZE_OFFSET(pid) + 4);
 	return;
 }
 
@@ -447,7 +560,9 @@ void Archive_RFF_Blood::preInsertFile(const FATEntry *idBeforeThis,
 		<< nullPadded(base, 8)
 		<< u32le(0); // unknown
 
-	this->modifiedFAT = true;
+	// Every entry from here on has moved
+	this->markFATChanged(RFF_FATENTRY_OFFSET(pNewEntry),
+		this->fatStream->size());
 	return;
 }
 
@@ -461,7 +576,8 @@ void Archive_RFF_Blood::preRemoveFile(const FATEntry *pid)
 {
 	this->fatStream->seekp(RFF_FATENTRY_OFFSET(pid), stream::start);
 	this->fatStream->remove(RFF_FAT_ENTRY_LEN);
-	this->modifiedFAT = true;
+	// Every entry from here on has moved
+	this->markFATChanged(RFF_FATENTRY_OFFSET(pid), this->fatStream->size());
 	return;
 }
 
@@ -471,6 +587,19 @@ void Archive_RFF_Blood::postRemoveFile(const FATEntry *pid)
 	return;
 }
 
+void Archive_RFF_Blood::markFATChanged(stream::pos start, stream::pos end)
+{
+	if (start >= end) return;
+	if (this->fatDirtyStart >= this->fatDirtyEnd) {
+		this->fatDirtyStart = start;
+		this->fatDirtyEnd = end;
+	} else {
+		this->fatDirtyStart = std::min(this->fatDirtyStart, start);
+		this->fatDirtyEnd = std::max(this->fatDirtyEnd, end);
+	}
+	return;
+}
+
 void Archive_RFF_Blood::updateFileCount(uint32_t newCount)
 {
 	this->content->seekp(RFF_FILECOUNT_OFFSET, stream::start);
@@ -42,10 +42,13 @@ class ArchiveType_RFF_Blood: virtual public ArchiveType
 		virtual std::vector<std::string> fileExtensions() const;
 		virtual std::vector<std::string> games() const;
 		virtual ArchiveType::Certainty isInstance(stream::input& content) const;
+		virtual std::vector<Signature> signatures() const;
 		virtual std::shared_ptr<Archive> create(
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
 		virtual std::shared_ptr<Archive> open(
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
+		virtual void write(stream::output& content,
+			const std::vector<FileData>& files, SuppData& suppData) const;
 		virtual SuppFilenames getRequiredSupps(stream::input& content,
 			const std::string& filename) const;
 };
@@ -61,6 +64,7 @@ class Archive_RFF_Blood: virtual public Archive_FAT
 
 		/// Write out the FAT with the updated encryption key.
 		virtual void flush();
+		virtual void move(const FileHandle& idBeforeThis, const FileHandle& id);
 
 		virtual void updateFileName(const FATEntry *pid,
 			const std::string& strNewName);
@@ -72,18 +76,37 @@ class Archive_RFF_Blood: virtual public Archive_FAT
 		virtual void preRemoveFile(const FATEntry *pid);
 		virtual void postRemoveFile(const FATEntry *pid);
 
+		/// Split a filename into the 8.3 parts stored in the FAT.
+		/**
+		 * @throw stream::error
+		 *   The filename is too long.
+		 */
+		static void splitFilename(const std::string& full, std::string *base,
+			std::string *ext);
+
 	protected:
 		/// In-memory stream storing the cleartext FAT
 		std::unique_ptr<stream::seg> fatStream;
 		uint32_t version;            ///< File format version
-		bool modifiedFAT;            ///< Has the FAT been changed?
+		stream::pos fatDirtyStart;   ///< First changed byte in fatStream
+		stream::pos fatDirtyEnd;     ///< One past the last changed byte
+		stream::pos offFATHeader;    ///< FAT offset last written to the header
+		uint8_t fatSeed;             ///< Key the on-disk FAT is encrypted with
+
+		/// Is the FAT on disk immediately after the last file?
+		/**
+		 * If true, the FAT last written out is still intact at the end of the
+		 * archive (any file data changes happen before it) so only the parts of
+		 * the FAT that have changed need to be written out again.
+		 */
+		bool fatInPlace;
+
+		/// Mark part of fatStream as needing to be written out on flush.
+		void markFATChanged(stream::pos start, stream::pos end);
 
 		void updateFileCount(uint32_t newCount);
 
 		stream::pos getDescOffset() const;
-
-		void splitFilename(const std::string& full, std::string *base,
-			std::string *ext);
 };
 
 } // namespace gamearchive
@@ -106,6 +106,14 @@ ArchiveType::Certainty ArchiveType_WAD_Doom::isInstance(
 	return Certainty::DefinitelyNo;
 }
 
+std::vector<ArchiveType::Signature> ArchiveType_WAD_Doom::signatures() const
+{
+	return {
+		{0, "IWAD", WAD_HEADER_LEN, 0},
+		{0, "PWAD", WAD_HEADER_LEN, 0},
+	};
+}
+
 std::shared_ptr<Archive> ArchiveType_WAD_Doom::create(
 	std::unique_ptr<stream::inout> content, SuppData& suppData) const
 {
@@ -120,6 +128,40 @@ std::shared_ptr<Archive> ArchiveType_WAD_Doom::open(
 	return std::make_shared<Archive_WAD_Doom>(std::move(content));
 }
 
+void ArchiveType_WAD_Doom::write(stream::output& content,
+	const std::vector<FileData>& files, SuppData& suppData) const
+{
+	// TESTED BY: fmt_wad_doom_new_write
+	// Put the FAT straight after the header like create() does.  The offsets
+	// can all be worked out from the file sizes before writing any data.
+	content.write("IWAD", 4);
+	content
+		<< u32le(files.size())
+		<< u32le(WAD_FAT_OFFSET);
+
+	stream::pos offFile = WAD_FAT_OFFSET + files.size() * WAD_FAT_ENTRY_LEN;
+	for (const auto& i : files) {
+		if (i.strFilename.length() > WAD_MAX_FILENAME_LEN) {
+			throw stream::error(createString("maximum filename length is "
+				<< WAD_MAX_FILENAME_LEN << " chars"));
+		}
+		std::string name = i.strFilename;
+		camoto::uppercase(name);
+		stream::len lenFile = i.content->size();
+		content
+			<< u32le(offFile)
+			<< u32le(lenFile)
+			<< nullPadded(name, WAD_FILENAME_FIELD_LEN);
+		offFile += lenFile;
+	}
+	for (const auto& i : files) {
+		i.content->seekg(0, stream::start);
+		stream::copy(content, *i.content);
+	}
+	content.flush();
+	return;
+}
+
 SuppFilenames ArchiveType_WAD_Doom::getRequiredSupps(stream::input& content,
 	const std::string& filename) const
 {
@@ -130,6 +172,9 @@ SuppFilenames ArchiveType_WAD_Doom::getRequiredSupps(stream::input& content,
 Archive_WAD_Doom::Archive_WAD_Doom(std::unique_ptr<stream::inout> content)
 	:	Archive_FAT(std::move(content), WAD_FIRST_FILE_OFFSET, WAD_MAX_FILENAME_LEN)
 {
+	// Lumps are found by the offset in their FAT entry, so can go anywhere
+	this->relocatable = true;
+
 	this->content->seekg(4, stream::start); // skip sig
 
 	// We still have to perform sanity checks in case the user forced an archive
@@ -210,6 +255,14 @@ void Archive_WAD_Doom::flush()
 	return;
 }
 
+void Archive_WAD_Doom::move(const FileHandle& idBeforeThis, const FileHandle& id)
+{
+	// TESTED BY: fmt_wad_doom_move
+	// The FAT holds the offset of each file, so only the entry needs to move.
+	this->moveFATEntry(idBeforeThis, id, *this->content, WAD_FAT_OFFSET, WAD_FAT_ENTRY_LEN);
+	return;
+}
+
 void Archive_WAD_Doom::updateFileName(const FATEntry *pid, const std::string& strNewName)
 {
 	// TESTED BY: fmt_wad_doom_rename
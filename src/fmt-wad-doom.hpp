@@ -39,10 +39,13 @@ class ArchiveType_WAD_Doom: virtual public ArchiveType
 		virtual std::vector<std::string> fileExtensions() const;
 		virtual std::vector<std::string> games() const;
 		virtual ArchiveType::Certainty isInstance(stream::input& content) const;
+		virtual std::vector<Signature> signatures() const;
 		virtual std::shared_ptr<Archive> create(
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
 		virtual std::shared_ptr<Archive> open(
 			std::unique_ptr<stream::inout> content, SuppData& suppData) const;
+		virtual void write(stream::output& content,
+			const std::vector<FileData>& files, SuppData& suppData) const;
 		virtual SuppFilenames getRequiredSupps(stream::input& content,
 			const std::string& filename) const;
 };
@@ -55,6 +58,7 @@ class Archive_WAD_Doom: virtual public Archive_FAT
 		virtual ~Archive_WAD_Doom();
 
 		virtual void flush();
+		virtual void move(const FileHandle& idBeforeThis, const FileHandle& id);
 
 		virtual void updateFileName(const FATEntry *pid,
 			const std::string& strNewName);
@@ -18,6 +18,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <unordered_map>
 #include <camoto/gamearchive/manager.hpp>
 
 // Include all the file formats for the Manager to load
@@ -75,81 +76,124 @@ using namespace camoto::gamearchive;
 
 namespace camoto {
 
+/// Build a map of format codes to handlers, for byCode().
+template <class T>
+static std::unordered_map<std::string, typename FormatEnumerator<T>::handler_t>
+	mapFormats(const std::vector<std::shared_ptr<const T> >& list)
+{
+	std::unordered_map<std::string, typename FormatEnumerator<T>::handler_t> map;
+	for (const auto& i : list) {
+		// If two handlers share a code, the first one wins just as it did when
+		// byCode() searched the list in order.
+		map.emplace(i->code(), i);
+	}
+	return map;
+}
+
+// The handler lists are function-local statics, so they are created once in a
+// thread-safe manner on first use, and never modified afterwards.
+
 template <>
 const std::vector<std::shared_ptr<const ArchiveType> > CAMOTO_GAMEARCHIVE_API
 	FormatEnumerator<ArchiveType>::formats()
 {
-	std::vector<std::shared_ptr<const ArchiveType> > list;
-	FormatEnumerator<ArchiveType>::addFormat<
-		ArchiveType_BNK_Harry,
-		ArchiveType_BPA_DRally,
-		ArchiveType_DAT_Bash,
-		ArchiveType_DAT_GoT,
-		ArchiveType_DAT_Highway,
-		ArchiveType_DAT_LostVikings,
-		ArchiveType_DAT_Mystic,
-		ArchiveType_DAT_Riptide,
-		ArchiveType_DAT_Sango,
-		ArchiveType_DAT_Wacky,
-		ArchiveType_DAT_Zool,
-		ArchiveType_DLT_Stargunner,
-		ArchiveType_EPF_LionKing,
-		ArchiveType_EXE_CCaves,
-		ArchiveType_EXE_DDave,
-		ArchiveType_GLB_Galactix,
-		ArchiveType_GLB_Raptor,
-		ArchiveType_GRP_Duke3D,
-		ArchiveType_GWx_HomeBrew,
-		ArchiveType_HOG_Descent,
-		ArchiveType_LBR_Vinyl,
-		ArchiveType_LIB_Mythos,
-		ArchiveType_PCXLib,
-		ArchiveType_POD_TV,
-		ArchiveType_RES_Stellar7,
-		ArchiveType_RFF_Blood,
-		ArchiveType_Roads_SkyRoads,
-		ArchiveType_Resource_TIM_FAT,
-		ArchiveType_Resource_TIM,
-		ArchiveType_VOL_Cosmo,
-		ArchiveType_WAD_Doom,
-		// The following formats are difficult to autodetect, so putting them last
-		// means they should only be checked if all the more robust formats above
-		// have already failed to match.
-		ArchiveType_CUR_Prehistorik,
-		ArchiveType_GD_Doofus,
-		ArchiveType_DAT_Hugo,
-		ArchiveType_DAT_Hocus,
-		ArchiveType_DA_Levels
-	>(list);
+	static const auto list = []() {
+		std::vector<std::shared_ptr<const ArchiveType> > list;
+		FormatEnumerator<ArchiveType>::addFormat<
+			ArchiveType_BNK_Harry,
+			ArchiveType_BPA_DRally,
+			ArchiveType_DAT_Bash,
+			ArchiveType_DAT_GoT,
+			ArchiveType_DAT_Highway,
+			ArchiveType_DAT_LostVikings,
+			ArchiveType_DAT_Mystic,
+			ArchiveType_DAT_Riptide,
+			ArchiveType_DAT_Sango,
+			ArchiveType_DAT_Wacky,
+			ArchiveType_DAT_Zool,
+			ArchiveType_DLT_Stargunner,
+			ArchiveType_EPF_LionKing,
+			ArchiveType_EXE_CCaves,
+			ArchiveType_EXE_DDave,
+			ArchiveType_GLB_Galactix,
+			ArchiveType_GLB_Raptor,
+			ArchiveType_GRP_Duke3D,
+			ArchiveType_GWx_HomeBrew,
+			ArchiveType_HOG_Descent,
+			ArchiveType_LBR_Vinyl,
+			ArchiveType_LIB_Mythos,
+			ArchiveType_PCXLib,
+			ArchiveType_POD_TV,
+			ArchiveType_RES_Stellar7,
+			ArchiveType_RFF_Blood,
+			ArchiveType_Roads_SkyRoads,
+			ArchiveType_Resource_TIM_FAT,
+			ArchiveType_Resource_TIM,
+			ArchiveType_VOL_Cosmo,
+			ArchiveType_WAD_Doom,
+			// The following formats are difficult to autodetect, so putting them last
+			// means they should only be checked if all the more robust formats above
+			// have already failed to match.
+			ArchiveType_CUR_Prehistorik,
+			ArchiveType_GD_Doofus,
+			ArchiveType_DAT_Hugo,
+			ArchiveType_DAT_Hocus,
+			ArchiveType_DA_Levels
+		>(list);
+		return list;
+	}();
 	return list;
 }
 
+template <>
+CAMOTO_GAMEARCHIVE_API FormatEnumerator<ArchiveType>::handler_t
+	FormatEnumerator<ArchiveType>::byCode(const std::string& code)
+{
+	static const auto map = mapFormats(FormatEnumerator<ArchiveType>::formats());
+	auto i = map.find(code);
+	if (i == map.end()) return nullptr;
+	return i->second;
+}
+
 template <>
 const std::vector<std::shared_ptr<const FilterType> > CAMOTO_GAMEARCHIVE_API
 	FormatEnumerator<FilterType>::formats()
 {
-	std::vector<std::shared_ptr<const FilterType> > list;
-	FormatEnumerator<FilterType>::addFormat<
-		FilterType_Bash,
-		FilterType_DDaveRLE,
-		FilterType_DAT_GOT,
-		FilterType_EPFS,
-		FilterType_GLB_Raptor_FAT,
-		FilterType_GLB_Raptor_File,
-		FilterType_Prehistorik,
-		FilterType_RFF,
-		FilterType_SAM_16Sprite,
-		FilterType_SAM_8Sprite,
-		FilterType_SAM_Map,
-		FilterType_SkyRoads,
-		FilterType_Stargunner,
-		FilterType_Stellar7,
-		FilterType_XOR,
-		FilterType_Zone66
-	>(list);
+	static const auto list = []() {
+		std::vector<std::shared_ptr<const FilterType> > list;
+		FormatEnumerator<FilterType>::addFormat<
+			FilterType_Bash,
+			FilterType_DDaveRLE,
+			FilterType_DAT_GOT,
+			FilterType_EPFS,
+			FilterType_GLB_Raptor_FAT,
+			FilterType_GLB_Raptor_File,
+			FilterType_Prehistorik,
+			FilterType_RFF,
+			FilterType_SAM_16Sprite,
+			FilterType_SAM_8Sprite,
+			FilterType_SAM_Map,
+			FilterType_SkyRoads,
+			FilterType_Stargunner,
+			FilterType_Stellar7,
+			FilterType_XOR,
+			FilterType_Zone66
+		>(list);
+		return list;
+	}();
 	return list;
 }
 
+template <>
+CAMOTO_GAMEARCHIVE_API FormatEnumerator<FilterType>::handler_t
+	FormatEnumerator<FilterType>::byCode(const std::string& code)
+{
+	static const auto map = mapFormats(FormatEnumerator<FilterType>::formats());
+	auto i = map.find(code);
+	if (i == map.end()) return nullptr;
+	return i->second;
+}
+
 namespace gamearchive {
 
 constexpr CAMOTO_GAMEARCHIVE_API const char* const ArchiveType::obj_t_name;
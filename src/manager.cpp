@@ -0,0 +1,361 @@
+/**
+ * @file  manager.cpp
+ * @brief Format detection shared by all the ArchiveType handlers.
+ *
+ * Copyright (C) 2010-2016 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <camoto/gamearchive/manager.hpp>
+
+/// Largest file probeFormatsParallel() will load into memory.
+#define PROBE_BUFFER_MAX  (64 * 1024 * 1024)
+
+namespace camoto {
+namespace gamearchive {
+
+/// Can the signature apply to a file of this size?
+static bool signatureLengthOK(const ArchiveType::Signature& sig,
+	stream::len lenArchive)
+{
+	if (lenArchive < sig.lenMin) return false;
+	if ((sig.lenExact != 0) && (lenArchive != sig.lenExact)) return false;
+	if (lenArchive < sig.offset + sig.magic.length()) return false;
+	return true;
+}
+
+/// Work out how much of the file must be read to check these signatures.
+static stream::len signatureHeaderLength(
+	const std::vector<ArchiveType::Signature>& sigs, stream::len lenArchive)
+{
+	stream::len lenHeader = 0;
+	for (const auto& sig : sigs) {
+		// Don't bother reading data for signatures that will fail anyway (this
+		// stops the .exe signatures from reading in half the file.)
+		if (!signatureLengthOK(sig, lenArchive)) continue;
+		lenHeader = std::max(lenHeader, sig.offset + sig.magic.length());
+	}
+	return lenHeader;
+}
+
+/// Do any of the signatures match the given file header?
+static bool signatureHeaderMatches(
+	const std::vector<ArchiveType::Signature>& sigs, const std::string& header,
+	stream::len lenArchive)
+{
+	for (const auto& sig : sigs) {
+		if (!signatureLengthOK(sig, lenArchive)) continue;
+		if (header.compare(sig.offset, sig.magic.length(), sig.magic) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/// Read the first lenHeader bytes of the stream.
+static std::string readHeader(stream::input& content, stream::len lenHeader)
+{
+	std::string header(lenHeader, '\0');
+	if (lenHeader) {
+		content.seekg(0, stream::start);
+		content.read(&header[0], lenHeader);
+	}
+	return header;
+}
+
+bool signatureMatches(const ArchiveType& type, stream::input& content)
+{
+	auto sigs = type.signatures();
+	if (sigs.empty()) return true;
+
+	stream::len lenArchive = content.size();
+	auto header = readHeader(content, signatureHeaderLength(sigs, lenArchive));
+	return signatureHeaderMatches(sigs, header, lenArchive);
+}
+
+/// Split the known formats into those that need probing.
+/**
+ * @param content
+ *   Stream to examine.
+ *
+ * @param withSig
+ *   On return, the formats whose signature matched the content.
+ *
+ * @param withoutSig
+ *   On return, the formats that have no signature and can only be detected
+ *   heuristically.
+ */
+static void selectCandidates(stream::input& content,
+	std::vector<ArchiveManager::handler_t> *withSig,
+	std::vector<ArchiveManager::handler_t> *withoutSig)
+{
+	stream::len lenArchive = content.size();
+
+	auto formats = ArchiveManager::formats();
+	std::vector<std::vector<ArchiveType::Signature>> sigs;
+	sigs.reserve(formats.size());
+
+	// Collect the signatures and read enough of the file to check them all
+	stream::len lenHeader = 0;
+	for (const auto& i : formats) {
+		sigs.push_back(i->signatures());
+		lenHeader = std::max(lenHeader,
+			signatureHeaderLength(sigs.back(), lenArchive));
+	}
+	auto header = readHeader(content, lenHeader);
+
+	for (unsigned int i = 0; i < formats.size(); i++) {
+		if (sigs[i].empty()) {
+			withoutSig->push_back(formats[i]);
+		} else if (signatureHeaderMatches(sigs[i], header, lenArchive)) {
+			withSig->push_back(formats[i]);
+		}
+	}
+	return;
+}
+
+/// Call isInstance() on each candidate in turn, stopping at DefinitelyYes.
+static std::vector<ProbeResult> probeSequential(
+	const std::vector<ArchiveManager::handler_t>& candidates,
+	stream::input& content)
+{
+	std::vector<ProbeResult> results;
+	for (const auto& i : candidates) {
+		auto cert = i->isInstance(content);
+		if (cert == ArchiveType::Certainty::DefinitelyNo) continue;
+
+		results.push_back({i, cert});
+		if (cert == ArchiveType::Certainty::DefinitelyYes) break;
+	}
+	return results;
+}
+
+std::vector<ProbeResult> probeFormats(stream::input& content)
+{
+	std::vector<ArchiveManager::handler_t> withSig, withoutSig;
+	selectCandidates(content, &withSig, &withoutSig);
+
+	auto results = probeSequential(withSig, content);
+
+	// If something with a signature recognised the file, don't go on to run the
+	// heuristic checks as they're slower and less reliable.
+	if (!results.empty()) return results;
+
+	return probeSequential(withoutSig, content);
+}
+
+/// Thrown out of a probe that is no longer needed, to stop it early.
+/**
+ * This is deliberately not derived from std::exception or stream::error, so
+ * that format handlers which catch read errors and return DefinitelyNo don't
+ * catch it too.
+ */
+struct probe_cancelled
+{
+};
+
+/// Read-only stream over a buffer shared between probe threads.
+/**
+ * Each thread gets its own instance so it has its own read position, but
+ * the file data itself is only loaded once.
+ *
+ * Every read and seek checks whether the probe is still wanted, and throws
+ * probe_cancelled if not, so a probe stops at its next access to the file
+ * rather than running to the end.
+ */
+class input_probe_buffer: virtual public stream::input
+{
+	public:
+		/// Create a view over the shared data.
+		/**
+		 * @param data
+		 *   File content to share.
+		 *
+		 * @param firstDefinite
+		 *   Index of the earliest candidate to return DefinitelyYes so far.
+		 *   Probes for any candidate after this one are cancelled.
+		 */
+		input_probe_buffer(std::shared_ptr<const std::string> data,
+			const std::atomic<unsigned int>& firstDefinite)
+			:	data(data),
+				offset(0),
+				firstDefinite(firstDefinite),
+				index(0)
+		{
+		}
+
+		/// Rewind and start probing a new candidate.
+		void start(unsigned int index)
+		{
+			this->index = index;
+			this->offset = 0;
+			return;
+		}
+
+		virtual stream::len try_read(uint8_t *buffer, stream::len len)
+		{
+			this->checkCancelled();
+			if (this->offset >= this->data->length()) return 0;
+			len = std::min<stream::len>(len, this->data->length() - this->offset);
+			memcpy(buffer, this->data->data() + this->offset, len);
+			this->offset += len;
+			return len;
+		}
+
+		virtual void seekg(stream::delta off, stream::seek_from from)
+		{
+			this->checkCancelled();
+			stream::delta base;
+			switch (from) {
+				case stream::start: base = 0; break;
+				case stream::cur: base = this->offset; break;
+				case stream::end: base = this->data->length(); break;
+				default: base = 0; break;
+			}
+			stream::delta target = base + off;
+			if ((target < 0) || ((stream::len)target > this->data->length())) {
+				throw stream::seek_error("Cannot seek beyond the end of the probe "
+					"buffer.");
+			}
+			this->offset = target;
+			return;
+		}
+
+		virtual stream::pos tellg() const
+		{
+			return this->offset;
+		}
+
+		virtual stream::len size() const
+		{
+			return this->data->length();
+		}
+
+	protected:
+		std::shared_ptr<const std::string> data;
+		stream::pos offset;
+		const std::atomic<unsigned int>& firstDefinite;
+		unsigned int index; ///< Candidate currently being probed
+
+		/// Abort the probe if an earlier candidate has already matched.
+		void checkCancelled() const
+		{
+			if (this->index > this->firstDefinite) throw probe_cancelled();
+			return;
+		}
+};
+
+/// Call isInstance() on the candidates concurrently.
+/**
+ * Candidates are handed out to the threads in list order.  Once a probe
+ * returns DefinitelyYes, any candidate after it that has not yet started is
+ * skipped, and any that are already running are stopped the next time they
+ * read from or seek in the file.  This produces exactly the same list
+ * probeSequential() would.
+ */
+static std::vector<ProbeResult> probeParallel(
+	const std::vector<ArchiveManager::handler_t>& candidates,
+	std::shared_ptr<const std::string> data, unsigned int numThreads)
+{
+	unsigned int count = candidates.size();
+	std::vector<ArchiveType::Certainty> certs(count,
+		ArchiveType::Certainty::DefinitelyNo);
+	std::vector<std::exception_ptr> errors(count);
+
+	std::atomic<unsigned int> next(0);
+	// Index of the earliest DefinitelyYes seen so far
+	std::atomic<unsigned int> firstDefinite(count);
+
+	auto worker = [&]() {
+		input_probe_buffer view(data, firstDefinite);
+		for (;;) {
+			unsigned int i = next++;
+			if (i >= count) break;
+			// Something earlier in the list has already matched
+			if (i > firstDefinite) break;
+			view.start(i);
+			try {
+				certs[i] = candidates[i]->isInstance(view);
+			} catch (const probe_cancelled&) {
+				// Result is no longer needed, and nothing after it will be either
+				certs[i] = ArchiveType::Certainty::DefinitelyNo;
+				break;
+			} catch (...) {
+				errors[i] = std::current_exception();
+				continue;
+			}
+			if (certs[i] == ArchiveType::Certainty::DefinitelyYes) {
+				unsigned int cur = firstDefinite;
+				while (
+					(i < cur)
+					&& !firstDefinite.compare_exchange_weak(cur, i)
+				);
+			}
+		}
+	};
+
+	numThreads = std::min(numThreads, count);
+	std::vector<std::thread> threads;
+	for (unsigned int t = 1; t < numThreads; t++) {
+		threads.emplace_back(worker);
+	}
+	worker(); // this thread does its share too
+	for (auto& t : threads) t.join();
+
+	std::vector<ProbeResult> results;
+	for (unsigned int i = 0; i < count; i++) {
+		// Pass on exceptions just as if the probes had run one at a time
+		if (errors[i]) std::rethrow_exception(errors[i]);
+
+		if (certs[i] == ArchiveType::Certainty::DefinitelyNo) continue;
+		results.push_back({candidates[i], certs[i]});
+		if (certs[i] == ArchiveType::Certainty::DefinitelyYes) break;
+	}
+	return results;
+}
+
+std::vector<ProbeResult> probeFormatsParallel(stream::input& content,
+	unsigned int numThreads)
+{
+	stream::len lenArchive = content.size();
+	if (lenArchive > PROBE_BUFFER_MAX) {
+		// Too big to load into memory, just probe one at a time instead
+		return probeFormats(content);
+	}
+
+	if (numThreads == 0) {
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	std::vector<ArchiveManager::handler_t> withSig, withoutSig;
+	selectCandidates(content, &withSig, &withoutSig);
+
+	// Load the whole file once so every probe can share it
+	auto data = std::make_shared<std::string>(
+		readHeader(content, lenArchive));
+
+	auto results = probeParallel(withSig, data, numThreads);
+	if (!results.empty()) return results;
+
+	return probeParallel(withoutSig, data, numThreads);
+}
+
+} // namespace gamearchive
+} // namespace camoto
@@ -0,0 +1,276 @@
+/**
+ * @file  name_recovery.cpp
+ * @brief Guess filenames for formats that only store a hash of each name.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <camoto/gamearchive/name_recovery.hpp>
+#include "fmt-lbr-vinyl.hpp"
+
+/// Number of bits in the quick check done on each hash before looking it up
+/// in the full list of targets.
+#define RECOVERY_FILTER_BITS 16
+
+/// Score of a single word with no number and the most likely extension.
+#define SCORE_BASE           1000
+
+/// Score lost by the least common word (scaled down for more common ones.)
+#define SCORE_WORD_RANK      100
+
+/// Score lost for using two words instead of one.
+#define SCORE_PAIR           200
+
+/// Score lost for each digit added to the end of the name.
+#define SCORE_DIGIT          30
+
+/// Score lost by the least common extension.
+#define SCORE_EXT_RANK       100
+
+/// Score lost by names that wouldn't fit in DOS 8.3 format.
+#define SCORE_NOT_DOS        300
+
+namespace camoto {
+namespace gamearchive {
+
+NameHash::~NameHash()
+{
+}
+
+uint32_t NameHash::finish(uint32_t state) const
+{
+	return state;
+}
+
+uint32_t NameHash::hash(const std::string& name) const
+{
+	return this->finish(this->update(this->initial(), name.data(),
+		name.length()));
+}
+
+bool NameHash::placeholder(const std::string& name, uint32_t *hash) const
+{
+	if (name.empty() || (name.length() > 8)) return false;
+	uint32_t value = 0;
+	for (auto c : name) {
+		value <<= 4;
+		if ((c >= '0') && (c <= '9')) value |= c - '0';
+		else if ((c >= 'a') && (c <= 'f')) value |= c - 'a' + 10;
+		else return false;
+	}
+	*hash = value;
+	return true;
+}
+
+std::shared_ptr<const NameHash> nameHashFor(const std::string& archTypeCode)
+{
+	if (archTypeCode.compare("lbr-vinyl") == 0) {
+		return std::make_shared<NameHash_LBR_Vinyl>();
+	}
+	return nullptr;
+}
+
+std::set<uint32_t> unknownHashes(const Archive& archive,
+	const NameHash& nameHash)
+{
+	std::set<uint32_t> hashes;
+	for (const auto& i : archive.files()) {
+		uint32_t hash;
+		if (nameHash.placeholder(i->strName, &hash)) hashes.insert(hash);
+	}
+	return hashes;
+}
+
+NameRecoveryOptions::NameRecoveryOptions()
+	:	pairs(false),
+		maxDigits(0),
+		dosNames(true),
+		numThreads(0),
+		maxResults(10)
+{
+}
+
+/// Is a better candidate than b?
+static bool betterName(const RecoveredName& a, const RecoveredName& b)
+{
+	if (a.score != b.score) return a.score > b.score;
+	if (a.name.length() != b.name.length()) {
+		return a.name.length() < b.name.length();
+	}
+	return a.name < b.name;
+}
+
+/// Sort candidates best first and drop all but the best ones.
+static void trimNames(std::vector<RecoveredName> *names, unsigned int max)
+{
+	std::sort(names->begin(), names->end(), betterName);
+	if (names->size() > max) names->resize(max);
+	return;
+}
+
+/// Piece of a candidate name.
+struct NamePart {
+	std::string text; ///< Characters in this part
+	int score;        ///< Score lost by using this part
+};
+
+std::map<uint32_t, std::vector<RecoveredName>> recoverNames(
+	const NameHash& nameHash, const std::set<uint32_t>& targets,
+	const NameRecoveryOptions& options, unsigned long long *numTried)
+{
+	std::map<uint32_t, std::vector<RecoveredName>> results;
+	if (targets.empty() || options.words.empty()) {
+		if (numTried) *numTried = 0;
+		return results;
+	}
+
+	// Most candidates won't match, so check a bitmap first to avoid searching
+	// the target list each time.
+	std::vector<bool> filter(1 << RECOVERY_FILTER_BITS, false);
+	for (auto t : targets) {
+		filter[(t ^ (t >> RECOVERY_FILTER_BITS)) & ((1 << RECOVERY_FILTER_BITS) - 1)]
+			= true;
+	}
+
+	unsigned int numWords = options.words.size();
+
+	// Second words, including none at all
+	std::vector<NamePart> seconds;
+	seconds.push_back({std::string(), 0});
+	if (options.pairs) {
+		for (unsigned int i = 0; i < numWords; i++) {
+			seconds.push_back({options.words[i],
+				SCORE_PAIR + (int)(i * SCORE_WORD_RANK / numWords)});
+		}
+	}
+
+	// Numbers, including none at all
+	std::vector<NamePart> numbers;
+	numbers.push_back({std::string(), 0});
+	unsigned int limit = 1;
+	for (unsigned int d = 1; d <= options.maxDigits; d++) {
+		limit *= 10;
+		for (unsigned int n = 0; n < limit; n++) {
+			std::string num = std::to_string(n);
+			num.insert(0, d - num.length(), '0');
+			numbers.push_back({num, (int)(d * SCORE_DIGIT)});
+		}
+	}
+
+	// Extensions, with the dot added
+	std::vector<NamePart> exts;
+	unsigned int numExts = std::max<unsigned int>(1, options.extensions.size());
+	for (unsigned int i = 0; i < options.extensions.size(); i++) {
+		const auto& e = options.extensions[i];
+		if (options.dosNames && (e.length() > 3)) continue;
+		exts.push_back({e.empty() ? e : '.' + e,
+			(int)(i * SCORE_EXT_RANK / numExts)});
+	}
+	if (options.extensions.empty()) exts.push_back({std::string(), 0});
+
+	unsigned int numThreads = options.numThreads;
+	if (numThreads == 0) {
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	numThreads = std::min(numThreads, numWords);
+
+	std::atomic<unsigned int> nextWord(0);
+	std::atomic<unsigned long long> tried(0);
+	std::vector<std::map<uint32_t, std::vector<RecoveredName>>> found(numThreads);
+	std::vector<std::exception_ptr> errors(numThreads);
+
+	auto worker = [&](unsigned int t) {
+		auto& mine = found[t];
+		unsigned long long count = 0;
+		try {
+			for (;;) {
+				unsigned int w = nextWord++;
+				if (w >= numWords) break;
+				const auto& first = options.words[w];
+				int scoreFirst = SCORE_BASE - (int)(w * SCORE_WORD_RANK / numWords);
+				uint32_t hashFirst = nameHash.update(nameHash.initial(), first.data(),
+					first.length());
+
+				for (const auto& second : seconds) {
+					uint32_t hashSecond = nameHash.update(hashFirst, second.text.data(),
+						second.text.length());
+					for (const auto& number : numbers) {
+						unsigned int lenBase = first.length() + second.text.length()
+							+ number.text.length();
+						if (options.dosNames && (lenBase > 8)) continue;
+						uint32_t hashNumber = nameHash.update(hashSecond,
+							number.text.data(), number.text.length());
+
+						for (const auto& ext : exts) {
+							uint32_t hash = nameHash.finish(nameHash.update(hashNumber,
+								ext.text.data(), ext.text.length()));
+							count++;
+							if (!filter[
+								(hash ^ (hash >> RECOVERY_FILTER_BITS))
+									& ((1 << RECOVERY_FILTER_BITS) - 1)
+							]) continue;
+							if (targets.find(hash) == targets.end()) continue;
+
+							RecoveredName n;
+							n.name = first + second.text + number.text + ext.text;
+							n.score = scoreFirst - second.score - number.score - ext.score;
+							if ((lenBase > 8) || (ext.text.length() > 4)) {
+								n.score -= SCORE_NOT_DOS;
+							}
+							auto& names = mine[hash];
+							names.push_back(std::move(n));
+							if (names.size() >= options.maxResults * 2 + 16) {
+								trimNames(&names, options.maxResults);
+							}
+						}
+					}
+				}
+			}
+		} catch (...) {
+			errors[t] = std::current_exception();
+		}
+		tried += count;
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int t = 1; t < numThreads; t++) {
+		threads.emplace_back(worker, t);
+	}
+	worker(0); // this thread does its share too
+	for (auto& t : threads) t.join();
+
+	for (auto& e : errors) {
+		if (e) std::rethrow_exception(e);
+	}
+
+	// Combine the results from each thread
+	for (auto& mine : found) {
+		for (auto& i : mine) {
+			auto& names = results[i.first];
+			names.insert(names.end(), i.second.begin(), i.second.end());
+		}
+	}
+	for (auto& i : results) trimNames(&i.second, options.maxResults);
+
+	if (numTried) *numTried = tried;
+	return results;
+}
+
+} // namespace gamearchive
+} // namespace camoto
@@ -0,0 +1,97 @@
+/**
+ * @file  path_index.cpp
+ * @brief Look up files by full path without reopening each folder.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cassert>
+#include <camoto/util.hpp>
+#include <camoto/gamearchive/path_index.hpp>
+
+namespace camoto {
+namespace gamearchive {
+
+PathIndex::PathIndex(std::shared_ptr<Archive> root)
+{
+	this->folders.push_back(root);
+	this->add(root, std::string());
+}
+
+bool PathIndex::find(const std::string& path,
+	std::shared_ptr<Archive> *pArchive, Archive::FileHandle *pFile) const
+{
+	auto it = this->paths.find(normalise(path));
+	if (it == this->paths.end()) {
+		*pFile = nullptr;
+		return false;
+	}
+	*pArchive = this->folders[it->second.folder];
+	*pFile = it->second.id;
+	return true;
+}
+
+unsigned long PathIndex::size() const
+{
+	return this->paths.size();
+}
+
+void PathIndex::rebuild()
+{
+	auto root = this->folders[0];
+	this->folders.clear();
+	this->paths.clear();
+	this->folders.push_back(root);
+	this->add(root, std::string());
+	return;
+}
+
+void PathIndex::add(std::shared_ptr<Archive> archive,
+	const std::string& prefix)
+{
+	unsigned int folder = this->folders.size() - 1;
+	assert(this->folders[folder] == archive);
+
+	// Add every entry in this archive before going into any subfolders, so
+	// that a file named like a path takes precedence over one in a subfolder.
+	// emplace() won't replace any existing entries.
+	for (const auto& i : archive->files()) {
+		Location loc;
+		loc.folder = folder;
+		loc.id = i;
+		this->paths.emplace(prefix + normalise(i->strName), loc);
+	}
+
+	for (const auto& i : archive->files()) {
+		if (!(i->fAttr & Archive::File::Attribute::Folder)) continue;
+		auto sub = archive->openFolder(i);
+		if (!sub) continue;
+		this->folders.push_back(sub);
+		this->add(sub, prefix + normalise(i->strName) + '/');
+	}
+	return;
+}
+
+std::string PathIndex::normalise(const std::string& path)
+{
+	std::string key = path;
+	for (auto& c : key) if (c == '\\') c = '/';
+	camoto::uppercase(key);
+	return key;
+}
+
+} // namespace gamearchive
+} // namespace camoto
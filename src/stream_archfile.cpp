@@ -18,6 +18,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <camoto/util.hpp>
 #include <camoto/gamearchive/manager.hpp>
@@ -39,9 +40,16 @@ std::unique_ptr<stream::inout> applyFilter(std::unique_ptr<archfile> s,
 		));
 	}
 
+	// Filters that track the size themselves (e.g. inout_chunked) notify with
+	// no stream, so remember which archfile they are sitting on.
+	archfile* file = s.get();
 	return pFilterType->apply(
 		std::unique_ptr<stream::inout>(std::move(s)),
-		[](stream::output_filtered* filt, stream::len newRealSize) {
+		[file](stream::output_filtered* filt, stream::len newRealSize) {
+			if (!filt) {
+				file->setRealSize(newRealSize);
+				return;
+			}
 			archfile* arch = nullptr;
 			while (filt) {
 				auto filt_content = filt->get_stream().get();
@@ -121,13 +129,57 @@ output_archfile::output_archfile(std::shared_ptr<Archive> archive,
 	:	sub_core(0, 0), // length values are unused as we will be overriding them
 		output_sub(content, 0, 0, stream::fn_truncate_sub()),
 		archfile_core(id),
-		archive(archive)
+		archive(archive),
+		lenSpare(0)
+{
+}
+
+output_archfile::~output_archfile()
+{
+	if (this->lenSpare == 0) return;
+	try {
+		if (this->archive->isValid(this->id)) this->truncate(this->sub_size());
+	} catch (const stream::error&) {
+		// Nothing we can do, the file will just have some zeroes on the end
+	}
+}
+
+stream::len output_archfile::try_write(const uint8_t *buffer, stream::len len)
 {
+	this->id->generation++;
+
+	stream::len lenNeeded = this->tellp() + len;
+	stream::len lenData = this->sub_size();
+	if (lenNeeded > lenData) {
+		if (lenNeeded <= lenData + this->lenSpare) {
+			// Already have room
+			this->lenSpare -= lenNeeded - lenData;
+		} else {
+			// Double the space each time, so streaming a large file in is only a
+			// handful of resizes instead of one per write.
+			stream::len lenStored = lenData + this->lenSpare;
+			stream::len lenReserve = std::max(lenNeeded, lenStored * 2);
+			stream::len newRealSize;
+			if (this->id->fAttr & Archive::File::Attribute::Compressed) {
+				newRealSize = this->id->realSize;
+			} else {
+				newRealSize = lenReserve;
+			}
+			try {
+				this->archive->resize(this->id, lenReserve, newRealSize);
+				this->lenSpare = lenReserve - lenNeeded;
+			} catch (const stream::error&) {
+				// Format can't hold that much extra, so leave it to output_sub to
+				// enlarge the file by exactly the amount needed, if it can.
+			}
+		}
+	}
+	return this->output_sub::try_write(buffer, len);
 }
 
 void output_archfile::truncate(stream::len size)
 {
-	if (this->sub_size() == size) return; // nothing to do
+	if ((this->sub_size() == size) && (this->lenSpare == 0)) return; // nothing to do
 	assert(this->id);
 
 	stream::len newRealSize;
@@ -147,7 +199,14 @@ void output_archfile::truncate(stream::len size)
 	// the same.  When filters are in use, the flush() function that writes
 	// the filtered data out should call us first, then call the archive's
 	// resize() function with the correct real/extracted size.
-	this->archive->resize(this->id, size, newRealSize);
+	stream::len oldSpare = this->lenSpare;
+	this->lenSpare = 0;
+	try {
+		this->archive->resize(this->id, size, newRealSize);
+	} catch (const stream::error&) {
+		this->lenSpare = oldSpare;
+		throw;
+	}
 
 	// After a truncate the file pointer is always left at the new EOF
 	try {
@@ -161,12 +220,24 @@ void output_archfile::truncate(stream::len size)
 
 void output_archfile::setRealSize(stream::len newRealSize)
 {
-	this->archive->resize(this->id, this->id->storedSize, newRealSize);
+	// Drop any spare space at the same time
+	stream::len lenData = this->sub_size();
+	this->lenSpare = 0;
+	this->archive->resize(this->id, lenData, newRealSize);
 	return;
 }
 
+stream::len output_archfile::sub_size() const
+{
+	return this->archfile_core::sub_size() - this->lenSpare;
+}
+
 void output_archfile::flush()
 {
+	// Give back any space reserved by try_write(), so the archive is only
+	// resized to the final size once.
+	if (this->lenSpare) this->truncate(this->sub_size());
+
 	// Don't flush the parent stream here because it's shared with the archive,
 	// and we'll end up double-flushing which is bad if the archive is based on
 	// a filtered stream.
@@ -0,0 +1,269 @@
+/**
+ * @file  stream_checkpoint.cpp
+ * @brief Decompressing stream that can seek without decoding from the start.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <camoto/gamearchive/manager.hpp>
+#include <camoto/gamearchive/stream_checkpoint.hpp>
+
+/// Amount of filtered data to read from the parent stream at a time.
+#define CHECKPOINT_READ_SIZE 4096
+
+namespace camoto {
+namespace gamearchive {
+
+std::unique_ptr<stream::input> FilterType::applySeekable(
+	std::unique_ptr<stream::input> target) const
+{
+	return this->apply(std::move(target));
+}
+
+/// Get the length of the data a filter will be decoding.
+static stream::len filteredSize(const stream::input& parent)
+{
+	// If the data is itself being decoded lazily, finding its length would mean
+	// decoding all of it up front.  Decoders read until they run out of data
+	// rather than relying on the length, so don't bother.
+	auto lazy = dynamic_cast<const input_checkpointed *>(&parent);
+	if (lazy && !lazy->decodedSizeKnown()) return 0;
+	return parent.size();
+}
+
+input_checkpointed::input_checkpointed(std::unique_ptr<stream::input> parent,
+	std::shared_ptr<filter> filt)
+	:	input_checkpointed(std::move(parent), filt, fn_clone())
+{
+}
+
+input_checkpointed::input_checkpointed(std::unique_ptr<stream::input> parent,
+	std::shared_ptr<filter> filt, fn_clone clone, stream::len interval)
+	:	parent(std::move(parent)),
+		filt(filt),
+		clone(clone),
+		interval(interval),
+		bufIn(CHECKPOINT_READ_SIZE),
+		lenBufIn(0),
+		posBufIn(0),
+		posBufStart(0),
+		bufOut(CHECKPOINT_READ_SIZE),
+		lenBufOut(0),
+		posDecoded(0),
+		offset(0),
+		sizeKnown(false),
+		lenDecoded(0)
+{
+	this->filt->reset(filteredSize(*this->parent));
+	this->parent->seekg(0, stream::start);
+
+	// The first checkpoint is the start of the data, so there is always one to
+	// go back to.
+	Checkpoint start;
+	start.posOut = 0;
+	start.posIn = 0;
+	if (this->clone) start.state = this->clone(*this->filt);
+	this->checkpoints.push_back(start);
+}
+
+input_checkpointed::~input_checkpointed()
+{
+}
+
+stream::len input_checkpointed::try_read(uint8_t *buffer, stream::len len)
+{
+	if (this->sizeKnown && (this->offset >= this->lenDecoded)) return 0;
+
+	this->rewind(this->offset);
+
+	// Keep decoding until the read position is inside the block of decoded
+	// data, then copy out as much as is wanted.  Any blocks before the read
+	// position are discarded, which is never more than the checkpoint interval.
+	stream::len total = 0;
+	while (total < len) {
+		stream::pos pos = this->offset + total;
+		if (pos < this->posDecoded) {
+			stream::pos posBlock = pos - (this->posDecoded - this->lenBufOut);
+			stream::len amt = std::min<stream::len>(this->lenBufOut - posBlock,
+				len - total);
+			memcpy(buffer + total, this->bufOut.data() + posBlock, amt);
+			total += amt;
+			continue;
+		}
+		if (!this->decode()) break;
+	}
+	this->offset += total;
+	return total;
+}
+
+void input_checkpointed::seekg(stream::delta off, stream::seek_from from)
+{
+	stream::delta base;
+	switch (from) {
+		case stream::start: base = 0; break;
+		case stream::cur: base = this->offset; break;
+		case stream::end: base = this->size(); break;
+		default: base = 0; break;
+	}
+	stream::delta target = base + off;
+	// Only check the end if it's known, so seeking doesn't force the whole
+	// stream to be decoded.  Reads past the end will return no data.
+	if (
+		(target < 0)
+		|| (this->sizeKnown && ((stream::len)target > this->lenDecoded))
+	) {
+		throw stream::seek_error("Cannot seek beyond the end of the data.");
+	}
+	this->offset = target;
+	return;
+}
+
+stream::pos input_checkpointed::tellg() const
+{
+	return this->offset;
+}
+
+bool input_checkpointed::decodedSizeKnown() const
+{
+	return this->sizeKnown;
+}
+
+stream::len input_checkpointed::size() const
+{
+	if (!this->sizeKnown) {
+		// Decoding changes the filter state but not anything visible through
+		// the stream interface, so this is still logically const.
+		auto self = const_cast<input_checkpointed *>(this);
+		self->rewind(std::max(this->posDecoded,
+			this->checkpoints.back().posOut));
+		while (self->decode());
+	}
+	return this->lenDecoded;
+}
+
+void input_checkpointed::rewind(stream::pos target)
+{
+	// Find the last checkpoint at or before the target.  The first one is at
+	// offset 0 so there is always one.
+	auto cp = std::upper_bound(this->checkpoints.begin(),
+		this->checkpoints.end(), target,
+		[](stream::pos t, const Checkpoint& c) {
+			return t < c.posOut;
+		}
+	);
+	cp--;
+
+	// Keep going from where we are if that's closer, or if the target has
+	// already been decoded and is still in the buffer.
+	if (
+		(this->posDecoded - this->lenBufOut <= target)
+		&& (this->posDecoded >= cp->posOut)
+	) {
+		return;
+	}
+
+	if (cp->state) {
+		// Restore a copy, so the checkpoint itself can be used again later
+		this->filt = this->clone(*cp->state);
+	} else {
+		this->filt->reset(filteredSize(*this->parent));
+	}
+	this->parent->seekg(cp->posIn, stream::start);
+	this->posBufStart = cp->posIn;
+	this->lenBufIn = 0;
+	this->posBufIn = 0;
+	this->lenBufOut = 0;
+	this->posDecoded = cp->posOut;
+	return;
+}
+
+bool input_checkpointed::decode()
+{
+	if (this->sizeKnown && (this->posDecoded >= this->lenDecoded)) return false;
+
+	for (;;) {
+		if (this->posBufIn == this->lenBufIn) this->fill();
+
+		stream::len lenIn = this->lenBufIn - this->posBufIn;
+		stream::len lenOut = this->bufOut.size();
+		this->filt->transform(this->bufOut.data(), &lenOut,
+			this->bufIn.data() + this->posBufIn, &lenIn);
+		this->posBufIn += lenIn;
+
+		if (lenOut) {
+			this->lenBufOut = lenOut;
+			this->posDecoded += lenOut;
+			if (
+				this->clone
+				&& this->posDecoded
+					>= this->checkpoints.back().posOut + this->interval
+			) {
+				Checkpoint next;
+				next.posOut = this->posDecoded;
+				next.posIn = this->posBufStart + this->posBufIn;
+				next.state = this->clone(*this->filt);
+				this->checkpoints.push_back(next);
+			}
+			return true;
+		}
+		if (lenIn) continue;
+
+		// The filter couldn't do anything with what it was given, so it either
+		// needs more data or it has reached the end.
+		if (!this->fill()) break;
+	}
+
+	this->sizeKnown = true;
+	this->lenDecoded = this->posDecoded;
+	return false;
+}
+
+bool input_checkpointed::fill()
+{
+	if (this->posBufIn > 0) {
+		this->lenBufIn -= this->posBufIn;
+		memmove(this->bufIn.data(), this->bufIn.data() + this->posBufIn,
+			this->lenBufIn);
+		this->posBufStart += this->posBufIn;
+		this->posBufIn = 0;
+	}
+	if (this->lenBufIn == this->bufIn.size()) return false;
+
+	stream::len r = this->parent->try_read(this->bufIn.data() + this->lenBufIn,
+		this->bufIn.size() - this->lenBufIn);
+	this->lenBufIn += r;
+	return r > 0;
+}
+
+std::unique_ptr<stream::input> openSeekable(std::shared_ptr<Archive> archive,
+	const Archive::FileHandle& id)
+{
+	std::unique_ptr<stream::input> raw = archive->open(id, false);
+	if (id->filter.empty()) return raw;
+
+	auto pFilterType = FilterManager::byCode(id->filter);
+	if (!pFilterType) {
+		throw stream::error(createString(
+			"could not find filter \"" << id->filter << "\""
+		));
+	}
+	return pFilterType->applySeekable(std::move(raw));
+}
+
+} // namespace gamearchive
+} // namespace camoto
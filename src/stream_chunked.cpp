@@ -0,0 +1,325 @@
+/**
+ * @file  stream_chunked.cpp
+ * @brief Read/write stream for data compressed in independent chunks, which
+ *        only re-encodes the chunks that have changed.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <camoto/filter.hpp>
+#include <camoto/gamearchive/stream_chunked.hpp>
+
+/// Amount of zeroes to write at a time when a stream is enlarged.
+#define CHUNKED_PAD_SIZE 4096
+
+namespace camoto {
+namespace gamearchive {
+
+ChunkCodec::~ChunkCodec()
+{
+}
+
+inout_chunked::inout_chunked(std::unique_ptr<stream::inout> parent,
+	std::shared_ptr<const ChunkCodec> codec,
+	stream::fn_notify_prefiltered_size resize)
+	:	parent(std::move(parent)),
+		codec(codec),
+		resize(resize),
+		lenChunk(codec->chunkSize()),
+		lenHeader(0),
+		lenEncoded(this->parent->size()),
+		lenFlushed(0),
+		offset(0),
+		cachedIndex(-1)
+{
+	if (this->lenEncoded) {
+		this->parent->seekg(0, stream::start);
+		this->lenFlushed = this->codec->index(*this->parent, &this->chunks);
+		this->lenHeader = this->codec->header(0).length();
+		if (
+			this->chunks.size()
+				!= (this->lenFlushed + this->lenChunk - 1) / this->lenChunk
+		) {
+			throw filter_error("Number of chunks does not match the decompressed "
+				"size.");
+		}
+	}
+	// Chunks from the original data that can still be used
+	this->numValid = this->chunks.size();
+	this->lenDecoded = this->lenFlushed;
+}
+
+inout_chunked::~inout_chunked()
+{
+}
+
+stream::len inout_chunked::try_read(uint8_t *buffer, stream::len len)
+{
+	if (this->offset >= this->lenDecoded) return 0;
+	len = std::min(len, this->lenDecoded - this->offset);
+
+	stream::len total = 0;
+	while (total < len) {
+		unsigned int index = this->offset / this->lenChunk;
+		stream::pos posChunk = this->offset % this->lenChunk;
+		const std::string& chunk = this->getChunk(index);
+		stream::len amt = std::min<stream::len>(chunk.length() - posChunk,
+			len - total);
+		memcpy(buffer + total, chunk.data() + posChunk, amt);
+		total += amt;
+		this->offset += amt;
+	}
+	return total;
+}
+
+void inout_chunked::seekg(stream::delta off, stream::seek_from from)
+{
+	stream::delta base;
+	switch (from) {
+		case stream::start: base = 0; break;
+		case stream::cur: base = this->offset; break;
+		case stream::end: base = this->lenDecoded; break;
+		default: base = 0; break;
+	}
+	stream::delta target = base + off;
+	if ((target < 0) || ((stream::len)target > this->lenDecoded)) {
+		throw stream::seek_error("Cannot seek beyond the end of the data.");
+	}
+	this->offset = target;
+	return;
+}
+
+stream::pos inout_chunked::tellg() const
+{
+	return this->offset;
+}
+
+stream::len inout_chunked::size() const
+{
+	return this->lenDecoded;
+}
+
+stream::len inout_chunked::try_write(const uint8_t *buffer, stream::len len)
+{
+	stream::len total = 0;
+	while (total < len) {
+		unsigned int index = this->offset / this->lenChunk;
+		stream::pos posChunk = this->offset % this->lenChunk;
+		std::string& chunk = this->editChunk(index);
+		stream::len amt = std::min<stream::len>(this->lenChunk - posChunk,
+			len - total);
+		if (chunk.length() < posChunk + amt) chunk.resize(posChunk + amt);
+		memcpy(&chunk[posChunk], buffer + total, amt);
+		total += amt;
+		this->offset += amt;
+	}
+	if (this->offset > this->lenDecoded) this->lenDecoded = this->offset;
+	return total;
+}
+
+void inout_chunked::seekp(stream::delta off, stream::seek_from from)
+{
+	this->seekg(off, from);
+	return;
+}
+
+stream::pos inout_chunked::tellp() const
+{
+	return this->offset;
+}
+
+void inout_chunked::truncate(stream::len size)
+{
+	if (size < this->lenDecoded) {
+		unsigned int numChunks = (size + this->lenChunk - 1) / this->lenChunk;
+		stream::len lenLast = size % this->lenChunk;
+		if (lenLast) this->editChunk(numChunks - 1).resize(lenLast);
+		this->dirty.erase(this->dirty.lower_bound(numChunks), this->dirty.end());
+
+		// Any remaining original chunks are all complete
+		this->numValid = std::min<unsigned int>(this->numValid,
+			size / this->lenChunk);
+		if (this->cachedIndex >= (int)this->numValid) this->cachedIndex = -1;
+		this->lenDecoded = size;
+		if (this->offset > size) this->offset = size;
+
+	} else if (size > this->lenDecoded) {
+		// Fill the new space with zeroes
+		stream::pos orig = this->offset;
+		this->offset = this->lenDecoded;
+		uint8_t pad[CHUNKED_PAD_SIZE];
+		memset(pad, 0, sizeof(pad));
+		while (this->offset < size) {
+			this->try_write(pad,
+				std::min<stream::len>(size - this->offset, sizeof(pad)));
+		}
+		this->offset = orig;
+	}
+	return;
+}
+
+void inout_chunked::flush()
+{
+	bool sizeChanged = this->lenDecoded != this->lenFlushed;
+	if (this->dirty.empty() && !sizeChanged && this->lenHeader) {
+		this->parent->flush();
+		return;
+	}
+
+	unsigned int numChunks = (this->lenDecoded + this->lenChunk - 1)
+		/ this->lenChunk;
+
+	// Work out which of the original chunks need replacing.  This runs from
+	// the first changed chunk to the last one, or to the end of the data if
+	// chunks have been added or removed.
+	unsigned int first = this->numValid;
+	if (!this->dirty.empty()) {
+		first = std::min(first, this->dirty.begin()->first);
+	}
+	unsigned int endOld, endNew;
+	if (
+		(this->numValid < this->chunks.size())
+		|| (numChunks != this->chunks.size())
+	) {
+		endOld = this->chunks.size();
+		endNew = numChunks;
+	} else if (!this->dirty.empty()) {
+		endOld = endNew = this->dirty.rbegin()->first + 1;
+	} else {
+		// Nothing has changed, but this is a new file so it needs a header
+		endOld = endNew = first;
+	}
+
+	stream::pos posStart;
+	if (first < this->chunks.size()) {
+		posStart = this->chunks[first].offset;
+	} else if (!this->chunks.empty()) {
+		posStart = this->chunks.back().offset + this->chunks.back().length;
+	} else {
+		posStart = this->lenHeader;
+	}
+	stream::pos posEnd = posStart;
+	if (endOld > first) {
+		posEnd = this->chunks[endOld - 1].offset + this->chunks[endOld - 1].length;
+	}
+
+	// Encode the changed chunks, and copy any unchanged ones in between as
+	// they are.
+	std::string newData;
+	if (this->lenHeader == 0) {
+		// New file, so the header has to be written first
+		newData = this->codec->header(this->lenDecoded);
+	}
+	std::vector<ChunkCodec::Chunk> newChunks(this->chunks.begin(),
+		this->chunks.begin() + first);
+	for (unsigned int i = first; i < endNew; i++) {
+		std::string encoded;
+		auto d = this->dirty.find(i);
+		if (d != this->dirty.end()) {
+			encoded = this->codec->encode(d->second);
+		} else {
+			this->parent->seekg(this->chunks[i].offset, stream::start);
+			encoded = this->parent->read(this->chunks[i].length);
+		}
+		ChunkCodec::Chunk c;
+		c.offset = posStart + newData.length();
+		c.length = encoded.length();
+		newChunks.push_back(c);
+		newData.append(encoded);
+	}
+
+	// Splice the new data in place of the old, moving everything after it.
+	stream::delta delta = (stream::delta)(posStart + newData.length())
+		- (stream::delta)posEnd;
+	stream::len lenTail = this->lenEncoded - posEnd;
+	if (delta > 0) {
+		this->parent->truncate(this->lenEncoded + delta);
+		if (lenTail) stream::move(*this->parent, posEnd, posEnd + delta, lenTail);
+	}
+	this->parent->seekp(posStart, stream::start);
+	this->parent->write(newData);
+	if (delta < 0) {
+		if (lenTail) stream::move(*this->parent, posEnd, posEnd + delta, lenTail);
+		this->parent->truncate(this->lenEncoded + delta);
+	}
+	for (unsigned int i = endOld; i < this->chunks.size(); i++) {
+		ChunkCodec::Chunk c = this->chunks[i];
+		c.offset += delta;
+		newChunks.push_back(c);
+	}
+	this->lenEncoded += delta;
+
+	if (this->lenHeader == 0) {
+		this->lenHeader = this->codec->header(0).length();
+	} else if (sizeChanged) {
+		this->parent->seekp(0, stream::start);
+		this->parent->write(this->codec->header(this->lenDecoded));
+	}
+
+	this->chunks = newChunks;
+	this->numValid = this->chunks.size();
+	this->dirty.clear();
+	this->cachedIndex = -1;
+	this->lenFlushed = this->lenDecoded;
+
+	if (sizeChanged && this->resize) this->resize(nullptr, this->lenDecoded);
+	this->parent->flush();
+	return;
+}
+
+const std::string& inout_chunked::getChunk(unsigned int index)
+{
+	auto d = this->dirty.find(index);
+	if (d != this->dirty.end()) return d->second;
+	if ((int)index == this->cachedIndex) return this->cachedChunk;
+
+	// Anything not in the dirty list must be one of the original chunks
+	if (index >= this->numValid) {
+		throw stream::read_error("Attempted to read a chunk that doesn't exist.");
+	}
+	const auto& c = this->chunks[index];
+	this->parent->seekg(c.offset, stream::start);
+	std::string encoded = this->parent->read(c.length);
+	this->cachedChunk = this->codec->decode(encoded,
+		this->chunkLength(index, this->lenFlushed));
+	this->cachedIndex = index;
+	return this->cachedChunk;
+}
+
+std::string& inout_chunked::editChunk(unsigned int index)
+{
+	auto d = this->dirty.find(index);
+	if (d != this->dirty.end()) return d->second;
+
+	std::string data;
+	if (index < this->numValid) data = this->getChunk(index);
+	if ((int)index == this->cachedIndex) this->cachedIndex = -1;
+	std::string& chunk = this->dirty[index];
+	chunk.swap(data);
+	return chunk;
+}
+
+stream::len inout_chunked::chunkLength(unsigned int index, stream::len size)
+	const
+{
+	return std::min<stream::len>(this->lenChunk,
+		size - (stream::len)index * this->lenChunk);
+}
+
+} // namespace gamearchive
+} // namespace camoto
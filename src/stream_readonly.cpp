@@ -0,0 +1,142 @@
+/**
+ * @file  stream_readonly.cpp
+ * @brief Provide a read/write stream interface on top of a read-only stream.
+ *
+ * Copyright (C) 2010-2016 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <camoto/gamearchive/stream_readonly.hpp>
+
+namespace camoto {
+namespace gamearchive {
+
+inout_readonly::inout_readonly(std::unique_ptr<stream::input> parent)
+	:	parent(std::move(parent))
+{
+}
+
+inout_readonly::~inout_readonly()
+{
+}
+
+stream::len inout_readonly::try_read(uint8_t *buffer, stream::len len)
+{
+	return this->parent->try_read(buffer, len);
+}
+
+void inout_readonly::seekg(stream::delta off, stream::seek_from from)
+{
+	this->parent->seekg(off, from);
+	return;
+}
+
+stream::pos inout_readonly::tellg() const
+{
+	return this->parent->tellg();
+}
+
+stream::len inout_readonly::size() const
+{
+	return this->parent->size();
+}
+
+stream::len inout_readonly::try_write(const uint8_t *buffer, stream::len len)
+{
+	throw stream::write_error("The archive was opened read-only.");
+}
+
+void inout_readonly::seekp(stream::delta off, stream::seek_from from)
+{
+	this->parent->seekg(off, from);
+	return;
+}
+
+stream::pos inout_readonly::tellp() const
+{
+	return this->parent->tellg();
+}
+
+void inout_readonly::truncate(stream::len size)
+{
+	throw stream::write_error("The archive was opened read-only.");
+}
+
+void inout_readonly::flush()
+{
+	// Nothing can have been written
+	return;
+}
+
+
+input_shared_buffer::input_shared_buffer(
+	std::shared_ptr<const std::string> data, stream::pos start,
+	stream::len len)
+	:	data(data),
+		start(start),
+		len(len),
+		offset(0)
+{
+}
+
+input_shared_buffer::input_shared_buffer(
+	std::shared_ptr<const std::string> data)
+	:	data(data),
+		start(0),
+		len(data->length()),
+		offset(0)
+{
+}
+
+stream::len input_shared_buffer::try_read(uint8_t *buffer, stream::len len)
+{
+	if (this->offset >= this->len) return 0;
+	len = std::min<stream::len>(len, this->len - this->offset);
+	memcpy(buffer, this->data->data() + this->start + this->offset, len);
+	this->offset += len;
+	return len;
+}
+
+void input_shared_buffer::seekg(stream::delta off, stream::seek_from from)
+{
+	stream::delta base;
+	switch (from) {
+		case stream::start: base = 0; break;
+		case stream::cur: base = this->offset; break;
+		case stream::end: base = this->len; break;
+		default: base = 0; break;
+	}
+	stream::delta target = base + off;
+	if ((target < 0) || ((stream::len)target > this->len)) {
+		throw stream::seek_error("Cannot seek beyond the end of the data.");
+	}
+	this->offset = target;
+	return;
+}
+
+stream::pos input_shared_buffer::tellg() const
+{
+	return this->offset;
+}
+
+stream::len input_shared_buffer::size() const
+{
+	return this->len;
+}
+
+} // namespace gamearchive
+} // namespace camoto
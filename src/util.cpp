@@ -18,8 +18,28 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#endif
+#ifdef USE_LIBURING
+#include <liburing.h>
+
+/// Maximum number of files being copied at once by extractMany().
+#define EXTRACT_RING_DEPTH     64
+
+/// Files larger than this are copied by extractTo() instead.
+#define EXTRACT_RING_MAX_FILE  (256 * 1024)
+#endif
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <camoto/util.hpp>
 #include <camoto/gamearchive/util.hpp>
+#include <camoto/gamearchive/manager.hpp>
 #include <camoto/gamearchive/archive-fat.hpp>
 #include <camoto/gamearchive/fixedarchive.hpp>
 
@@ -100,11 +120,519 @@ void findFile(std::shared_ptr<Archive> *pArchive,
 	return;
 }
 
+void findFile(const PathIndex& index, std::shared_ptr<Archive> *pArchive,
+	Archive::FileHandle *pFile, const std::string& filename)
+{
+	// Index numbers are only looked up in the root archive, which doesn't need
+	// any folders opened.
+	if (filename[0] == '@') {
+		findFile(pArchive, pFile, filename);
+		return;
+	}
+	index.find(filename, pArchive, pFile);
+	return;
+}
+
 void preventResize(stream::output_sub* sub, stream::len len)
 {
 	throw stream::write_error("This file is a fixed size, it cannot be made "
 		"smaller or larger.");
 }
 
+/// Work out where a file's data starts within the archive file.
+/**
+ * @return false if the location can't be determined from the FileHandle.
+ */
+static bool dataOffset(const Archive::FileHandle& id, stream::pos *offset)
+{
+	auto fat = dynamic_cast<const Archive_FAT::FATEntry *>(&*id);
+	auto fixed = dynamic_cast<const FixedArchive::FixedEntry *>(&*id);
+	if (fat) {
+		*offset = fat->iOffset + fat->lenHeader;
+	} else if (fixed) {
+		*offset = fixed->fixed->offset;
+	} else {
+		// Don't know where the data is
+		return false;
+	}
+	return true;
+}
+
+bool extractTo(const Archive::FileHandle& id, int fdArchive, int fdOut)
+{
+	stream::pos offset;
+	if (!dataOffset(id, &offset)) return false;
+
+#ifdef __linux__
+	stream::len remaining = id->storedSize;
+	loff_t offIn = offset;
+
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 27))
+	// Try copy_file_range() first, as it can share extents on filesystems that
+	// support it, so the data never needs to be copied at all.
+	while (remaining > 0) {
+		ssize_t lenCopied = copy_file_range(fdArchive, &offIn, fdOut, nullptr,
+			remaining, 0);
+		if (lenCopied < 0) {
+			if (errno == EINTR) continue;
+			// Not supported between these files (e.g. different filesystems on an
+			// older kernel) so fall back to sendfile()
+			if (
+				(errno == EXDEV)
+				|| (errno == EINVAL)
+				|| (errno == ENOSYS)
+				|| (errno == EOPNOTSUPP)
+			) break;
+			throw stream::write_error(createString("Unable to copy file data: "
+				<< strerror(errno)));
+		}
+		if (lenCopied == 0) {
+			throw stream::incomplete_read(id->storedSize - remaining);
+		}
+		remaining -= lenCopied;
+	}
+#endif
+
+	off_t offSend = offIn;
+	while (remaining > 0) {
+		ssize_t lenCopied = sendfile(fdOut, fdArchive, &offSend, remaining);
+		if (lenCopied < 0) {
+			if (errno == EINTR) continue;
+			// If nothing has been copied yet, let the caller copy it instead
+			if (
+				(remaining == id->storedSize)
+				&& ((errno == EINVAL) || (errno == ENOSYS))
+			) return false;
+			throw stream::write_error(createString("Unable to copy file data: "
+				<< strerror(errno)));
+		}
+		if (lenCopied == 0) {
+			throw stream::incomplete_read(id->storedSize - remaining);
+		}
+		remaining -= lenCopied;
+	}
+	return true;
+#else
+	// No zero-copy APIs on this platform
+	return false;
+#endif
+}
+
+#ifdef USE_LIBURING
+/// A file being copied by extractRing().
+struct RingSlot
+{
+	/// File being copied
+	const ExtractTarget *target;
+
+	/// File data, on its way from the archive to the output file
+	std::vector<uint8_t> buffer;
+
+	/// Offset of the file's data in the archive
+	stream::pos offIn;
+
+	/// Offset in the output file where the data is to be written
+	off_t offOut;
+
+	/// Number of bytes read (or written, if writing is true) so far
+	stream::len progress;
+
+	/// false while reading from the archive, true while writing out
+	bool writing;
+
+	/// true while a request for this slot is in the ring
+	bool busy;
+};
+
+/// user_data for cancel requests, which is never a slot number
+#define EXTRACT_RING_CANCEL UINTPTR_MAX
+
+/// Copy files using io_uring, submitting many reads and writes at once.
+/**
+ * @param files
+ *   Files to copy, along with the offset of each file's data.  None of the
+ *   files may be empty.
+ *
+ * @return false if io_uring is not available, in which case nothing has been
+ *   copied.
+ */
+static bool extractRing(
+	const std::vector<std::pair<const ExtractTarget *, stream::pos> >& files,
+	int fdArchive)
+{
+	unsigned int depth = std::min<std::size_t>(EXTRACT_RING_DEPTH, files.size());
+	if (depth == 0) return true;
+
+	// Declared before the ring so it is released after it, as any requests
+	// still in progress refer to these buffers.  This alone is not enough,
+	// because closing the ring does not wait for the kernel to finish with them,
+	// so on error every request is cancelled and waited for before returning.
+	std::vector<RingSlot> slots(depth);
+
+	struct io_uring ring;
+	if (io_uring_queue_init(depth, &ring, 0) < 0) {
+		// Kernel too old, or io_uring has been disabled
+		return false;
+	}
+	std::unique_ptr<struct io_uring, void(*)(struct io_uring *)>
+		ringGuard(&ring, io_uring_queue_exit);
+
+	// Queue the next read or write for a slot.  There is never more than one
+	// request per slot, so there is always room for it in the ring.
+	auto queue = [&](unsigned int s) {
+		auto& slot = slots[s];
+		struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+		if (slot.writing) {
+			io_uring_prep_write(sqe, slot.target->fdOut,
+				slot.buffer.data() + slot.progress,
+				slot.buffer.size() - slot.progress, slot.offOut + slot.progress);
+		} else {
+			io_uring_prep_read(sqe, fdArchive,
+				slot.buffer.data() + slot.progress,
+				slot.buffer.size() - slot.progress, slot.offIn + slot.progress);
+		}
+		io_uring_sqe_set_data(sqe, (void *)(uintptr_t)s);
+		slot.busy = true;
+		return;
+	};
+
+	// Cancel every request still in progress and wait until the kernel has
+	// finished with all of them, so the buffers can be released.
+	auto drain = [&]() {
+		// Send anything not yet submitted, so the ring has room for the cancels
+		io_uring_submit(&ring);
+		for (unsigned int s = 0; s < depth; s++) {
+			if (!slots[s].busy) continue;
+			struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+			io_uring_prep_cancel(sqe, (void *)(uintptr_t)s, 0);
+			io_uring_sqe_set_data(sqe, (void *)(uintptr_t)EXTRACT_RING_CANCEL);
+		}
+		io_uring_submit(&ring);
+
+		unsigned int busy = 0;
+		for (const auto& i : slots) if (i.busy) busy++;
+		while (busy > 0) {
+			struct io_uring_cqe *cqe;
+			int ret = io_uring_wait_cqe(&ring, &cqe);
+			if (ret == -EINTR) continue;
+			if (ret < 0) {
+				// Can't tell when the kernel will be done with the buffers, so
+				// leave them allocated rather than risk it writing into freed memory
+				new std::vector<RingSlot>(std::move(slots));
+				return;
+			}
+			uintptr_t s = (uintptr_t)io_uring_cqe_get_data(cqe);
+			io_uring_cqe_seen(&ring, cqe);
+			if ((s != EXTRACT_RING_CANCEL) && slots[s].busy) {
+				slots[s].busy = false;
+				busy--;
+			}
+		}
+		return;
+	};
+
+	// Put the next file into a slot, returning false if there are none left.
+	std::size_t next = 0;
+	auto start = [&](unsigned int s) {
+		if (next >= files.size()) return false;
+		auto& slot = slots[s];
+		slot.target = files[next].first;
+		slot.offIn = files[next].second;
+		next++;
+		slot.buffer.resize(slot.target->id->storedSize);
+		slot.offOut = lseek(slot.target->fdOut, 0, SEEK_CUR);
+		if (slot.offOut < 0) {
+			throw stream::write_error(createString("Unable to get output file "
+				"position: " << strerror(errno)));
+		}
+		slot.progress = 0;
+		slot.writing = false;
+		queue(s);
+		return true;
+	};
+
+	for (auto& i : slots) i.busy = false;
+
+	try {
+		unsigned int active = 0;
+		for (unsigned int s = 0; s < depth; s++) {
+			if (start(s)) active++;
+		}
+
+		while (active > 0) {
+			// Send everything queued since last time in one go
+			io_uring_submit(&ring);
+
+			struct io_uring_cqe *cqe;
+			int ret = io_uring_wait_cqe(&ring, &cqe);
+			if (ret < 0) {
+				if (ret == -EINTR) continue;
+				throw stream::read_error(createString("Unable to wait for file "
+					"data: " << strerror(-ret)));
+			}
+
+			// Deal with every request that has finished, queueing the next step for
+			// each of them to be submitted together.
+			do {
+				unsigned int s = (uintptr_t)io_uring_cqe_get_data(cqe);
+				int res = cqe->res;
+				io_uring_cqe_seen(&ring, cqe);
+				auto& slot = slots[s];
+				slot.busy = false;
+
+				if (res < 0) {
+					if ((res == -EINTR) || (res == -EAGAIN)) {
+						queue(s);
+						continue;
+					}
+					if (slot.writing) {
+						throw stream::write_error(createString("Unable to write file "
+							"data: " << strerror(-res)));
+					}
+					throw stream::read_error(createString("Unable to read file data: "
+						<< strerror(-res)));
+				}
+				if (res == 0) {
+					if (slot.writing) {
+						throw stream::write_error("Unable to write file data: no space");
+					}
+					throw stream::incomplete_read(slot.progress);
+				}
+				slot.progress += res;
+				if (slot.progress < slot.buffer.size()) {
+					// Short read or write, do the rest
+					queue(s);
+					continue;
+				}
+				if (!slot.writing) {
+					slot.writing = true;
+					slot.progress = 0;
+					queue(s);
+					continue;
+				}
+
+				// Leave the file position after the data, as extractTo() does
+				lseek(slot.target->fdOut, slot.offOut + slot.buffer.size(), SEEK_SET);
+				if (!start(s)) active--;
+			} while (io_uring_peek_cqe(&ring, &cqe) == 0);
+		}
+	} catch (...) {
+		drain();
+		throw;
+	}
+	return true;
+}
+#endif // USE_LIBURING
+
+std::vector<ExtractTarget> extractMany(const std::vector<ExtractTarget>& files,
+	int fdArchive)
+{
+	std::vector<ExtractTarget> skipped;
+#ifdef USE_LIBURING
+	std::vector<std::pair<const ExtractTarget *, stream::pos> > batch;
+#endif
+	for (const auto& i : files) {
+		stream::pos offset;
+		if (!dataOffset(i.id, &offset)) {
+			skipped.push_back(i);
+			continue;
+		}
+#ifdef USE_LIBURING
+		if (
+			(i.id->storedSize > 0)
+			&& (i.id->storedSize <= EXTRACT_RING_MAX_FILE)
+		) {
+			batch.push_back(std::make_pair(&i, offset));
+			continue;
+		}
+#endif
+		// Large files are better off with copy_file_range()
+		if (!extractTo(i.id, fdArchive, i.fdOut)) skipped.push_back(i);
+	}
+
+#ifdef USE_LIBURING
+	// Read the archive from start to end
+	std::sort(batch.begin(), batch.end(),
+		[](const std::pair<const ExtractTarget *, stream::pos>& a,
+			const std::pair<const ExtractTarget *, stream::pos>& b) {
+			return a.second < b.second;
+		}
+	);
+	if (!extractRing(batch, fdArchive)) {
+		for (const auto& i : batch) {
+			if (!extractTo(i.first->id, fdArchive, i.first->fdOut)) {
+				skipped.push_back(*i.first);
+			}
+		}
+	}
+#endif
+	return skipped;
+}
+
+/// Fixed-size ring buffer passing decoded data from one thread to another.
+/**
+ * The producer writes straight into the free space and the consumer reads
+ * straight out of the filled space, so the data is never copied within the
+ * buffer.  When the buffer is full the producer waits for the consumer to
+ * catch up, and vice versa.
+ */
+class ExtractRing
+{
+	public:
+		ExtractRing(stream::len lenBuffer)
+			:	data(lenBuffer),
+				posRead(0),
+				lenFilled(0),
+				closed(false),
+				failed(false)
+		{
+		}
+
+		/// Wait for some free space to write into.
+		/**
+		 * @param ptr
+		 *   On return, where to write the data.
+		 *
+		 * @return Number of bytes that can be written at ptr, or 0 if the
+		 *   consumer has failed and no more data is wanted.
+		 */
+		stream::len waitSpace(uint8_t **ptr)
+		{
+			std::unique_lock<std::mutex> l(this->lock);
+			this->cvSpace.wait(l, [this]() {
+				return this->failed || (this->lenFilled < this->data.size());
+			});
+			if (this->failed) return 0;
+			stream::pos posWrite = (this->posRead + this->lenFilled)
+				% this->data.size();
+			*ptr = this->data.data() + posWrite;
+			// Only up to the end of the buffer, the rest comes next time
+			return std::min<stream::len>(this->data.size() - this->lenFilled,
+				this->data.size() - posWrite);
+		}
+
+		/// Pass on data written to the space returned by waitSpace().
+		void commit(stream::len len)
+		{
+			std::lock_guard<std::mutex> l(this->lock);
+			this->lenFilled += len;
+			this->cvData.notify_one();
+			return;
+		}
+
+		/// Wait for some data to read.
+		/**
+		 * @param ptr
+		 *   On return, where to read the data from.
+		 *
+		 * @return Number of bytes available at ptr, or 0 if the producer has
+		 *   finished and all the data has been read.
+		 */
+		stream::len waitData(const uint8_t **ptr)
+		{
+			std::unique_lock<std::mutex> l(this->lock);
+			this->cvData.wait(l, [this]() {
+				return this->closed || (this->lenFilled > 0);
+			});
+			*ptr = this->data.data() + this->posRead;
+			return std::min<stream::len>(this->lenFilled,
+				this->data.size() - this->posRead);
+		}
+
+		/// Free up data that has been read from waitData().
+		void release(stream::len len)
+		{
+			std::lock_guard<std::mutex> l(this->lock);
+			this->posRead = (this->posRead + len) % this->data.size();
+			this->lenFilled -= len;
+			this->cvSpace.notify_one();
+			return;
+		}
+
+		/// Producer has no more data.
+		void close()
+		{
+			std::lock_guard<std::mutex> l(this->lock);
+			this->closed = true;
+			this->cvData.notify_one();
+			return;
+		}
+
+		/// Consumer has given up, so the producer should stop.
+		void fail()
+		{
+			std::lock_guard<std::mutex> l(this->lock);
+			this->failed = true;
+			this->cvSpace.notify_one();
+			return;
+		}
+
+	protected:
+		std::vector<uint8_t> data;  ///< Buffer
+		stream::pos posRead;        ///< Offset of first filled byte in data
+		stream::len lenFilled;      ///< Number of filled bytes in data
+		bool closed;                ///< Producer has finished
+		bool failed;                ///< Consumer has stopped
+		std::mutex lock;            ///< Protects everything above except data
+		std::condition_variable cvData;  ///< Notified when data is added
+		std::condition_variable cvSpace; ///< Notified when data is removed
+};
+
+void extractStreaming(Archive& archive, const Archive::FileHandle& id,
+	stream::output& out, stream::len lenBuffer)
+{
+	std::unique_ptr<stream::input> content = archive.open(id, false);
+	if (!id->filter.empty()) {
+		auto pFilterType = FilterManager::byCode(id->filter);
+		if (!pFilterType) {
+			throw stream::error(createString(
+				"could not find filter \"" << id->filter << "\""
+			));
+		}
+		// Input filters decode as the data is read, so this doesn't buffer
+		// the whole file like Archive::open() does.
+		content = pFilterType->apply(std::move(content));
+	}
+
+	ExtractRing ring(std::max<stream::len>(lenBuffer, 1));
+	std::exception_ptr errorOut;
+
+	// Write out the data in another thread, so the next block can be decoded
+	// while the previous one is being written.
+	std::thread writer([&]() {
+		try {
+			const uint8_t *ptr;
+			stream::len len;
+			while ((len = ring.waitData(&ptr)) > 0) {
+				out.write(ptr, len);
+				ring.release(len);
+			}
+			out.flush();
+		} catch (...) {
+			errorOut = std::current_exception();
+			ring.fail();
+		}
+	});
+
+	try {
+		uint8_t *ptr;
+		stream::len len;
+		while ((len = ring.waitSpace(&ptr)) > 0) {
+			stream::len lenRead = content->try_read(ptr, len);
+			if (lenRead == 0) break;
+			ring.commit(lenRead);
+		}
+	} catch (...) {
+		ring.close();
+		writer.join();
+		throw;
+	}
+	ring.close();
+	writer.join();
+
+	if (errorOut) std::rethrow_exception(errorOut);
+	return;
+}
+
 } // namespace gamearchive
 } // namespace camoto
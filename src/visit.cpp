@@ -0,0 +1,260 @@
+/**
+ * @file  visit.cpp
+ * @brief Read many files from an archive in on-disk order.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <camoto/stream_string.hpp>
+#include <camoto/util.hpp>
+#include <camoto/gamearchive/archive-fat.hpp>
+#include <camoto/gamearchive/fixedarchive.hpp>
+#include <camoto/gamearchive/manager.hpp>
+#include <camoto/gamearchive/stream_readonly.hpp>
+#include <camoto/gamearchive/visit.hpp>
+
+/// Largest gap between two files that will be read over to join the reads.
+#define VISIT_COALESCE_GAP  4096
+
+/// Largest amount of data to load in a single read.
+#define VISIT_COALESCE_MAX  (1024 * 1024)
+
+/// Files larger than this are streamed from the archive instead of loaded.
+#define VISIT_BUFFER_MAX    (16 * 1024 * 1024)
+
+/// Number of loaded files waiting to be visited, per thread.
+#define VISIT_QUEUE_DEPTH   4
+
+namespace camoto {
+namespace gamearchive {
+
+/// A file whose data has been loaded, waiting to be visited.
+struct VisitJob
+{
+	Archive::FileHandle id;
+	std::shared_ptr<const std::string> data;
+	stream::pos start;
+	stream::len len;
+};
+
+/// A file to visit, along with where its data is stored.
+struct VisitItem
+{
+	Archive::FileHandle id;
+
+	/// Offset of the file's data within the archive, if known.
+	stream::pos offset;
+
+	/// Can the data be loaded with Archive_FAT::readRaw()?
+	bool raw;
+
+	/// Is offset valid?
+	bool located;
+};
+
+void visitFiles(std::shared_ptr<Archive> archive,
+	const Archive::FileVector& files, bool useFilter, fn_visit fnVisit,
+	unsigned int numThreads)
+{
+	if (numThreads == 0) {
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// Work out where each file is stored
+	auto archFAT = std::dynamic_pointer_cast<Archive_FAT>(archive);
+	std::vector<VisitItem> items;
+	for (const auto& id : files) {
+		if (id->fAttr & Archive::File::Attribute::Folder) continue;
+		if (!archive->isValid(id)) continue;
+
+		VisitItem item;
+		item.id = id;
+		item.offset = 0;
+		item.raw = false;
+		item.located = false;
+		auto fat = Archive_FAT::FATEntry::cast(id);
+		auto fixed = FixedArchive::FixedEntry::cast(id);
+		if (fat) {
+			item.offset = fat->iOffset + fat->lenHeader;
+			item.raw = archFAT && (id->storedSize <= VISIT_BUFFER_MAX);
+			item.located = true;
+		} else if (fixed) {
+			item.offset = fixed->fixed->offset;
+			item.located = true;
+		}
+		items.push_back(item);
+	}
+
+	// Sort by offset, leaving any files whose location is unknown at the end in
+	// their original order.
+	std::stable_sort(items.begin(), items.end(),
+		[](const VisitItem& a, const VisitItem& b) {
+			if (a.located != b.located) return a.located;
+			return a.located && (a.offset < b.offset);
+		}
+	);
+
+	// Run the filter (if any) and pass the data to the caller
+	auto runJob = [&](const VisitJob& job) {
+		std::unique_ptr<stream::input> content =
+			std::make_unique<input_shared_buffer>(job.data, job.start, job.len);
+		if (useFilter && !job.id->filter.empty()) {
+			auto pFilterType = FilterManager::byCode(job.id->filter);
+			if (!pFilterType) {
+				throw stream::error(createString(
+					"could not find filter \"" << job.id->filter << "\""
+				));
+			}
+			content = pFilterType->apply(std::move(content));
+		}
+		fnVisit(job.id, *content);
+		return;
+	};
+
+	std::mutex lock;
+	std::condition_variable cvWork, cvSpace;
+	std::deque<VisitJob> queue;
+	bool finished = false;
+	std::exception_ptr error;
+
+	auto worker = [&]() {
+		for (;;) {
+			VisitJob job;
+			{
+				std::unique_lock<std::mutex> l(lock);
+				cvWork.wait(l, [&]() { return finished || !queue.empty(); });
+				if (queue.empty()) break;
+				job = std::move(queue.front());
+				queue.pop_front();
+			}
+			cvSpace.notify_one();
+			try {
+				runJob(job);
+			} catch (...) {
+				std::lock_guard<std::mutex> l(lock);
+				if (!error) error = std::current_exception();
+				queue.clear();
+				finished = true;
+				cvWork.notify_all();
+				cvSpace.notify_all();
+				break;
+			}
+		}
+		return;
+	};
+
+	// Hand a loaded file over to be visited, waiting if too many are queued.
+	// Returns false if a worker has failed, so nothing more should be read.
+	auto dispatch = [&](VisitJob job) {
+		if (numThreads <= 1) {
+			runJob(job);
+			return true;
+		}
+		std::unique_lock<std::mutex> l(lock);
+		cvSpace.wait(l, [&]() {
+			return finished || (queue.size() < numThreads * VISIT_QUEUE_DEPTH);
+		});
+		if (finished) return false;
+		queue.push_back(std::move(job));
+		cvWork.notify_one();
+		return true;
+	};
+
+	std::vector<std::thread> threads;
+	if (numThreads > 1) {
+		for (unsigned int t = 0; t < numThreads; t++) {
+			threads.emplace_back(worker);
+		}
+	}
+
+	try {
+		auto itEnd = items.end();
+		for (auto it = items.begin(); it != itEnd; ) {
+			if (it->raw) {
+				// Extend the read over any following files that are close enough
+				stream::pos offStart = it->offset;
+				stream::pos offEnd = offStart + it->id->storedSize;
+				auto itNext = std::next(it);
+				while (
+					(itNext != itEnd)
+					&& itNext->raw
+					&& (itNext->offset <= offEnd + VISIT_COALESCE_GAP)
+				) {
+					stream::pos offNextEnd = std::max<stream::pos>(offEnd,
+						itNext->offset + itNext->id->storedSize);
+					if (offNextEnd - offStart > VISIT_COALESCE_MAX) break;
+					offEnd = offNextEnd;
+					itNext++;
+				}
+
+				auto data = std::make_shared<std::string>(offEnd - offStart, '\0');
+				if (offEnd > offStart) {
+					archFAT->readRaw(offStart, (uint8_t *)&(*data)[0],
+						offEnd - offStart);
+				}
+				bool keepGoing = true;
+				for (; it != itNext; it++) {
+					if (!keepGoing) continue;
+					keepGoing = dispatch(
+						{it->id, data, it->offset - offStart, it->id->storedSize});
+				}
+				if (!keepGoing) break;
+
+			} else if (it->id->storedSize <= VISIT_BUFFER_MAX) {
+				// Not stored in a way we can read directly, so go through the archive
+				auto raw = archive->open(it->id, false);
+				stream::string buffer;
+				stream::copy(buffer, *raw);
+				auto dataStr = std::make_shared<std::string>(std::move(buffer.data));
+				if (!dispatch({it->id, dataStr, 0, dataStr->length()})) break;
+				it++;
+
+			} else {
+				// Too large to load, so visit it straight from the archive.  This has
+				// to be done from this thread as it reads from the archive stream.
+				{
+					std::lock_guard<std::mutex> l(lock);
+					if (finished) break;
+				}
+				auto content = archive->open(it->id, useFilter);
+				fnVisit(it->id, *content);
+				it++;
+			}
+		}
+	} catch (...) {
+		std::lock_guard<std::mutex> l(lock);
+		if (!error) error = std::current_exception();
+		queue.clear();
+	}
+
+	{
+		std::lock_guard<std::mutex> l(lock);
+		finished = true;
+	}
+	cvWork.notify_all();
+	for (auto& t : threads) t.join();
+
+	if (error) std::rethrow_exception(error);
+	return;
+}
+
+} // namespace gamearchive
+} // namespace camoto
@@ -0,0 +1,97 @@
+/**
+ * @file   bench-archive-cache.cpp
+ * @brief  Benchmark for opening the same archive many times.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <camoto/stream_file.hpp>
+#include <camoto/stream_string.hpp>
+#include <camoto/util.hpp>
+#include <camoto/gamearchive/archive_cache.hpp>
+#include <camoto/gamearchive/manager.hpp>
+#include "bench.hpp"
+
+using namespace camoto;
+using namespace camoto::gamearchive;
+
+/// Number of times the archive is opened for each measurement.
+#define BENCH_OPENS  100
+
+BENCHMARK(archivecache, "open the same archive repeatedly, with and without "
+	"ArchiveCache")
+{
+	std::string filename = opt.dir + "/bench-archive-cache.wad";
+
+	auto pArchType = ArchiveManager::byCode("wad-doom");
+	if (!pArchType) throw stream::error("WAD handler not available");
+
+	// An archive with a large FAT, as parsing that is what the cache saves
+	{
+		stream::string lump("data");
+		std::vector<ArchiveType::FileData> lumps;
+		for (unsigned int i = 0; i < opt.count; i++) {
+			lumps.push_back({
+				createString("L" << i),
+				FILETYPE_GENERIC,
+				Archive::File::Attribute::Default,
+				&lump
+			});
+		}
+		stream::output_file out(filename, true);
+		SuppData suppData;
+		pArchType->write(out, lumps, suppData);
+		out.flush();
+	}
+	std::string last = createString("L" << (opt.count - 1));
+
+	// Each open is followed by a lookup, as a request handler would do
+	BenchTimer t;
+	for (unsigned int i = 0; i < BENCH_OPENS; i++) {
+		SuppData suppData;
+		auto arch = pArchType->openReadOnly(
+			std::make_unique<stream::input_file>(filename), suppData);
+		if (!arch->find(last)) throw stream::error("Lump not found");
+	}
+	double perOpen = t.elapsed() / BENCH_OPENS;
+	benchResult("openReadOnly(), per open", perOpen);
+
+	ArchiveCache cache(1);
+	t.restart();
+	{
+		auto arch = cache.open(filename, pArchType);
+		if (!arch->find(last)) throw stream::error("Lump not found");
+	}
+	benchResult("ArchiveCache, first open", t.elapsed());
+
+	t.restart();
+	for (unsigned int i = 0; i < BENCH_OPENS; i++) {
+		auto arch = cache.open(filename, pArchType);
+		if (!arch->find(last)) throw stream::error("Lump not found");
+	}
+	double perCached = t.elapsed() / BENCH_OPENS;
+	benchResult("ArchiveCache, per repeated open", perCached);
+	if (perCached > 0) {
+		std::cout << "  repeated opens are " << (unsigned long)(perOpen / perCached)
+			<< " times faster" << std::endl;
+	}
+
+	cache.clear();
+	std::remove(filename.c_str());
+	return;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file   bench-extract-many.cpp
+ * @brief  Benchmark for extracting many small files from an archive.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <camoto/stream_file.hpp>
+#include <camoto/stream_string.hpp>
+#include <camoto/util.hpp>
+#include <camoto/gamearchive/manager.hpp>
+#include <camoto/gamearchive/util.hpp>
+#include "bench.hpp"
+
+using namespace camoto;
+using namespace camoto::gamearchive;
+
+/// Size of each lump in the test archive.
+#define BENCH_LUMP_SIZE   4096
+
+/// Number of output files open at once, to stay under the descriptor limit.
+#define BENCH_OPEN_FILES  256
+
+/// Way of getting the files out of the archive.
+enum class ExtractMethod {
+	Stream,   ///< Archive::open(), then read() and write() for each file
+	Single,   ///< extractTo() for each file
+	Many,     ///< extractMany() for each group of open files
+};
+
+/// Remove the archive's data from the page cache, if the platform allows it.
+/**
+ * @return false if the cache could not be dropped.
+ */
+static bool dropCache(const std::string& filename)
+{
+#ifdef POSIX_FADV_DONTNEED
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	// Only clean pages are dropped, so make sure it's all on disk first
+	fdatasync(fd);
+	bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	::close(fd);
+	return ok;
+#else
+	return false;
+#endif
+}
+
+/// Extract every file in the archive into outDir.
+static void extractAll(std::shared_ptr<Archive> arch, int fdArchive,
+	const std::string& outDir, ExtractMethod method)
+{
+	const auto& files = arch->files();
+	for (std::size_t g = 0; g < files.size(); g += BENCH_OPEN_FILES) {
+		std::size_t end = std::min<std::size_t>(g + BENCH_OPEN_FILES,
+			files.size());
+
+		std::vector<ExtractTarget> targets;
+		for (std::size_t i = g; i < end; i++) {
+			std::string filename = createString(outDir << "/" << i);
+			int fdOut = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+				0644);
+			if (fdOut < 0) {
+				for (const auto& t : targets) ::close(t.fdOut);
+				throw stream::open_error("Unable to create " + filename);
+			}
+			targets.push_back({files[i], fdOut});
+		}
+
+		std::vector<ExtractTarget> skipped;
+		switch (method) {
+			case ExtractMethod::Stream:
+				skipped = targets;
+				break;
+			case ExtractMethod::Single:
+				for (const auto& t : targets) {
+					if (!extractTo(t.id, fdArchive, t.fdOut)) skipped.push_back(t);
+				}
+				break;
+			case ExtractMethod::Many:
+				skipped = extractMany(targets, fdArchive);
+				break;
+		}
+
+		// Anything that couldn't be copied directly goes through the streams,
+		// as gamearch does it
+		for (const auto& t : skipped) {
+			auto in = arch->open(t.id, false);
+			std::vector<uint8_t> buf(t.id->storedSize);
+			in->read(buf.data(), buf.size());
+			if (::write(t.fdOut, buf.data(), buf.size()) != (ssize_t)buf.size()) {
+				for (const auto& u : targets) ::close(u.fdOut);
+				throw stream::write_error("Unable to write extracted file");
+			}
+		}
+
+		for (const auto& t : targets) ::close(t.fdOut);
+	}
+	return;
+}
+
+BENCHMARK(extractmany, "extract many small files, with a cold and warm cache")
+{
+	std::string filename = opt.dir + "/bench-extract-many.wad";
+	std::string outDir = opt.dir + "/bench-extract-many.out";
+
+	auto pArchType = ArchiveManager::byCode("wad-doom");
+	if (!pArchType) throw stream::error("WAD handler not available");
+
+	// Create an archive of small lumps, as a WAD for a large game would be
+	{
+		std::string data(BENCH_LUMP_SIZE, '\0');
+		for (unsigned int i = 0; i < data.length(); i++) data[i] = i * 7;
+		stream::string lump(data);
+
+		std::vector<ArchiveType::FileData> lumps;
+		for (unsigned int i = 0; i < opt.count; i++) {
+			lumps.push_back({
+				createString("L" << i),
+				FILETYPE_GENERIC,
+				Archive::File::Attribute::Default,
+				&lump
+			});
+		}
+		stream::output_file out(filename, true);
+		SuppData suppData;
+		pArchType->write(out, lumps, suppData);
+		out.flush();
+	}
+	mkdir(outDir.c_str(), 0755);
+
+	stream::len lenTotal = (stream::len)opt.count * BENCH_LUMP_SIZE;
+	SuppData suppData;
+	auto arch = pArchType->open(std::make_unique<stream::file>(filename, false),
+		suppData);
+	int fdArchive = ::open(filename.c_str(), O_RDONLY);
+	if (fdArchive < 0) throw stream::open_error("Unable to open " + filename);
+
+	static const struct {
+		ExtractMethod method;
+		const char *name;
+	} methods[] = {
+		{ExtractMethod::Stream, "Archive::open()"},
+		{ExtractMethod::Single, "extractTo()"},
+		{ExtractMethod::Many,   "extractMany()"},
+	};
+
+	try {
+		for (const auto& m : methods) {
+			// If the cache can't be dropped this run may be partly cached too
+			bool bCold = dropCache(filename);
+			BenchTimer t;
+			extractAll(arch, fdArchive, outDir, m.method);
+			benchResult(createString(m.name
+				<< (bCold ? ", cold cache" : ", first run")), t.elapsed(),
+				lenTotal);
+
+			t.restart();
+			extractAll(arch, fdArchive, outDir, m.method);
+			benchResult(createString(m.name << ", warm cache"), t.elapsed(),
+				lenTotal);
+		}
+	} catch (...) {
+		::close(fdArchive);
+		throw;
+	}
+	::close(fdArchive);
+
+	for (unsigned int i = 0; i < opt.count; i++) {
+		std::remove(createString(outDir << "/" << i).c_str());
+	}
+	rmdir(outDir.c_str());
+	arch = nullptr;
+	std::remove(filename.c_str());
+	return;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file   bench-shift.cpp
+ * @brief  Benchmark for inserting and removing data in a large file.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <camoto/stream_file.hpp>
+#include <camoto/stream_seg.hpp>
+#include "bench.hpp"
+
+using namespace camoto;
+
+BENCHMARK(shift, "insert and remove one block in the middle of a large file")
+{
+	std::string filename = opt.dir + "/bench-shift.tmp";
+	benchCreateFile(filename, opt.lenLarge);
+
+	stream::len lenBlock = 4096;
+	stream::pos offMiddle = opt.lenLarge / 2;
+
+	// The same change Archive_FAT makes when a file is inserted or removed
+	{
+		stream::seg content(std::make_unique<stream::file>(filename, false));
+		BenchTimer t;
+		content.seekp(offMiddle, stream::start);
+		content.insert(lenBlock);
+		content.flush();
+		benchResult("stream::seg insert", t.elapsed(), opt.lenLarge - offMiddle);
+
+		t.restart();
+		content.seekp(offMiddle, stream::start);
+		content.remove(lenBlock);
+		content.flush();
+		benchResult("stream::seg remove", t.elapsed(), opt.lenLarge - offMiddle);
+	}
+
+	std::remove(filename.c_str());
+	return;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file   bench.cpp
+ * @brief  Benchmark code core.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <camoto/stream_file.hpp>
+#include "bench.hpp"
+
+using namespace camoto;
+
+/// Size of each write when creating test files.
+#define BENCH_WRITE_SIZE  (1024 * 1024)
+
+/// A benchmark in the list.
+struct BenchEntry
+{
+	const char *name;
+	const char *desc;
+	benchmark_fn fn;
+};
+
+/// Get the list of benchmarks.
+/**
+ * This is a function rather than a global so the list exists before the
+ * first BenchRegistration is constructed.
+ */
+static std::vector<BenchEntry>& benchmarks()
+{
+	static std::vector<BenchEntry> list;
+	return list;
+}
+
+BenchRegistration::BenchRegistration(const char *name, const char *desc,
+	benchmark_fn fn)
+{
+	benchmarks().push_back({name, desc, fn});
+}
+
+BenchTimer::BenchTimer()
+	:	start(std::chrono::steady_clock::now())
+{
+}
+
+void BenchTimer::restart()
+{
+	this->start = std::chrono::steady_clock::now();
+	return;
+}
+
+double BenchTimer::elapsed() const
+{
+	std::chrono::duration<double> d = std::chrono::steady_clock::now()
+		- this->start;
+	return d.count();
+}
+
+void benchResult(const std::string& what, double seconds, stream::len bytes)
+{
+	std::cout << "  " << std::left << std::setw(40) << what << std::right
+		<< std::fixed << std::setprecision(4) << std::setw(10) << seconds << " s";
+	if (bytes && (seconds > 0)) {
+		std::cout << std::setprecision(1) << std::setw(10)
+			<< bytes / seconds / (1024 * 1024) << " MB/s";
+	}
+	std::cout << std::endl;
+	return;
+}
+
+void benchCreateFile(const std::string& filename, stream::len len)
+{
+	std::string block(BENCH_WRITE_SIZE, '\0');
+	for (unsigned int i = 0; i < block.length(); i++) block[i] = i * 7;
+
+	stream::output_file out(filename, true);
+	while (len) {
+		stream::len lenNext = std::min<stream::len>(len, block.length());
+		out.write((const uint8_t *)block.data(), lenNext);
+		len -= lenNext;
+	}
+	out.flush();
+	return;
+}
+
+int main(int iArgC, char *cArgV[])
+{
+	BenchOptions opt;
+	opt.dir = ".";
+	opt.lenLarge = 1024 * 1024 * 1024;
+	opt.count = 20000;
+
+	std::vector<std::string> names;
+	for (int i = 1; i < iArgC; i++) {
+		std::string arg = cArgV[i];
+		if ((arg.compare("-d") == 0) && (i + 1 < iArgC)) {
+			opt.dir = cArgV[++i];
+		} else if ((arg.compare("-s") == 0) && (i + 1 < iArgC)) {
+			opt.lenLarge = strtoull(cArgV[++i], NULL, 0) * 1024 * 1024;
+		} else if ((arg.compare("-n") == 0) && (i + 1 < iArgC)) {
+			opt.count = strtoul(cArgV[++i], NULL, 0);
+		} else if (arg[0] == '-') {
+			std::cout << "Usage: bench [-d folder] [-s size_mb] [-n count] "
+				"[benchmark...]\n\n"
+				"  -d  create temporary files in this folder (default .)\n"
+				"  -s  size of large files, in MB (default 1024)\n"
+				"  -n  number of files for tests with many files (default 20000)\n"
+				"\nBenchmarks (default is to run them all):\n";
+			for (const auto& b : benchmarks()) {
+				std::cout << "  " << std::left << std::setw(16) << b.name << b.desc
+					<< "\n";
+			}
+			return (arg.compare("-h") == 0) ? 0 : 1;
+		} else {
+			names.push_back(arg);
+		}
+	}
+
+	int ret = 0;
+	for (const auto& b : benchmarks()) {
+		if (!names.empty()) {
+			bool bWanted = false;
+			for (const auto& n : names) if (n.compare(b.name) == 0) bWanted = true;
+			if (!bWanted) continue;
+		}
+		std::cout << b.name << ": " << b.desc << std::endl;
+		try {
+			b.fn(opt);
+		} catch (const stream::error& e) {
+			std::cout << "  failed: " << e.what() << std::endl;
+			ret = 1;
+		}
+	}
+	return ret;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file   bench.hpp
+ * @brief  Benchmark code core.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAMOTO_GAMEARCHIVE_BENCH_HPP_
+#define _CAMOTO_GAMEARCHIVE_BENCH_HPP_
+
+#include <chrono>
+#include <string>
+#include <camoto/stream.hpp>
+
+/// Settings shared by all the benchmarks, from the command line.
+struct BenchOptions
+{
+	/// Folder to create temporary files in.  This should be on a real disk
+	/// rather than tmpfs, as some benchmarks depend on the filesystem.
+	std::string dir;
+
+	/// Size of the data used by benchmarks working on one large file.
+	camoto::stream::len lenLarge;
+
+	/// Number of items used by benchmarks working on many small files.
+	unsigned int count;
+};
+
+/// Function that runs a single benchmark.
+typedef void (*benchmark_fn)(const BenchOptions& opt);
+
+/// Add a benchmark to the list.  Use BENCHMARK() rather than this directly.
+struct BenchRegistration
+{
+	BenchRegistration(const char *name, const char *desc, benchmark_fn fn);
+};
+
+/// Define a benchmark.
+/**
+ * Use it like a function definition, with the body following.  The options
+ * are available in the body as "opt".
+ *
+ * @param name
+ *   Name used to select the benchmark on the command line.
+ *
+ * @param desc
+ *   Description shown in the list of benchmarks.
+ */
+#define BENCHMARK(name, desc) \
+	static void bench_##name(const BenchOptions& opt); \
+	static BenchRegistration bench_reg_##name(#name, desc, bench_##name); \
+	static void bench_##name(const BenchOptions& opt)
+
+/// Measure how long something takes.
+class BenchTimer
+{
+	public:
+		/// Start timing.
+		BenchTimer();
+
+		/// Start timing again from now.
+		void restart();
+
+		/// Get the number of seconds since the timer was started.
+		double elapsed() const;
+
+	protected:
+		std::chrono::steady_clock::time_point start;
+};
+
+/// Print the result of one measurement.
+/**
+ * @param what
+ *   Description of what was measured.
+ *
+ * @param seconds
+ *   Time taken.
+ *
+ * @param bytes
+ *   If not zero, the amount of data processed, to print the throughput.
+ */
+void benchResult(const std::string& what, double seconds,
+	camoto::stream::len bytes = 0);
+
+/// Create a file of the given size filled with a repeating pattern.
+/**
+ * @throw stream::error if the file could not be written.
+ */
+void benchCreateFile(const std::string& filename, camoto::stream::len len);
+
+#endif // _CAMOTO_GAMEARCHIVE_BENCH_HPP_
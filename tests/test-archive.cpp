@@ -18,8 +18,12 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cstdio>
 #include <iomanip>
 #include <functional>
+#include <mutex>
+#include <camoto/stream_file.hpp>
 #include <camoto/util.hpp>
 #include <camoto/gamearchive/archive-fat.hpp> // Archive_FAT::FATEntry
 #include <camoto/gamearchive/fixedarchive.hpp> // FixedArchive::FixedEntry
@@ -47,6 +51,27 @@ BOOST_AUTO_TEST_CASE(archive_attribute_operators)
 	BOOST_REQUIRE_EQUAL((unsigned int)a, 2);
 }
 
+BOOST_AUTO_TEST_CASE(archive_manager_registry)
+{
+	BOOST_TEST_MESSAGE("Confirm format handlers are only created once");
+
+	auto formats1 = ArchiveManager::formats();
+	auto formats2 = ArchiveManager::formats();
+	BOOST_REQUIRE_EQUAL(formats1.size(), formats2.size());
+	for (unsigned int i = 0; i < formats1.size(); i++) {
+		BOOST_CHECK_EQUAL(formats1[i], formats2[i]);
+		// byCode() must return the same instance as the list
+		BOOST_CHECK_EQUAL(ArchiveManager::byCode(formats1[i]->code()), formats1[i]);
+	}
+
+	for (const auto& i : FilterManager::formats()) {
+		BOOST_CHECK_EQUAL(FilterManager::byCode(i->code()), i);
+	}
+
+	BOOST_CHECK(!ArchiveManager::byCode("this-format-does-not-exist"));
+	BOOST_CHECK(!FilterManager::byCode("this-filter-does-not-exist"));
+}
+
 test_archive::test_archive()
 	:	numIsInstanceTests(0),
 		numInvalidContentTests(1),
@@ -84,8 +109,24 @@ void test_archive::addTests()
 {
 	// Tests on existing archives (in the initial state)
 	ADD_ARCH_TEST(false, &test_archive::test_isinstance_others);
+	if (this->skipInstDetect.empty()) {
+		// Only autodetect if no other format claims our content
+		ADD_ARCH_TEST(false, &test_archive::test_probe);
+	}
 	if (!this->virtualFiles) {
 		ADD_ARCH_TEST(false, &test_archive::test_open);
+		ADD_ARCH_TEST(false, &test_archive::test_open_readonly);
+		if (this->lenMaxFilename >= 0) {
+			ADD_ARCH_TEST(false, &test_archive::test_path_index);
+		}
+		ADD_ARCH_TEST(false, &test_archive::test_extract_streaming);
+		if (!this->foldersOnly) {
+			ADD_ARCH_TEST(false, &test_archive::test_peek);
+			ADD_ARCH_TEST(false, &test_archive::test_extract_direct);
+			ADD_ARCH_TEST(false, &test_archive::test_extract_many);
+			ADD_ARCH_TEST(false, &test_archive::test_visit);
+			ADD_ARCH_TEST(false, &test_archive::test_index);
+		}
 	}
 	if (this->lenMaxFilename >= 0) {
 		// Only perform the rename test if the archive has filenames
@@ -101,8 +142,12 @@ void test_archive::addTests()
 		ADD_ARCH_TEST(false, &test_archive::test_insert_mid);
 		ADD_ARCH_TEST(false, &test_archive::test_insert_end);
 		ADD_ARCH_TEST(false, &test_archive::test_insert2);
+		if (!this->foldersOnly) {
+			ADD_ARCH_TEST(false, &test_archive::test_insert_many);
+		}
 		ADD_ARCH_TEST(false, &test_archive::test_remove);
 		ADD_ARCH_TEST(false, &test_archive::test_remove2);
+		ADD_ARCH_TEST(false, &test_archive::test_remove_many);
 		ADD_ARCH_TEST(false, &test_archive::test_remove_open);
 		ADD_ARCH_TEST(false, &test_archive::test_insert_remove);
 		ADD_ARCH_TEST(false, &test_archive::test_remove_insert);
@@ -112,9 +157,16 @@ void test_archive::addTests()
 			ADD_ARCH_TEST(false, &test_archive::test_resize_larger);
 			ADD_ARCH_TEST(false, &test_archive::test_resize_smaller);
 			ADD_ARCH_TEST(false, &test_archive::test_resize_write);
+			ADD_ARCH_TEST(false, &test_archive::test_decode_cache);
+			ADD_ARCH_TEST(false, &test_archive::test_archive_cache);
+			ADD_ARCH_TEST(false, &test_archive::test_insert_on_disk);
 			ADD_ARCH_TEST(false, &test_archive::test_resize_after_close);
 			ADD_ARCH_TEST(false, &test_archive::test_insert_zero_then_resize);
 			ADD_ARCH_TEST(false, &test_archive::test_resize_over64k);
+			ADD_ARCH_TEST(false, &test_archive::test_free_space);
+			if (!this->foldersOnly) {
+				ADD_ARCH_TEST(false, &test_archive::test_write_grow);
+			}
 		}
 		ADD_ARCH_TEST(false, &test_archive::test_remove_all_re_add);
 	}
@@ -130,6 +182,9 @@ void test_archive::addTests()
 			ADD_ARCH_TEST(true, &test_archive::test_new_isinstance);
 		}
 		ADD_ARCH_TEST(true, &test_archive::test_new_to_initialstate);
+		if (!this->foldersOnly && this->suppResult.empty()) {
+			ADD_ARCH_TEST(true, &test_archive::test_new_write);
+		}
 		if (this->lenFilesizeFixed < 0) {
 			// Only perform these tests if the archive's files can be resized
 			ADD_ARCH_TEST(true, &test_archive::test_new_manipulate_zero_length_files);
@@ -382,6 +437,13 @@ void test_archive::test_isInstance(ArchiveType::Certainty result,
 	ss << content;
 
 	BOOST_CHECK_EQUAL(pTestType->isInstance(ss), result);
+
+	// Anything isInstance() accepts must get past the signature prefilter too
+	if (result != ArchiveType::Certainty::DefinitelyNo) {
+		BOOST_CHECK_MESSAGE(signatureMatches(*pTestType, ss),
+			"Signature for " << this->type << " rejects content accepted by "
+			"isInstance()");
+	}
 	return;
 }
 
@@ -553,6 +615,34 @@ void test_archive::test_isinstance_others()
 	return;
 }
 
+void test_archive::test_probe()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Autodetecting format");
+
+	stream::string content;
+	content << this->content_12();
+
+	auto results = probeFormats(content);
+	bool found = false;
+	for (const auto& r : results) {
+		if (r.type->code().compare(this->type) == 0) {
+			found = true;
+			break;
+		}
+	}
+	BOOST_CHECK_MESSAGE(found, "probeFormats() did not suggest " << this->type
+		<< " for its own content");
+
+	// Running the probes concurrently must not change the outcome
+	auto resultsParallel = probeFormatsParallel(content, 4);
+	BOOST_REQUIRE_EQUAL(resultsParallel.size(), results.size());
+	for (unsigned int i = 0; i < results.size(); i++) {
+		BOOST_CHECK_EQUAL(resultsParallel[i].type->code(), results[i].type->code());
+		BOOST_CHECK_EQUAL(resultsParallel[i].certainty, results[i].certainty);
+	}
+	return;
+}
+
 void test_archive::test_open()
 {
 	BOOST_TEST_MESSAGE(this->basename << ": Opening file in archive");
@@ -586,6 +676,283 @@ void test_archive::test_open()
 	// No changes, so no flush
 }
 
+void test_archive::test_open_readonly()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Opening file in read-only archive");
+
+	auto pArchType = ArchiveManager::byCode(this->type);
+	BOOST_REQUIRE_MESSAGE(pArchType, "Could not find archive type " + this->type);
+
+	// Replace the archive with one that can only read from its stream
+	this->pArchive = pArchType->openReadOnly(
+		std::make_unique<stream::input_string>(this->content_12()),
+		this->suppData);
+	BOOST_REQUIRE_MESSAGE(this->pArchive, "Could not open read-only archive");
+
+	auto ep = this->findFile(0);
+
+	if (this->foldersOnly) {
+		this->pArchive = this->pArchive->openFolder(ep);
+		ep = this->findFile(0);
+	}
+
+	auto pfsIn = this->pArchive->open(ep, true);
+
+	stream::string out;
+	stream::copy(out, *pfsIn);
+
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(this->content[0], out.data),
+		"Error opening file or wrong file opened in read-only archive"
+	);
+
+	// No changes, so no flush
+}
+
+void test_archive::test_path_index()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Finding a file through a path index");
+
+	auto root = this->pArchive;
+	auto ep = this->findFile(0);
+	std::string path = ep->strName;
+
+	if (this->foldersOnly) {
+		this->pArchive = this->pArchive->openFolder(ep);
+		ep = this->findFile(0);
+		path += "/" + ep->strName;
+	}
+
+	PathIndex index(root);
+
+	std::shared_ptr<Archive> destArchive = root;
+	Archive::FileHandle id;
+	camoto::gamearchive::findFile(index, &destArchive, &id, path);
+	BOOST_REQUIRE_MESSAGE(destArchive->isValid(id),
+		"Couldn't find " << path << " through path index");
+	BOOST_CHECK_EQUAL(id->strName, ep->strName);
+
+	stream::string out;
+	auto pfsIn = destArchive->open(id, true);
+	stream::copy(out, *pfsIn);
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(this->content[0], out.data),
+		"Wrong file found through path index"
+	);
+
+	// A second lookup must return the same folder instance, not reopen it
+	std::shared_ptr<Archive> destArchive2 = root;
+	camoto::gamearchive::findFile(index, &destArchive2, &id, path);
+	BOOST_CHECK_MESSAGE(destArchive == destArchive2,
+		"Path index opened the same folder twice");
+
+	camoto::gamearchive::findFile(index, &destArchive2, &id, path + "_missing");
+	BOOST_CHECK_MESSAGE(!id, "Path index found a file that doesn't exist");
+}
+
+void test_archive::test_extract_streaming()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Extracting a file through a small "
+		"streaming buffer");
+
+	auto ep = this->findFile(0);
+
+	if (this->foldersOnly) {
+		this->pArchive = this->pArchive->openFolder(ep);
+		ep = this->findFile(0);
+	}
+
+	// Use an odd-sized buffer much smaller than the file so the data has to
+	// wrap around the end of the buffer many times.
+	stream::string out;
+	extractStreaming(*this->pArchive, ep, out, 7);
+
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(this->content[0], out.data),
+		"Wrong data extracted through streaming buffer"
+	);
+}
+
+void test_archive::test_peek()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Peeking at the start of a file");
+
+	auto ep = this->findFile(0);
+
+	std::string start = this->pArchive->peek(ep, 4);
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(this->content[0].substr(0, 4), start),
+		"Peeking at the start of a file returned the wrong data"
+	);
+
+	// Asking for more than there is should return the whole file
+	std::string all = this->pArchive->peek(ep, this->content[0].length() + 16);
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(this->content[0], all),
+		"Peeking past the end of a file returned the wrong data"
+	);
+}
+
+void test_archive::test_visit()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Visiting all files in disk order");
+
+	auto ep1 = this->findFile(0);
+	auto ep2 = this->findFile(1);
+
+	std::mutex lock;
+	std::map<Archive::FileHandle, std::string> seen;
+	visitFiles(this->pArchive, this->pArchive->files(), true,
+		[&](const Archive::FileHandle& id, stream::input& content) {
+			stream::string out;
+			stream::copy(out, content);
+			std::lock_guard<std::mutex> l(lock);
+			seen[id] = out.data;
+		},
+		2
+	);
+
+	BOOST_REQUIRE_MESSAGE(seen.find(ep1) != seen.end(),
+		"First file was not visited");
+	BOOST_REQUIRE_MESSAGE(seen.find(ep2) != seen.end(),
+		"Second file was not visited");
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(this->content[0], seen[ep1]),
+		"Wrong data given for first file"
+	);
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(this->content[1], seen[ep2]),
+		"Wrong data given for second file"
+	);
+
+	// No changes, so no flush
+}
+
+void test_archive::test_index()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Reopening archive from saved index");
+
+	auto pFATArchive = std::dynamic_pointer_cast<Archive_FAT>(this->pArchive);
+	if (!pFATArchive) return; // only FAT archives can write an index
+
+	stream::string index;
+	pFATArchive->writeIndex(index);
+	index.seekg(0, stream::start);
+
+	auto pArchType = ArchiveManager::byCode(this->type);
+	BOOST_REQUIRE_MESSAGE(pArchType, "Could not find archive type " + this->type);
+
+	auto content = std::make_unique<stream::string>();
+	*content << this->content_12();
+	this->pArchive = pArchType->openIndexed(std::move(content),
+		this->suppData, index);
+	BOOST_REQUIRE_MESSAGE(this->pArchive, "Could not open archive from index");
+
+	BOOST_REQUIRE_EQUAL(this->pArchive->files().size(),
+		pFATArchive->files().size());
+
+	auto ep = this->findFile(0);
+	auto pfsIn = this->pArchive->open(ep, true);
+	stream::string out;
+	stream::copy(out, *pfsIn);
+
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(this->content[0], out.data),
+		"Wrong data read from archive opened with an index"
+	);
+
+	// No changes, so no flush
+}
+
+void test_archive::test_extract_direct()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Extracting raw file data directly");
+
+	auto ep = this->findFile(0);
+
+	// Put the archive in a real file so it has a file descriptor
+	FILE *fArchive = tmpfile();
+	FILE *fOut = tmpfile();
+	BOOST_REQUIRE(fArchive && fOut);
+	std::string archiveData = this->content_12();
+	fwrite(archiveData.data(), 1, archiveData.length(), fArchive);
+	fflush(fArchive);
+
+	bool copied = extractTo(ep, fileno(fArchive), fileno(fOut));
+	if (copied) {
+		// Not all platforms support this, but if it worked the data must be the
+		// same as reading it through the normal streams.
+		std::string direct(ep->storedSize, '\0');
+		rewind(fOut);
+		BOOST_REQUIRE_EQUAL(fread(&direct[0], 1, direct.length(), fOut),
+			direct.length());
+
+		stream::string viaStream;
+		auto in = this->pArchive->open(ep, false);
+		stream::copy(viaStream, *in);
+
+		BOOST_CHECK_MESSAGE(
+			this->is_equal(viaStream.data, direct),
+			"Data copied directly does not match data read through the archive"
+		);
+	}
+	fclose(fOut);
+	fclose(fArchive);
+	return;
+}
+
+void test_archive::test_extract_many()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Extracting many files directly");
+
+	Archive::FileHandle ep[2];
+	ep[0] = this->findFile(0);
+	ep[1] = this->findFile(1);
+
+	// Put the archive in a real file so it has a file descriptor
+	FILE *fArchive = tmpfile();
+	FILE *fOut[2];
+	fOut[0] = tmpfile();
+	fOut[1] = tmpfile();
+	BOOST_REQUIRE(fArchive && fOut[0] && fOut[1]);
+	std::string archiveData = this->content_12();
+	fwrite(archiveData.data(), 1, archiveData.length(), fArchive);
+	fflush(fArchive);
+
+	std::vector<ExtractTarget> targets;
+	targets.push_back({ep[0], fileno(fOut[0])});
+	targets.push_back({ep[1], fileno(fOut[1])});
+	auto skipped = extractMany(targets, fileno(fArchive));
+
+	for (unsigned int i = 0; i < 2; i++) {
+		bool wasSkipped = false;
+		for (const auto& s : skipped) {
+			if (s.id == ep[i]) wasSkipped = true;
+		}
+		// Not all platforms support this, but anything that was copied must be
+		// the same as reading it through the normal streams.
+		if (wasSkipped) continue;
+
+		std::string direct(ep[i]->storedSize, '\0');
+		rewind(fOut[i]);
+		BOOST_REQUIRE_EQUAL(fread(&direct[0], 1, direct.length(), fOut[i]),
+			direct.length());
+
+		stream::string viaStream;
+		auto in = this->pArchive->open(ep[i], false);
+		stream::copy(viaStream, *in);
+
+		BOOST_CHECK_MESSAGE(
+			this->is_equal(viaStream.data, direct),
+			"Data copied directly does not match data read through the archive"
+		);
+	}
+	fclose(fOut[1]);
+	fclose(fOut[0]);
+	fclose(fArchive);
+	return;
+}
+
 void test_archive::test_rename()
 {
 	BOOST_TEST_MESSAGE(this->basename << ": Renaming file inside archive");
@@ -822,6 +1189,36 @@ void test_archive::test_insert2()
 	);
 }
 
+void test_archive::test_insert_many()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Inserting multiple files at once");
+
+	Archive::FileHandle epBefore = this->findFile(1);
+
+	// Both files go before the second one, so they end up in between
+	std::vector<Archive::NewFile> newFiles = {
+		{epBefore, this->filename[2], this->content[2].length(),
+			this->insertType, this->insertAttr},
+		{epBefore, this->filename[3], this->content[3].length(),
+			this->insertType, this->insertAttr},
+	};
+	auto added = this->pArchive->insertMany(newFiles);
+
+	BOOST_REQUIRE_EQUAL(added.size(), 2u);
+	for (unsigned int i = 0; i < 2; i++) {
+		BOOST_REQUIRE_MESSAGE(this->pArchive->isValid(added[i]),
+			"Couldn't insert new file " << i + 1 << " in sample archive");
+
+		auto pfsNew = this->pArchive->open(added[i], true);
+		pfsNew->write(this->content[2 + i]);
+		pfsNew->flush();
+	}
+
+	this->checkData(&test_archive::content_1342,
+		"Error inserting two files at once"
+	);
+}
+
 void test_archive::test_remove()
 {
 	BOOST_TEST_MESSAGE(this->basename << ": Removing file from archive");
@@ -852,6 +1249,21 @@ void test_archive::test_remove2()
 	);
 }
 
+void test_archive::test_remove_many()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Removing multiple files at once");
+
+	Archive::FileHandle ep1 = this->findFile(0);
+	Archive::FileHandle ep2 = this->findFile(1);
+
+	// Remove them in reverse order, which shouldn't make any difference
+	this->pArchive->removeMany({ep2, ep1});
+
+	this->checkData(&test_archive::content_0,
+		"Error removing multiple files at once"
+	);
+}
+
 void test_archive::test_remove_open()
 {
 	BOOST_TEST_MESSAGE(this->basename << ": Attemping to remove an open file");
@@ -1089,6 +1501,178 @@ void test_archive::test_resize_write()
 	);
 }
 
+void test_archive::test_decode_cache()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Reading a file through the decode "
+		"cache after changing it");
+
+	auto ep = this->findFile(0);
+
+	if (this->foldersOnly) {
+		this->pArchive = this->pArchive->openFolder(ep);
+		ep = this->findFile(0);
+	}
+
+	DecodeCache cache(1024 * 1024);
+
+	// Read it twice, the second time from the cache
+	for (int i = 0; i < 2; i++) {
+		stream::string out;
+		auto pfsIn = cache.open(this->pArchive, ep);
+		stream::copy(out, *pfsIn);
+		BOOST_CHECK_MESSAGE(
+			this->is_equal(this->content[0], out.data),
+			"Wrong data returned by decode cache"
+		);
+	}
+	BOOST_REQUIRE_EQUAL(cache.size(), this->content[0].length());
+
+	// Change the file, which should stop the cached copy being used
+	{
+		auto pfsNew = this->pArchive->open(ep, true);
+		pfsNew->truncate(this->content0_overwritten.length());
+		pfsNew->seekp(0, stream::start);
+		pfsNew->write(this->content0_overwritten);
+		pfsNew->flush();
+	}
+	this->pArchive->flush();
+
+	stream::string out;
+	auto pfsIn = cache.open(this->pArchive, ep);
+	stream::copy(out, *pfsIn);
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(this->content0_overwritten, out.data),
+		"Decode cache returned out of date data after the file was changed"
+	);
+	BOOST_CHECK_EQUAL(cache.size(), this->content0_overwritten.length());
+}
+
+void test_archive::test_archive_cache()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Opening the same archive twice "
+		"through the archive cache");
+
+	// The cache opens supplemental files itself, and folders need to be opened
+	// before files can be found in them, so only test the simple case.
+	if (!this->suppBase.empty() || this->foldersOnly) return;
+
+	auto pArchType = ArchiveManager::byCode(this->type);
+	std::string filename = this->basename + ".cache-test";
+	{
+		stream::output_file out(filename, true);
+		out.write(this->base->data);
+		out.truncate(this->base->data.length());
+		out.flush();
+	}
+
+	// Work out where the first file is in the list, as the cached archive is a
+	// different instance with its own FileHandles.
+	auto ep = this->findFile(0);
+	auto& files = this->pArchive->files();
+	auto index = std::find(files.begin(), files.end(), ep) - files.begin();
+
+	{
+		ArchiveCache cache(1);
+		auto arch1 = cache.open(filename, pArchType);
+		auto arch2 = cache.open(filename, pArchType);
+		BOOST_CHECK_MESSAGE(arch1 == arch2,
+			"Archive cache opened the same file twice");
+
+		stream::string out;
+		auto pfsIn = arch1->open(arch1->files()[index]);
+		stream::copy(out, *pfsIn);
+		BOOST_CHECK_MESSAGE(
+			this->is_equal(this->content[0], out.data),
+			"Wrong data returned by archive in archive cache"
+		);
+
+		// Once nothing is using it the archive should be kept as one of the
+		// idle ones, until another pushes it out.
+		arch1.reset();
+		arch2.reset();
+		cache.setMaxIdle(0);
+		BOOST_CHECK_EQUAL(cache.size(), 0u);
+	}
+
+	std::remove(filename.c_str());
+}
+
+void test_archive::test_insert_on_disk()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Insert and remove a file in an "
+		"archive stored in a file on disk, and reopen it each time");
+
+	// Supplemental files would need writing out too, so only test the simple
+	// case.
+	if (!this->suppBase.empty() || this->foldersOnly) return;
+
+	auto pArchType = ArchiveManager::byCode(this->type);
+	std::string filename = this->basename + ".disk-test";
+	{
+		stream::output_file out(filename, true);
+		out.write(this->base->data);
+		out.truncate(this->base->data.length());
+		out.flush();
+	}
+
+	stream::len lenNew = 4096;
+	std::string dataNew(lenNew, '\0');
+	for (stream::len i = 0; i < lenNew; i++) dataNew[i] = 'A' + i % 26;
+
+	// Work out where the first file is in the list, as the archive opened from
+	// disk is a different instance with its own FileHandles.
+	auto ep = this->findFile(0);
+	auto& files = this->pArchive->files();
+	auto index = std::find(files.begin(), files.end(), ep) - files.begin();
+
+	{
+		auto arch = pArchType->open(std::make_unique<stream::file>(filename,
+			false), this->suppData);
+		auto epNew = arch->insert(arch->files()[index], this->filename[2],
+			lenNew, this->insertType, this->insertAttr);
+		BOOST_REQUIRE_MESSAGE(arch->isValid(epNew),
+			"Couldn't insert new file in archive on disk");
+		auto pfsNew = arch->open(epNew, false);
+		pfsNew->write(dataNew);
+		pfsNew->flush();
+		arch->flush();
+	}
+
+	{
+		auto arch = pArchType->open(std::make_unique<stream::file>(filename,
+			false), this->suppData);
+		BOOST_REQUIRE_GT(arch->files().size(), (unsigned long)index + 1);
+
+		stream::string out;
+		auto pfsIn = arch->open(arch->files()[index], false);
+		stream::copy(out, *pfsIn);
+		BOOST_CHECK_MESSAGE(out.data == dataNew,
+			"Inserted file has the wrong data after reopening the archive");
+
+		stream::string out2;
+		pfsIn = arch->open(arch->files()[index + 1], true);
+		stream::copy(out2, *pfsIn);
+		BOOST_CHECK_MESSAGE(this->is_equal(this->content[0], out2.data),
+			"File after the inserted one has the wrong data after reopening the "
+			"archive");
+
+		arch->remove(arch->files()[index]);
+		arch->flush();
+	}
+
+	{
+		auto arch = pArchType->open(std::make_unique<stream::file>(filename,
+			false), this->suppData);
+		stream::string out;
+		auto pfsIn = arch->open(arch->files()[index], true);
+		stream::copy(out, *pfsIn);
+		BOOST_CHECK_MESSAGE(this->is_equal(this->content[0], out.data),
+			"File has the wrong data after removing the one before it");
+	}
+
+	std::remove(filename.c_str());
+}
+
 void test_archive::test_resize_after_close()
 {
 	BOOST_TEST_MESSAGE(this->basename << ": Write to a file after closing the archive");
@@ -1257,6 +1841,135 @@ void test_archive::test_resize_over64k()
 	}
 }
 
+void test_archive::test_write_grow()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Enlarge a file with many small writes");
+
+	auto ep1 = this->findFile(0);
+	auto ep2 = this->findFile(1);
+
+	stream::string orig2;
+	{
+		auto in = this->pArchive->open(ep2, false);
+		stream::copy(orig2, *in);
+	}
+
+	std::string expected;
+	{
+		auto out = this->pArchive->open(ep1, false);
+		out->truncate(0);
+		for (int i = 0; i < 200; i++) {
+			std::string chunk = createString("Chunk " << i << ";");
+			out->write(chunk);
+			expected += chunk;
+		}
+		out->flush();
+
+		// Any space reserved while writing must be gone after the flush
+		BOOST_REQUIRE_EQUAL(out->size(), expected.length());
+	}
+	BOOST_REQUIRE_EQUAL(ep1->storedSize, expected.length());
+
+	stream::string result1, result2;
+	{
+		auto in = this->pArchive->open(ep1, false);
+		stream::copy(result1, *in);
+	}
+	{
+		auto in = this->pArchive->open(ep2, false);
+		stream::copy(result2, *in);
+	}
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(expected, result1.data),
+		"Data written in small pieces was not stored correctly"
+	);
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(orig2.data, result2.data),
+		"Following file was corrupted by writing in small pieces"
+	);
+
+	this->pArchive->flush();
+}
+
+void test_archive::test_free_space()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Relocate files using free space");
+
+	auto pFATArchive = std::dynamic_pointer_cast<Archive_FAT>(this->pArchive);
+	if (!pFATArchive || !pFATArchive->enableFreeSpace()) {
+		// Format needs its files in FAT order
+		return;
+	}
+	pFATArchive.reset(); // don't hold an extra reference
+
+	auto readRaw = [this](const Archive::FileHandle& id) {
+		stream::string out;
+		auto in = this->pArchive->open(id, false);
+		stream::copy(out, *in);
+		return out.data;
+	};
+
+	auto ep1 = this->findFile(0);
+	auto ep2 = this->findFile(1);
+	std::string orig1 = readRaw(ep1);
+	std::string orig2 = readRaw(ep2);
+
+	// Enlarge the first file, which will have to move it past the second one
+	this->pArchive->resize(ep1, ep1->storedSize + 20, ep1->realSize + 20);
+	std::string large1 = readRaw(ep1);
+	BOOST_REQUIRE_EQUAL(large1.length(), orig1.length() + 20);
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(orig1, large1.substr(0, orig1.length())),
+		"Data lost when relocating enlarged file"
+	);
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(orig2, readRaw(ep2)),
+		"Following file changed when relocating enlarged file"
+	);
+
+	// Add a new file, which should reuse the gap left behind
+	auto ep3 = this->pArchive->insert(nullptr, this->filename[2],
+		this->content[2].length(), this->insertType, this->insertAttr);
+	{
+		auto out = this->pArchive->open(ep3, false);
+		out->write(this->content[2]);
+		out->flush();
+	}
+
+	// Remove the gaps and make sure everything is still intact after reopening
+	auto pFAT = std::dynamic_pointer_cast<Archive_FAT>(this->pArchive);
+	pFAT->compact();
+	pFAT.reset();
+	this->pArchive->flush();
+	this->pArchive.reset();
+
+	auto pTestType = ArchiveManager::byCode(this->type);
+	BOOST_REQUIRE(pTestType);
+	this->populateSuppData();
+	auto base2 = stream_wrap(this->base);
+	this->pArchive = pTestType->open(std::move(base2), this->suppData);
+
+	ep1 = this->pArchive->find(this->filename[0]);
+	ep2 = this->pArchive->find(this->filename[1]);
+	ep3 = this->pArchive->find(this->filename[2]);
+	BOOST_REQUIRE(this->pArchive->isValid(ep1));
+	BOOST_REQUIRE(this->pArchive->isValid(ep2));
+	BOOST_REQUIRE(this->pArchive->isValid(ep3));
+
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(large1, readRaw(ep1)),
+		"Relocated file corrupted after compacting archive"
+	);
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(orig2, readRaw(ep2)),
+		"Unmoved file corrupted after compacting archive"
+	);
+	BOOST_CHECK_MESSAGE(
+		this->is_equal(this->content[2], readRaw(ep3)),
+		"New file corrupted after compacting archive"
+	);
+}
+
 void test_archive::test_shortext()
 {
 	BOOST_TEST_MESSAGE(this->basename << ": Rename a file with a short extension");
@@ -1351,6 +2064,9 @@ void test_archive::test_new_isinstance()
 		pTestType->isInstance(*this->base) != ArchiveType::Certainty::DefinitelyNo,
 		"Newly created archive was not recognised as a valid instance");
 
+	BOOST_REQUIRE_MESSAGE(signatureMatches(*pTestType, *this->base),
+		"Newly created archive does not match the format's signature");
+
 	BOOST_TEST_CHECKPOINT("New archive reported valid, trying to open");
 
 	// Make this->suppData valid again, reusing previous data
@@ -1439,6 +2155,41 @@ void test_archive::test_new_to_initialstate()
 	BOOST_REQUIRE_EQUAL(files.size(), 2);
 }
 
+void test_archive::test_new_write()
+{
+	BOOST_TEST_MESSAGE(this->basename << ": Writing archive in one pass");
+
+	// write() always uses the default attribute values, so skip the test if
+	// this format's test case needs them changed.
+	this->pArchive->flush();
+	std::string blank = this->base->data;
+	this->setAttributes();
+	this->pArchive->flush();
+	if (this->base->data.compare(blank) != 0) {
+		BOOST_TEST_MESSAGE(this->basename
+			<< ": Skipping, test case needs non-default attributes");
+		return;
+	}
+
+	// Start again with nothing, as write() does the same job as create()
+	this->pArchive.reset();
+	this->base->data.clear();
+	this->base->seekp(0, stream::start);
+
+	stream::string one(this->content[0]);
+	stream::string two(this->content[1]);
+
+	auto pArchType = ArchiveManager::byCode(this->type);
+	pArchType->write(*this->base, {
+		{this->filename[0], this->insertType, this->insertAttr, &one},
+		{this->filename[1], this->insertType, this->insertAttr, &two},
+	}, this->suppData);
+
+	this->checkData(&test_archive::content_12,
+		"Error writing archive in one pass"
+	);
+}
+
 // The function shifting files can get confused if a zero-length file is
 // inserted, incorrectly moving it because of the zero size.
 void test_archive::test_new_manipulate_zero_length_files()
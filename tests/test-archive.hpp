@@ -71,15 +71,26 @@ class test_archive: public test_main
 			unsigned int index);
 
 		virtual void test_isinstance_others();
+		void test_probe();
 		void test_open();
+		void test_open_readonly();
+		void test_path_index();
+		void test_extract_streaming();
+		void test_peek();
+		void test_visit();
+		void test_index();
+		void test_extract_direct();
+		void test_extract_many();
 		void test_rename();
 		void test_rename_long();
 		void test_insert_long();
 		void test_insert_mid();
 		void test_insert_end();
 		void test_insert2();
+		void test_insert_many();
 		void test_remove();
 		void test_remove2();
+		void test_remove_many();
 		void test_remove_open();
 		void test_insert_remove();
 		void test_remove_insert();
@@ -87,15 +98,21 @@ class test_archive: public test_main
 		void test_resize_larger();
 		void test_resize_smaller();
 		void test_resize_write();
+		void test_decode_cache();
+		void test_archive_cache();
+		void test_insert_on_disk();
 		void test_resize_after_close();
 		void test_remove_all_re_add();
 		void test_insert_zero_then_resize();
 		void test_resize_over64k();
+		void test_free_space();
+		void test_write_grow();
 		void test_shortext();
 		void test_attributes();
 
 		virtual void test_new_isinstance();
 		virtual void test_new_to_initialstate();
+		void test_new_write();
 		void test_new_manipulate_zero_length_files();
 
 	protected:
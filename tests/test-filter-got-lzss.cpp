@@ -47,6 +47,17 @@ class test_filter_got_lzss: public test_filter
 			), STRING_WITH_NULLS(
 				"ABCDE"
 			));
+
+			// Long enough to span a few checkpoints when read out of order
+			std::string longFiltered = STRING_WITH_NULLS("\x40\x9C\x01\x00");
+			std::string longPlain;
+			for (unsigned int i = 0; i < 40000; i++) {
+				if (i % 8 == 0) longFiltered += '\xFF';
+				char c = 'A' + (i * 7) % 26;
+				longFiltered += c;
+				longPlain += c;
+			}
+			this->content_decode("long", longFiltered, longPlain);
 		}
 };
 
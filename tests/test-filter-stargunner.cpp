@@ -0,0 +1,117 @@
+/**
+ * @file   test-filter-stargunner.cpp
+ * @brief  Test code for Stargunner compression algorithm.
+ *
+ * Copyright (C) 2010-2017 Adam Nielsen <malvineous@shikadi.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test-filter.hpp"
+
+using namespace camoto::gamearchive;
+
+class test_filter_stargunner: public test_filter
+{
+	public:
+		test_filter_stargunner()
+		{
+			this->type = "bpe-stargunner";
+		}
+
+		void addTests()
+		{
+			this->test_filter::addTests();
+
+			// Wrong signature
+			this->invalidContent(STRING_WITH_NULLS(
+				"PGBX\x08\x00\x00\x00"
+				"\x0D\x00"
+				"\xFF\x80\xFE"
+				"\x08\x00"
+				"ABCDEFGH"
+			));
+
+			// No repeated pairs, so an empty dictionary
+			this->content("normal", 8, STRING_WITH_NULLS(
+				"PGBP\x08\x00\x00\x00"
+				"\x0D\x00"
+				"\xFF\x80\xFE"
+				"\x08\x00"
+				"ABCDEFGH"
+			), STRING_WITH_NULLS(
+				"ABCDEFGH"
+			));
+
+			// One pair replaced by a codeword
+			this->content("pairs", 8, STRING_WITH_NULLS(
+				"PGBP\x08\x00\x00\x00"
+				"\x0C\x00"
+				"\x00\x41\x42\xFF\x81\xFD"
+				"\x04\x00"
+				"\x00\x00\x00\x00"
+			), STRING_WITH_NULLS(
+				"ABABABAB"
+			));
+
+			ADD_FILTER_TEST(&test_filter_stargunner::patch_middle_chunk);
+		}
+
+		/// Change a few bytes in the middle of a multi-chunk file
+		void patch_middle_chunk()
+		{
+			std::string src;
+			for (unsigned int i = 0; i < 12000; i++) {
+				src += (char)('A' + (i * 7 + i / 13) % 26);
+			}
+
+			auto sTemp = std::make_unique<stream::output_string>();
+			auto& sCompressed_data = sTemp->data;
+			auto sCompressed = this->apply_out(std::move(sTemp), nullptr);
+			sCompressed->write(src);
+			sCompressed->flush();
+			std::string original = sCompressed_data;
+
+			auto sContent = std::make_unique<stream::string>(original);
+			auto& sContent_data = sContent->data;
+			auto inout = this->apply_inout(std::move(sContent), nullptr);
+
+			BOOST_TEST_CHECKPOINT("Patch through in/out filter");
+			inout->seekp(5000, stream::start);
+			inout->write("ZZZZ", 4);
+			inout->flush();
+			src.replace(5000, 4, "ZZZZ");
+
+			// The first chunk was not touched, so it must not have been re-encoded
+			unsigned int lenFirst = 8 + 2
+				+ (uint8_t)original[8] + ((uint8_t)original[9] << 8);
+			BOOST_REQUIRE_MESSAGE(
+				this->is_equal(original.substr(0, lenFirst),
+					sContent_data.substr(0, lenFirst)),
+				"Patching the second chunk changed the first one"
+			);
+
+			auto input = this->apply_in(
+				std::make_unique<stream::input_string>(sContent_data));
+			auto filterResult = std::make_unique<stream::string>();
+			stream::copy(*filterResult, *input);
+
+			BOOST_REQUIRE_MESSAGE(
+				this->is_equal(src, filterResult->data),
+				"Patching Stargunner data produced incorrect result"
+			);
+		}
+};
+
+IMPLEMENT_TESTS(filter_stargunner);
@@ -142,6 +142,13 @@ void test_filter::content_decode(const std::string& name,
 		createString("content_read_inout/" << name)
 	);
 
+	// Read out of order through a seekable input filter
+	this->addBoundTest(
+		std::bind(&test_filter::test_content_read_seekable, this, filtered, plain),
+		__FILE__, __LINE__,
+		createString("content_read_seekable/" << name)
+	);
+
 	return;
 }
 
@@ -213,6 +220,49 @@ void test_filter::test_content_read_inout(const std::string& filtered,
 	return;
 }
 
+void test_filter::test_content_read_seekable(const std::string& filtered,
+	const std::string& plain)
+{
+	BOOST_TEST_MESSAGE(this->basename << ": "
+		<< boost::unit_test::framework::current_test_case().p_name);
+
+	auto input = this->apply_seekable(
+		std::make_unique<stream::input_string>(filtered)
+	);
+
+	BOOST_TEST_CHECKPOINT("Read second half through seekable filter");
+	stream::pos half = plain.length() / 2;
+	input->seekg(half, stream::start);
+	std::string second = input->read(plain.length() - half);
+	BOOST_REQUIRE_MESSAGE(
+		this->is_equal(plain.substr(half), second),
+		"Reading from the middle through seekable filter produced incorrect "
+		"result"
+	);
+
+	BOOST_TEST_CHECKPOINT("Seek back and read everything through seekable "
+		"filter");
+	input->seekg(0, stream::start);
+	std::string all = input->read(plain.length());
+	BOOST_REQUIRE_MESSAGE(
+		this->is_equal(plain, all),
+		"Reading after seeking back through seekable filter produced incorrect "
+		"result"
+	);
+
+	BOOST_TEST_CHECKPOINT("Seek back to the middle through seekable filter");
+	stream::pos quarter = plain.length() * 3 / 4;
+	input->seekg(quarter, stream::start);
+	second = input->read(plain.length() - quarter);
+	BOOST_REQUIRE_MESSAGE(
+		this->is_equal(plain.substr(quarter), second),
+		"Reading after seeking back to the middle through seekable filter "
+		"produced incorrect result"
+	);
+
+	return;
+}
+
 void test_filter::test_content_write_out(const std::string& filtered,
 	const std::string& plain, stream::len prefilteredSize)
 {
@@ -280,6 +330,18 @@ std::unique_ptr<stream::input> test_filter::apply_in(
 	);
 }
 
+std::unique_ptr<stream::input> test_filter::apply_seekable(
+	std::unique_ptr<stream::input> content)
+{
+	// Tests that override apply_in() to set up the filter themselves don't have
+	// a filter type to get a seekable stream from.
+	if (!this->pFilterType) return this->apply_in(std::move(content));
+
+	return this->pFilterType->applySeekable(
+		std::move(content)
+	);
+}
+
 std::unique_ptr<stream::output> test_filter::apply_out(
 	std::unique_ptr<stream::output> content, stream::len *setPrefiltered)
 {
@@ -101,6 +101,9 @@ class test_filter: public test_main
 		virtual std::unique_ptr<stream::input> apply_in(
 			std::unique_ptr<stream::input> content);
 
+		virtual std::unique_ptr<stream::input> apply_seekable(
+			std::unique_ptr<stream::input> content);
+
 		virtual std::unique_ptr<stream::output> apply_out(
 			std::unique_ptr<stream::output> content, stream::len *setPrefiltered);
 
@@ -120,6 +123,11 @@ class test_filter: public test_main
 		void test_content_read_inout(const std::string& filtered,
 			const std::string& plain);
 
+		/// Perform a content check now, reading the data out of order through
+		/// FilterType::applySeekable().
+		void test_content_read_seekable(const std::string& filtered,
+			const std::string& plain);
+
 		/// Perform a content check now, writing the data through a stream::output.
 		void test_content_write_out(const std::string& filtered,
 			const std::string& plain, stream::len prefilteredSize);
@@ -620,20 +620,20 @@ class test_dat_got: public test_archive
 		{
 #ifdef USE_XOR
 #define CONTENT \
-	"\xD4\xD6\xCD\x83\x84\x85\x86\x87\x88" "\x89\x9D\x8B\x8C" "\x82\x8E\x8F\x90" "\x9E\x92\x93\x94" "\x95\x96" \
-	"\xD8\xD6\xDC\x9A\x9B\x9C\x9D\x9E\x9F" "\xAF\xB6\xA2\xA3" "\xAB\xA5\xA6\xA7" "\xA7\xA9\xAA\xAB" "\xAC\xAD"
+	"\xD4\xD6\xCD\x83\x84\x85\x86\x87\x88" "\x86\x9D\x8B\x8C" "\x82\x8E\x8F\x90" "\x9E\x92\x93\x94" "\x95\x96" \
+	"\xD8\xD6\xDC\x9A\x9B\x9C\x9D\x9E\x9F" "\xA0\xB6\xA2\xA3" "\xAB\xA5\xA6\xA7" "\xA7\xA9\xAA\xAB" "\xAC\xAD"
 #else
 #define CONTENT \
-	"TWO\0\0\0\0\0\0" "\x00\x17\x00\x00" "\x0f\x00\x00\x00" "\x0f\x00\x00\x00" "\x00\x00" \
-	"ONE\0\0\0\0\0\0" "\x0f\x17\x00\x00" "\x0f\x00\x00\x00" "\x0f\x00\x00\x00" "\x00\x00"
+	"TWO\0\0\0\0\0\0" "\x0f\x17\x00\x00" "\x0f\x00\x00\x00" "\x0f\x00\x00\x00" "\x00\x00" \
+	"ONE\0\0\0\0\0\0" "\x00\x17\x00\x00" "\x0f\x00\x00\x00" "\x0f\x00\x00\x00" "\x00\x00"
 #endif
 			return STRING_WITH_NULLS(
 				CONTENT
 				EMPTY_FILE_3
 				EMPTY_FILE_4
 				REMAINING_EMPTY_FILES
-				"This is two.dat"
 				"This is one.dat"
+				"This is two.dat"
 			);
 #undef CONTENT
 		}
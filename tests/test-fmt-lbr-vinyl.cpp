@@ -74,6 +74,41 @@ class test_lbr_vinyl: public test_archive
 				"This is one.dat"
 				"This is two.dat"
 			));
+
+			ADD_ARCH_TEST(false, &test_lbr_vinyl::test_recover_names);
+		}
+
+		void test_recover_names()
+		{
+			BOOST_TEST_MESSAGE(this->basename << ": Recovering an unknown filename");
+
+			auto pArchType = ArchiveManager::byCode(this->type);
+			auto content = std::make_unique<stream::string>(STRING_WITH_NULLS(
+				"\x01\x00"
+				"\x57\x0e" "\x08\x00\x00\x00"
+				"Secret!"
+			));
+			auto pArchive = pArchType->open(std::move(content), this->suppData);
+
+			auto nameHash = nameHashFor(this->type);
+			BOOST_REQUIRE_MESSAGE(nameHash, "No name hash for " << this->type);
+			BOOST_CHECK_EQUAL(nameHash->hash("ONE.DAT"), 0xff7c);
+
+			auto targets = unknownHashes(*pArchive, *nameHash);
+			BOOST_REQUIRE_EQUAL(targets.size(), 1u);
+			BOOST_CHECK_EQUAL(*targets.begin(), 0x0e57);
+
+			NameRecoveryOptions options;
+			options.words = {"OPEN", "SECRET", "DOOR"};
+			options.extensions = {"CMP", "DAT"};
+			options.pairs = true;
+			options.maxDigits = 2;
+			options.numThreads = 2;
+			auto found = recoverNames(*nameHash, targets, options);
+
+			auto it = found.find(0x0e57);
+			BOOST_REQUIRE_MESSAGE(it != found.end(), "No names found for hash");
+			BOOST_CHECK_EQUAL(it->second[0].name, "SECRET.DAT");
 		}
 
 		virtual std::string content_12()
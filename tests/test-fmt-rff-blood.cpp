@@ -239,15 +239,15 @@ class test_rff_blood: public test_archive
 			return STRING_WITH_NULLS(
 				"RFF\x1a" "\x00\x02\x00\x00" "\x3e\x00\x00\x00" "\x02\x00\x00\x00"
 				"\x00\x00\x00\x00" "\x00\x00\x00\x00" "\x00\x00\x00\x00" "\x00\x00\x00\x00"
-				"This is two.dat"
 				"This is one.dat"
+				"This is two.dat"
 
 				"\x00\x00\x00\x00" "\x00\x00\x00\x00" "\x00\x00\x00\x00" "\x00\x00\x00\x00"
-				"\x20\x00\x00\x00" "\x0f\x00\x00\x00" "\x00\x00\x00\x00" "\x00\x00\x00\x00"
+				"\x2f\x00\x00\x00" "\x0f\x00\x00\x00" "\x00\x00\x00\x00" "\x00\x00\x00\x00"
 				"\x00" "DATTWO\0\0\0\0\0" "\x00\x00\x00\x00"
 
 				"\x00\x00\x00\x00" "\x00\x00\x00\x00" "\x00\x00\x00\x00" "\x00\x00\x00\x00"
-				"\x2f\x00\x00\x00" "\x0f\x00\x00\x00" "\x00\x00\x00\x00" "\x00\x00\x00\x00"
+				"\x20\x00\x00\x00" "\x0f\x00\x00\x00" "\x00\x00\x00\x00" "\x00\x00\x00\x00"
 				"\x00" "DATONE\0\0\0\0\0" "\x00\x00\x00\x00"
 			);
 		}
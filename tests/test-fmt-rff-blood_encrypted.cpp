@@ -177,13 +177,13 @@ class test_rff_blood_encrypted: public test_archive
 			return STRING_WITH_NULLS(
 				"RFF\x1a" "\x01\x03\x00\x00" "\x3e\x00\x00\x00" "\x02\x00\x00\x00"
 				"\x00\x00\x00\x00" "\x00\x00\x00\x00" "\x00\x00\x00\x00" "\x00\x00\x00\x00"
-				DATA_TWO
 				DATA_ONE
+				DATA_TWO
 				"\x3E\x3E\x3F\x3F\x40\x40\x41\x41\x42\x42\x43\x43\x44\x44\x45\x45"
-				"\x66\x46\x47\x47\x47\x48\x49\x49\x4A\x4A\x4B\x4B\x4C\x4C\x4D\x4D"
+				"\x69\x46\x47\x47\x47\x48\x49\x49\x4A\x4A\x4B\x4B\x4C\x4C\x4D\x4D"
 				"\x5E\x0A\x0E\x1B\x04\x07\x1E\x51\x52\x52\x53\x53\x54\x54\x55\x55"
 				"\x56\x56\x57\x57\x58\x58\x59\x59\x5A\x5A\x5B\x5B\x5C\x5C\x5D\x5D"
-				"\x71\x5E\x5F\x5F\x6F\x60\x61\x61\x62\x62\x63\x63\x64\x64\x65\x65"
+				"\x7E\x5E\x5F\x5F\x6F\x60\x61\x61\x62\x62\x63\x63\x64\x64\x65\x65"
 				"\x76\x22\x26\x33\x27\x26\x2C\x69\x6A\x6A\x6B\x6B\x6C\x6C\x6D\x6D"
 			);
 		}
@@ -176,10 +176,10 @@ class test_wad_doom: public test_archive
 		{
 			return STRING_WITH_NULLS(
 				"IWAD" "\x02\x00\x00\x00" "\x0c\x00\x00\x00"
-				"\x2c\x00\x00\x00" "\x0f\x00\x00\x00" "TWO.DAT\0"
-				"\x3b\x00\x00\x00" "\x0f\x00\x00\x00" "ONE.DAT\0"
-				"This is two.dat"
+				"\x3b\x00\x00\x00" "\x0f\x00\x00\x00" "TWO.DAT\0"
+				"\x2c\x00\x00\x00" "\x0f\x00\x00\x00" "ONE.DAT\0"
 				"This is one.dat"
+				"This is two.dat"
 			);
 		}
 